@@ -0,0 +1,191 @@
+#pragma once
+
+// Marching cubes over a field stored in bricks of sparse_brick_size^3 points, shared by the sparse and the
+// compressed fields. The brick source implements
+//  - size_t brick_count() const, the bricks to walk, the ones left out must not hold any crossing
+//  - SparseCoordinates brick_coordinates(size_t brick) const
+//  - int find_brick(SparseCoordinates coordinates) const, the index of a walked brick or -1
+//  - void load_brick_points(size_t brick, float* points) const, fills the (sparse_brick_size + 1)^3 points of the
+//    cells of the brick in (a, b, c) order, points past the grid are never read
+// Every brick owns the edges starting at its points, numbered in the order of their bits: point by point in
+// grid order, and for each point axis 0 (k), 1 (j) then 2 (i)
+
+#include "SparseField.h"
+#include "MarchingCubesKernel.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <iterator>
+
+typedef struct BrickExtractionState {
+	SparseCoordinates coordinates;
+	// Bricks at +i, +j and +k of the brick, bit 2 for i, 1 for j and 0 for k, -1 when not walked
+	int neighbours[8];
+	// Classification of the (sparse_brick_size + 1)^3 points of the cells of the brick
+	uint64_t below[(sparse_brick_size + 1) * (sparse_brick_size + 1) * (sparse_brick_size + 1) / 64 + 1];
+	// Cells of the brick with a triangle, one bit per cell in brick order
+	uint64_t active_cells[sparse_brick_points / 64];
+	// Crossed edges of the brick points, 3 bits per point, and the crossings of the words before each word
+	uint64_t crossings[sparse_brick_points * 3 / 64];
+	uint32_t crossing_ranks[sparse_brick_points * 3 / 64];
+	uint32_t vertex_count;
+	uint32_t vertex_offset;
+	size_t triangle_count;
+	size_t index_offset;
+} BrickExtractionState;
+
+template <typename BrickSource>
+void extract_marching_cubes_bricks(const BrickSource& source, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	int resolution = parameters.resolution;
+	float threshold = parameters.threshold;
+	const int* triangle_count_table = triangle_counts();
+	const int side = sparse_brick_size + 1;
+
+	std::vector<BrickExtractionState> states(source.brick_count());
+	parallel_for(int(states.size()), [&](int s) {
+		BrickExtractionState& state = states[s];
+		state.coordinates = source.brick_coordinates(s);
+		for (int n = 0; n < 8; n++) {
+			state.neighbours[n] = source.find_brick({ state.coordinates.i + (n >> 2), state.coordinates.j + ((n >> 1) & 1), state.coordinates.k + (n & 1) });
+		}
+	});
+
+	// First pass, every brick classifies the points of its cells, then counts its crossed edges and the
+	// triangles of its cells
+	const int tasks = std::min(int(states.size()), get_thread_count() * 4);
+	parallel_for(tasks, [&](int task) {
+		float points[side * side * side];
+		uint8_t below[side * side * side];
+		for (size_t s = states.size() * task / tasks; s < states.size() * (task + 1) / tasks; s++) {
+			BrickExtractionState& state = states[s];
+			int origin_i = state.coordinates.i * sparse_brick_size;
+			int origin_j = state.coordinates.j * sparse_brick_size;
+			int origin_k = state.coordinates.k * sparse_brick_size;
+			source.load_brick_points(s, points);
+			std::fill(std::begin(state.below), std::end(state.below), 0);
+			int row_end = std::min(side, resolution - origin_k);
+			for (int a = 0; a < side; a++) {
+				for (int b = 0; b < side; b++) {
+					int row = (a * side + b) * side;
+					if (origin_i + a >= resolution || origin_j + b >= resolution) {
+						std::fill_n(below + row, side, uint8_t(0));
+						continue;
+					}
+					for (int c = 0; c < side; c++) {
+						below[row + c] = c < row_end && points[row + c] < threshold;
+						state.below[(row + c) >> 6] |= uint64_t(below[row + c]) << ((row + c) & 63);
+					}
+				}
+			}
+			std::fill(std::begin(state.active_cells), std::end(state.active_cells), 0);
+			std::fill(std::begin(state.crossings), std::end(state.crossings), 0);
+			size_t triangle_count = 0;
+			for (int a = 0; a < sparse_brick_size && origin_i + a < resolution; a++) {
+				for (int b = 0; b < sparse_brick_size && origin_j + b < resolution; b++) {
+					for (int c = 0; c < sparse_brick_size && origin_k + c < resolution; c++) {
+						int point = (a * side + b) * side + c;
+						int bit = sparse_point_index(a, b, c) * 3;
+						if (origin_k + c + 1 < resolution && below[point] != below[point + 1]) state.crossings[bit >> 6] |= uint64_t(1) << (bit & 63);
+						bit++;
+						if (origin_j + b + 1 < resolution && below[point] != below[point + side]) state.crossings[bit >> 6] |= uint64_t(1) << (bit & 63);
+						bit++;
+						if (origin_i + a + 1 < resolution && below[point] != below[point + side * side]) state.crossings[bit >> 6] |= uint64_t(1) << (bit & 63);
+						if (origin_i + a + 1 >= resolution || origin_j + b + 1 >= resolution || origin_k + c + 1 >= resolution) continue;
+						int cube_index = below[point] | below[point + 1] << 1 | below[point + side + 1] << 2 | below[point + side] << 3 |
+							below[point + side * side] << 4 | below[point + side * side + 1] << 5 | below[point + side * side + side + 1] << 6 | below[point + side * side + side] << 7;
+						triangle_count += triangle_count_table[cube_index];
+						int cell = sparse_point_index(a, b, c);
+						state.active_cells[cell >> 6] |= uint64_t(triangle_count_table[cube_index] != 0) << (cell & 63);
+					}
+				}
+			}
+			uint32_t vertex_count = 0;
+			for (int w = 0; w < sparse_brick_points * 3 / 64; w++) {
+				state.crossing_ranks[w] = vertex_count;
+				vertex_count += bit_count(state.crossings[w]);
+			}
+			state.vertex_count = vertex_count;
+			state.triangle_count = triangle_count;
+		}
+	});
+
+	// Prefix sums give every brick its first vertex id and its range of the index buffer
+	uint32_t vertex_count = 0;
+	size_t triangle_count = 0;
+	for (BrickExtractionState& state : states) {
+		state.vertex_offset = vertex_count;
+		state.index_offset = triangle_count * 3;
+		vertex_count += state.vertex_count;
+		triangle_count += state.triangle_count;
+	}
+	MarchingCubesWorkspace& workspace = marching_cubes_workspace();
+	workspace.positions.resize(vertex_count);
+	std::vector<uint32_t>& indices = parameters.indexed ? mesh.indices : workspace.indices;
+	indices.resize(triangle_count * 3);
+
+	// Second pass, every brick with a crossing loads its points again, places the vertices of its edges and
+	// writes the triangles of its cells. Edges starting in the bricks at + take their ids from those bricks
+	float half_size = parameters.cube_size / 2.0f;
+	auto grid_position = [&](int i, int j, int k) {
+		return Vector3(map(float(k), 0.0f, float(resolution - 1), -half_size, half_size),
+			map(float(i), 0.0f, float(resolution - 1), -half_size, half_size),
+			map(float(j), 0.0f, float(resolution - 1), -half_size, half_size));
+	};
+	parallel_for(tasks, [&](int task) {
+		float points[side * side * side];
+		for (size_t s = states.size() * task / tasks; s < states.size() * (task + 1) / tasks; s++) {
+			const BrickExtractionState& state = states[s];
+			if (state.vertex_count == 0 && state.triangle_count == 0) continue;
+			int origin_i = state.coordinates.i * sparse_brick_size;
+			int origin_j = state.coordinates.j * sparse_brick_size;
+			int origin_k = state.coordinates.k * sparse_brick_size;
+			source.load_brick_points(s, points);
+			uint32_t id = state.vertex_offset;
+			for (int w = 0; w < sparse_brick_points * 3 / 64; w++) {
+				for (uint64_t crossings = state.crossings[w]; crossings; crossings &= crossings - 1) {
+					int bit = w * 64 + lowest_bit(crossings);
+					int point = bit / 3;
+					int axis = bit % 3;
+					int a = point >> (2 * sparse_brick_log2);
+					int b = (point >> sparse_brick_log2) & (sparse_brick_size - 1);
+					int c = point & (sparse_brick_size - 1);
+					int end_a = a + (axis == 2);
+					int end_b = b + (axis == 1);
+					int end_c = c + (axis == 0);
+					workspace.positions[id++] = RuntimeInterpolation::place(grid_position(origin_i + a, origin_j + b, origin_k + c),
+						grid_position(origin_i + end_a, origin_j + end_b, origin_k + end_c),
+						points[(a * side + b) * side + c], points[(end_a * side + end_b) * side + end_c], parameters);
+				}
+			}
+
+			// Cells with a triangle in brick order, which is grid order within the brick
+			uint32_t* triangle_indices = indices.data() + state.index_offset;
+			for (int w = 0; w < sparse_brick_points / 64; w++) {
+				for (uint64_t active = state.active_cells[w]; active; active &= active - 1) {
+					int cell = w * 64 + lowest_bit(active);
+					int a = cell >> (2 * sparse_brick_log2);
+					int b = (cell >> sparse_brick_log2) & (sparse_brick_size - 1);
+					int c = cell & (sparse_brick_size - 1);
+					int cube_index = 0;
+					for (int corner = 0; corner < 8; corner++) {
+						static const int corners[8][3] = { {0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}, {1, 0, 0}, {1, 0, 1}, {1, 1, 1}, {1, 1, 0} };
+						int point = ((a + corners[corner][0]) * side + b + corners[corner][1]) * side + c + corners[corner][2];
+						cube_index |= int((state.below[point >> 6] >> (point & 63)) & 1) << corner;
+					}
+					for (int m = 0; triTable[cube_index][m] != -1; m++) {
+						const int* edge = cube_edges[triTable[cube_index][m]];
+						int edge_a = a + edge[0];
+						int edge_b = b + edge[1];
+						int edge_c = c + edge[2];
+						const BrickExtractionState& owner = states[state.neighbours[(edge_a >> sparse_brick_log2) << 2 | (edge_b >> sparse_brick_log2) << 1 | (edge_c >> sparse_brick_log2)]];
+						int bit = sparse_point_index(edge_a, edge_b, edge_c) * 3 + edge[3];
+						uint64_t lower_bits = owner.crossings[bit >> 6] & ((uint64_t(1) << (bit & 63)) - 1);
+						*triangle_indices++ = owner.vertex_offset + owner.crossing_ranks[bit >> 6] + bit_count(lower_bits);
+					}
+				}
+			}
+		}
+	});
+
+	write_marching_cubes_mesh(workspace, indices, parameters.indexed, false, MeshVertexFormat(), mesh);
+}
@@ -0,0 +1,350 @@
+#include "ChunkedWorld.h"
+
+#include "MinMaxPyramid.h"
+#include "Parallel.h"
+#include "Transvoxel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+float terrain_field(Vector3 position) {
+	float height = 2.0f * sinf(position.x * 0.15f) * cosf(position.z * 0.12f)
+		+ 0.8f * sinf(position.x * 0.41f + position.z * 0.27f)
+		+ 0.3f * cosf(position.x * 1.1f - position.z * 0.9f);
+	return position.y - height;
+}
+
+int chunk_lod(const ChunkedWorld& world, ChunkCoordinates center, ChunkCoordinates coordinates) {
+	// Neighbour chunks are at most one apart in distance and every level spans at least lod_distance of them,
+	// so their levels are at most one apart. Chunks keep at least two cells so their transition cells do not
+	// overlap
+	int distance = std::max(std::abs(coordinates.x - center.x), std::max(std::abs(coordinates.y - center.y), std::abs(coordinates.z - center.z)));
+	int levels = std::min(world.parameters.lod_levels, max_chunk_lods);
+	int lod = 0;
+	for (int band = std::max(world.parameters.lod_distance, 1); distance >= band && lod + 1 < levels && (world.parameters.chunk_cells >> (lod + 1)) >= 2; band *= 2) {
+		lod++;
+	}
+	return lod;
+}
+
+static ChunkCoordinates chunk_neighbour(ChunkCoordinates coordinates, int face) {
+	int step = face & 1 ? 1 : -1;
+	if (face >> 1 == 0) coordinates.x += step;
+	else if (face >> 1 == 1) coordinates.y += step;
+	else coordinates.z += step;
+	return coordinates;
+}
+
+static uint8_t chunk_transition_faces(const ChunkedWorld& world, ChunkCoordinates center, ChunkCoordinates coordinates, int lod) {
+	uint8_t faces = 0;
+	for (int face = 0; face < 6; face++) {
+		if (chunk_lod(world, center, chunk_neighbour(coordinates, face)) < lod) faces |= uint8_t(1 << face);
+	}
+	return faces;
+}
+
+// Sets the level and the transition faces of the chunk and of its neighbours for the focus chunk center,
+// returning true when any of them changed
+static bool update_chunk_lod(const ChunkedWorld& world, ChunkCoordinates center, Chunk& chunk) {
+	int lod = chunk_lod(world, center, chunk.coordinates);
+	uint8_t transition_faces = chunk_transition_faces(world, center, chunk.coordinates, lod);
+	uint8_t neighbour_transition_faces[6];
+	for (int face = 0; face < 6; face++) {
+		ChunkCoordinates neighbour = chunk_neighbour(chunk.coordinates, face);
+		neighbour_transition_faces[face] = chunk_transition_faces(world, center, neighbour, chunk_lod(world, center, neighbour));
+	}
+	bool changed = lod != chunk.lod || transition_faces != chunk.transition_faces ||
+		!std::equal(neighbour_transition_faces, neighbour_transition_faces + 6, chunk.neighbour_transition_faces);
+	chunk.lod = lod;
+	chunk.transition_faces = transition_faces;
+	std::copy_n(neighbour_transition_faces, 6, chunk.neighbour_transition_faces);
+	return changed;
+}
+
+static int chunk_cells(const ChunkedWorld& world, const Chunk& chunk) {
+	return world.parameters.chunk_cells >> chunk.lod;
+}
+
+static MarchingCubesParameters chunk_parameters(const ChunkedWorld& world, const Chunk& chunk) {
+	MarchingCubesParameters parameters;
+	parameters.resolution = chunk_cells(world, chunk) + 1;
+	parameters.cube_size = world.parameters.chunk_size;
+	parameters.threshold = world.parameters.threshold;
+	parameters.interpolation = world.parameters.interpolation;
+	parameters.indexed = true;
+	return parameters;
+}
+
+static void generate_chunk_field(const ChunkedWorld& world, Chunk& chunk) {
+	int points = chunk_cells(world, chunk) + 1;
+	float cell_size = world.parameters.chunk_size / chunk_cells(world, chunk);
+	Vector3 origin = world.parameters.chunk_size * Vector3(float(chunk.coordinates.x), float(chunk.coordinates.y), float(chunk.coordinates.z));
+	chunk.field.resize(size_t(points) * points * points);
+	for (int i = 0; i < points; i++) {
+		for (int j = 0; j < points; j++) {
+			for (int k = 0; k < points; k++) {
+				chunk.field[(size_t(points) * i + j) * points + k] = world.parameters.field(origin + Vector3(k * cell_size, i * cell_size, j * cell_size));
+			}
+		}
+	}
+	auto range = std::minmax_element(chunk.field.begin(), chunk.field.end());
+	chunk.min_value = *range.first;
+	chunk.max_value = *range.second;
+}
+
+static float component(Vector3 v, int axis) {
+	return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+static void set_component(Vector3& v, int axis, float value) {
+	if (axis == 0) v.x = value;
+	else if (axis == 1) v.y = value;
+	else v.z = value;
+}
+
+// Adds the transition cells of the faces next to finer chunks, after shrinking the cells along those faces
+// away from them to make room
+static void stitch_chunk_faces(const ChunkedWorld& world, Chunk& chunk) {
+	const ChunkedWorldParameters& parameters = world.parameters;
+	int cells = chunk_cells(world, chunk);
+	int points = cells + 1;
+	float size = parameters.chunk_size;
+	float cell_size = size / cells;
+	float width = parameters.transition_width * cell_size;
+	Vector3 origin = size * Vector3(float(chunk.coordinates.x), float(chunk.coordinates.y), float(chunk.coordinates.z));
+	float epsilon = cell_size * 1e-4f;
+	auto shrink = [&](Vector3 position) {
+		Vector3 local = position - origin;
+		Vector3 shrunk = local;
+		for (int face = 0; face < 6; face++) {
+			if (!((chunk.transition_faces >> face) & 1)) continue;
+			int axis = face >> 1;
+			float x = component(local, axis);
+			float depth = face & 1 ? size - x : x;
+			if (depth >= cell_size) continue;
+			// Points on a face of the chunk next to a chunk of the same level that does not stitch the same side
+			// stay where they are to meet that chunk, the transition cells there flatten onto the face
+			bool pinned = false;
+			for (int border = 0; border < 6; border++) {
+				if (border >> 1 == axis || (chunk.transition_faces >> border) & 1 || (chunk.neighbour_transition_faces[border] >> face) & 1) continue;
+				float y = component(local, border >> 1);
+				if (fabsf(border & 1 ? size - y : y) < epsilon) pinned = true;
+			}
+			if (pinned) continue;
+			depth = width + depth * (cell_size - width) / cell_size;
+			set_component(shrunk, axis, face & 1 ? size - depth : depth);
+		}
+		return origin + shrunk;
+	};
+	for (MeshVertex& vertex : chunk.mesh.vertices) {
+		vertex.position = shrink(vertex.position);
+	}
+
+	// Normals of the transition vertices from the gradient of the field
+	float step = cell_size / 2.0f;
+	auto normal = [&](Vector3 position) {
+		return normalize(Vector3(parameters.field(position + Vector3(step, 0, 0)) - parameters.field(position - Vector3(step, 0, 0)),
+			parameters.field(position + Vector3(0, step, 0)) - parameters.field(position - Vector3(0, step, 0)),
+			parameters.field(position + Vector3(0, 0, step)) - parameters.field(position - Vector3(0, 0, step))));
+	};
+	size_t indices_before = chunk.mesh.indices.size();
+	int samples = 2 * cells + 1;
+	std::vector<float> values(size_t(samples) * samples);
+	for (int face = 0; face < 6; face++) {
+		if (!((chunk.transition_faces >> face) & 1)) continue;
+		int axis = face >> 1;
+		int side = face & 1;
+		int u_axis = axis == 0 ? 1 : 0;
+		int v_axis = axis == 2 ? 1 : 2;
+		// Position of fine sample (u, v) of the face in the chunk
+		auto face_position = [&](float u, float v) {
+			Vector3 position = origin;
+			set_component(position, axis, component(origin, axis) + (side ? size : 0.0f));
+			set_component(position, u_axis, component(origin, u_axis) + u * step);
+			set_component(position, v_axis, component(origin, v_axis) + v * step);
+			return position;
+		};
+		// The coarse samples are taken from the field, so the transition cells see the same ones as the shrunk cells
+		for (int v = 0; v < samples; v++) {
+			for (int u = 0; u < samples; u++) {
+				int coordinates[3];
+				coordinates[axis] = side ? cells : 0;
+				coordinates[u_axis] = u / 2;
+				coordinates[v_axis] = v / 2;
+				bool coarse = !chunk.field.empty() && u % 2 == 0 && v % 2 == 0;
+				values[size_t(samples) * v + u] = coarse ? chunk.field[(size_t(points) * coordinates[1] + coordinates[2]) * points + coordinates[0]]
+					: parameters.field(face_position(float(u), float(v)));
+			}
+		}
+		TransitionFace transition;
+		transition.cells = cells;
+		transition.values = values.data();
+		transition.fine_position = face_position;
+		transition.coarse_position = [&](float u, float v) { return shrink(face_position(u, v)); };
+		// The (u, v, depth) frame is (u_axis, v_axis, axis) with depth going into the chunk, a reflection for
+		// the y axis and for the faces at the end of the axis
+		transition.mirrored = (axis == 1) != (side == 1);
+		extract_transition_face(transition, chunk_parameters(world, chunk), normal, chunk.mesh);
+	}
+	chunk.transition_triangles = (chunk.mesh.indices.size() - indices_before) / 3;
+}
+
+// Meshes the chunk from its field, which is dropped when the surface does not go through the chunk
+static void mesh_chunk(const ChunkedWorld& world, Chunk& chunk) {
+	if (chunk.field.empty() && block_straddles(chunk.min_value, chunk.max_value, world.parameters.threshold)) {
+		generate_chunk_field(world, chunk);
+	}
+	if (!block_straddles(chunk.min_value, chunk.max_value, world.parameters.threshold)) {
+		std::vector<float>().swap(chunk.field);
+		chunk.mesh = MarchingCubesMesh();
+	}
+	else {
+		extract_marching_cubes(chunk.field, chunk_parameters(world, chunk), chunk.mesh);
+		// The extraction centers the chunk on the origin
+		float half_size = world.parameters.chunk_size / 2.0f;
+		Vector3 center = world.parameters.chunk_size * Vector3(float(chunk.coordinates.x), float(chunk.coordinates.y), float(chunk.coordinates.z)) + half_size;
+		for (MeshVertex& vertex : chunk.mesh.vertices) {
+			vertex.position = vertex.position + center;
+		}
+	}
+	chunk.decimated_triangles = 0;
+	if (world.parameters.decimate && !chunk.mesh.indices.empty()) {
+		DecimationParameters decimation = world.parameters.decimation;
+		decimation.preserve_borders = true;
+		DecimationStats decimation_stats;
+		decimate_mesh(chunk.mesh, decimation, decimation_stats);
+		chunk.decimated_triangles = decimation_stats.input_triangles - decimation_stats.output_triangles;
+	}
+	// Transition cells can hold crossings between the coarse samples even when the field does not
+	chunk.transition_triangles = 0;
+	if (chunk.transition_faces) stitch_chunk_faces(world, chunk);
+	chunk.memory = sizeof(Chunk) + chunk.field.capacity() * sizeof(float) +
+		chunk.mesh.vertices.capacity() * sizeof(MeshVertex) + chunk.mesh.indices.capacity() * sizeof(uint32_t);
+}
+
+static void update_world_stats(ChunkedWorld& world) {
+	ChunkStreamingStats& stats = world.stats;
+	stats.resident = world.chunks.size();
+	stats.memory = 0;
+	stats.triangles = 0;
+	stats.transition_triangles = 0;
+	stats.decimated_triangles = 0;
+	std::fill(stats.lod_chunks, stats.lod_chunks + max_chunk_lods, 0);
+	for (const auto& entry : world.chunks) {
+		stats.memory += entry.second.memory;
+		stats.triangles += entry.second.mesh.indices.size() / 3;
+		stats.transition_triangles += entry.second.transition_triangles;
+		stats.decimated_triangles += entry.second.decimated_triangles;
+		stats.lod_chunks[entry.second.lod]++;
+	}
+	stats.peak_memory = std::max(stats.peak_memory, stats.memory);
+}
+
+void update_chunked_world(ChunkedWorld& world, Vector3 focus) {
+	auto update_start = std::chrono::high_resolution_clock::now();
+	const ChunkedWorldParameters& parameters = world.parameters;
+	uint64_t update = ++world.current_update;
+	ChunkCoordinates center = chunk_at(world, focus);
+
+	// Touch the resident chunks in view and list the missing ones, nearest first
+	// Resident chunks whose level of detail or transition faces changed with the focus are meshed again
+	std::vector<std::pair<int, ChunkCoordinates>> missing;
+	// Chunks that changed level need their field sampled again
+	std::vector<std::pair<Chunk*, bool>> changed;
+	int distance = parameters.view_distance;
+	for (int dy = -distance; dy <= distance; dy++) {
+		for (int dz = -distance; dz <= distance; dz++) {
+			for (int dx = -distance; dx <= distance; dx++) {
+				int squared_distance = dx * dx + dy * dy + dz * dz;
+				if (squared_distance > distance * distance) continue;
+				ChunkCoordinates coordinates = { center.x + dx, center.y + dy, center.z + dz };
+				auto found = world.chunks.find(coordinates);
+				if (found == world.chunks.end()) {
+					missing.push_back(std::make_pair(squared_distance, coordinates));
+					continue;
+				}
+				Chunk& chunk = found->second;
+				chunk.last_used = update;
+				world.lru.splice(world.lru.begin(), world.lru, chunk.lru_position);
+				world.stats.hits++;
+				int lod = chunk.lod;
+				if (update_chunk_lod(world, center, chunk)) changed.push_back(std::make_pair(&chunk, lod != chunk.lod));
+			}
+		}
+	}
+	std::stable_sort(missing.begin(), missing.end(), [](const std::pair<int, ChunkCoordinates>& a, const std::pair<int, ChunkCoordinates>& b) {
+		return a.first < b.first;
+	});
+	if (parameters.max_generated_per_update > 0 && int(missing.size()) > parameters.max_generated_per_update) {
+		missing.resize(parameters.max_generated_per_update);
+	}
+
+	// Generate and mesh the missing chunks and mesh the changed ones again, one chunk per task
+	std::vector<Chunk> generated(missing.size());
+	parallel_for(int(missing.size() + changed.size()), [&](int c) {
+		if (c >= int(missing.size())) {
+			Chunk& chunk = *changed[c - missing.size()].first;
+			if (changed[c - missing.size()].second) generate_chunk_field(world, chunk);
+			mesh_chunk(world, chunk);
+			return;
+		}
+		Chunk& chunk = generated[c];
+		chunk.coordinates = missing[c].second;
+		update_chunk_lod(world, center, chunk);
+		generate_chunk_field(world, chunk);
+		mesh_chunk(world, chunk);
+	});
+	world.stats.remeshed += changed.size();
+	for (Chunk& chunk : generated) {
+		ChunkCoordinates coordinates = chunk.coordinates;
+		world.lru.push_front(coordinates);
+		chunk.lru_position = world.lru.begin();
+		chunk.last_used = update;
+		world.chunks.emplace(coordinates, std::move(chunk));
+	}
+	world.stats.generated += generated.size();
+
+	// Evict the least recently used chunks, the ones needed by this update stay even over the budget
+	// The peak is taken first, the new chunks and the ones about to go were all held at once
+	size_t memory = 0;
+	for (const auto& entry : world.chunks) memory += entry.second.memory;
+	world.stats.peak_memory = std::max(world.stats.peak_memory, memory);
+	while (memory > parameters.memory_budget && !world.lru.empty()) {
+		auto oldest = world.chunks.find(world.lru.back());
+		if (oldest->second.last_used == update) break;
+		memory -= oldest->second.memory;
+		world.lru.pop_back();
+		world.chunks.erase(oldest);
+		world.stats.evicted++;
+	}
+
+	world.stats.updates++;
+	update_world_stats(world);
+	double update_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - update_start).count();
+	world.stats.total_update_time += update_time;
+	world.stats.max_update_time = std::max(world.stats.max_update_time, update_time);
+}
+
+void remesh_chunked_world(ChunkedWorld& world) {
+	std::vector<Chunk*> chunks;
+	for (auto& entry : world.chunks) chunks.push_back(&entry.second);
+	parallel_for(int(chunks.size()), [&](int c) {
+		mesh_chunk(world, *chunks[c]);
+	});
+	update_world_stats(world);
+}
+
+void clear_chunked_world(ChunkedWorld& world) {
+	world.chunks.clear();
+	world.lru.clear();
+	world.current_update = 0;
+	world.stats = ChunkStreamingStats();
+}
+
+ChunkStreamingStats run_chunk_streaming_script(ChunkedWorld& world, const std::vector<Vector3>& path) {
+	clear_chunked_world(world);
+	for (Vector3 focus : path) {
+		update_chunked_world(world, focus);
+	}
+	return world.stats;
+}
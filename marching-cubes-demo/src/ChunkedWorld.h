@@ -0,0 +1,128 @@
+#pragma once
+
+// Chunked world, an unbounded field split into fixed size chunks keyed by their integer coordinates
+// Chunks around a focus point are generated and meshed on demand and the least recently used ones are evicted
+// when the world goes over its memory budget. Nothing here depends on Direct3D, so it runs headless
+// Distant chunks are meshed with fewer cells, halving them with every level of detail. Neighbour chunks are at
+// most one level apart, and the coarser one stitches its faces to the finer one with Transvoxel transition cells
+// Chunk meshes can be decimated before they are stitched, their borders stay in place so chunks still meet
+
+#include "MarchingCubes.h"
+#include "Decimation.h"
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+typedef struct ChunkCoordinates {
+	int x, y, z;
+	bool operator==(const ChunkCoordinates& other) const { return x == other.x && y == other.y && z == other.z; }
+} ChunkCoordinates;
+typedef struct ChunkCoordinatesHash {
+	size_t operator()(const ChunkCoordinates& coordinates) const {
+		return (size_t(uint32_t(coordinates.x)) * 73856093u) ^ (size_t(uint32_t(coordinates.y)) * 19349663u) ^ (size_t(uint32_t(coordinates.z)) * 83492791u);
+	}
+} ChunkCoordinatesHash;
+
+const int max_chunk_lods = 8;
+
+typedef struct Chunk {
+	ChunkCoordinates coordinates;
+	// Level of detail, the chunk has chunk_cells >> lod cells along each axis
+	int lod;
+	// Faces next to a chunk one level finer, bit 2 * axis + side with axis 0 for x, 1 for y and 2 for z and
+	// side 1 for the face at the end of the axis
+	uint8_t transition_faces;
+	// Transition faces of the neighbour chunk across every face
+	uint8_t neighbour_transition_faces[6];
+	// (cells + 1)^3 points laid out like the grid, the border points are shared with the neighbour chunks
+	// so their meshes meet. Chunks the surface does not go through drop their field and only keep its range
+	std::vector<float> field;
+	float min_value;
+	float max_value;
+	// Mesh in world space, the triangles of the transition cells last
+	MarchingCubesMesh mesh;
+	size_t transition_triangles;
+	// Triangles decimation removed from the extracted mesh
+	size_t decimated_triangles;
+	size_t memory;
+	// Update the chunk was last needed in and its place in the LRU list
+	uint64_t last_used;
+	std::list<ChunkCoordinates>::iterator lru_position;
+} Chunk;
+
+typedef struct ChunkedWorldParameters {
+	int chunk_cells = 32;
+	float chunk_size = 8.0f;
+	float threshold = 0.0f;
+	bool interpolation = true;
+	// Chunks whose center is within view_distance chunks of the focus are kept loaded
+	int view_distance = 4;
+	size_t memory_budget = size_t(256) << 20;
+	// Chunks generated by one update at most, nearest first, 0 generates all of them
+	int max_generated_per_update = 0;
+	// Levels of detail, chunks lod_distance chunks away from the focus chunk or more along any axis are one
+	// level coarser, and every level starts twice as far as the one before it. 1 meshes every chunk in full
+	int lod_levels = 1;
+	int lod_distance = 2;
+	// Depth of the transition cells, as a fraction of a cell of the coarser chunk
+	float transition_width = 0.5f;
+	// Decimates every chunk mesh after extraction, with its borders preserved whatever the decimation parameters say
+	bool decimate = false;
+	DecimationParameters decimation;
+	// Field value at a world position, below threshold is inside
+	std::function<float(Vector3)> field;
+} ChunkedWorldParameters;
+
+typedef struct ChunkStreamingStats {
+	size_t updates = 0;
+	size_t generated = 0;
+	size_t hits = 0;
+	size_t evicted = 0;
+	// Resident chunks meshed again after their level of detail or their transition faces changed
+	size_t remeshed = 0;
+	size_t resident = 0;
+	size_t memory = 0;
+	// Largest memory held, counted before every eviction
+	size_t peak_memory = 0;
+	size_t triangles = 0;
+	size_t transition_triangles = 0;
+	size_t decimated_triangles = 0;
+	// Resident chunks at every level of detail
+	size_t lod_chunks[max_chunk_lods] = {};
+	double total_update_time = 0;
+	double max_update_time = 0;
+} ChunkStreamingStats;
+
+typedef struct ChunkedWorld {
+	ChunkedWorldParameters parameters;
+	std::unordered_map<ChunkCoordinates, Chunk, ChunkCoordinatesHash> chunks;
+	// Most recently used chunks first
+	std::list<ChunkCoordinates> lru;
+	uint64_t current_update = 0;
+	ChunkStreamingStats stats;
+} ChunkedWorld;
+
+// Rolling terrain, the height of a few sine waves, below the surface is inside
+float terrain_field(Vector3 position);
+
+// Level of detail of the chunk at coordinates while the focus is in the chunk at center
+int chunk_lod(const ChunkedWorld& world, ChunkCoordinates center, ChunkCoordinates coordinates);
+
+inline ChunkCoordinates chunk_at(const ChunkedWorld& world, Vector3 position) {
+	float chunk_size = world.parameters.chunk_size;
+	return { int(floorf(position.x / chunk_size)), int(floorf(position.y / chunk_size)), int(floorf(position.z / chunk_size)) };
+}
+
+// Loads the chunks around focus, generating and meshing the missing ones in parallel, then evicts the least
+// recently used chunks not needed by this update until the world fits its memory budget
+void update_chunked_world(ChunkedWorld& world, Vector3 focus);
+// Meshes the loaded chunks again after a threshold or interpolation change
+void remesh_chunked_world(ChunkedWorld& world);
+void clear_chunked_world(ChunkedWorld& world);
+
+// Moves the focus along a scripted camera path, one update per point, and returns the stats of the run
+ChunkStreamingStats run_chunk_streaming_script(ChunkedWorld& world, const std::vector<Vector3>& path);
@@ -0,0 +1,70 @@
+#include "Classification.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CLASSIFY_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLASSIFY_SSE
+#endif
+
+// Classifies up to 64 consecutive values into a word
+static uint64_t classify_word(const float* values, int count, float threshold) {
+	uint64_t word = 0;
+	int k = 0;
+#if defined(CLASSIFY_AVX)
+	__m256 threshold8 = _mm256_set1_ps(threshold);
+	for (; k + 8 <= count; k += 8) {
+		word |= uint64_t(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + k), threshold8, _CMP_LT_OQ))) << k;
+	}
+#endif
+#if defined(CLASSIFY_SSE)
+	__m128 threshold4 = _mm_set1_ps(threshold);
+	for (; k + 4 <= count; k += 4) {
+		word |= uint64_t(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(values + k), threshold4))) << k;
+	}
+#endif
+	for (; k < count; k++) {
+		word |= uint64_t(values[k] < threshold) << k;
+	}
+	return word;
+}
+
+// Replaces the count bits of a row starting at point first with value, count is at most 64
+static void set_point_bits(uint64_t* bits, int first, int count, uint64_t value) {
+	int w = first >> 6;
+	int shift = first & 63;
+	uint64_t mask = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+	value &= mask;
+	bits[w] = (bits[w] & ~(mask << shift)) | (value << shift);
+	if (shift + count > 64) {
+		bits[w + 1] = (bits[w + 1] & ~(mask >> (64 - shift))) | (value >> (64 - shift));
+	}
+}
+
+void classify_points(const float* values, int count, float threshold, uint64_t* bits) {
+	int words = classification_words(count);
+	for (int w = 0; w < words; w++) {
+		bits[w] = classify_word(values + w * 64, count - w * 64 < 64 ? count - w * 64 : 64, threshold);
+	}
+}
+
+void classify_point_range(const float* values, int first, int count, float threshold, uint64_t* bits) {
+	for (int k = 0; k < count; k += 64) {
+		int word_count = count - k < 64 ? count - k : 64;
+		set_point_bits(bits, first + k, word_count, classify_word(values + first + k, word_count, threshold));
+	}
+}
+
+void fill_point_range(int first, int count, bool below, uint64_t* bits) {
+	for (int k = 0; k < count; k += 64) {
+		int word_count = count - k < 64 ? count - k : 64;
+		set_point_bits(bits, first + k, word_count, below ? ~uint64_t(0) : 0);
+	}
+}
+
+void classify_active_cells(const uint64_t* row0, const uint64_t* row1, const uint64_t* row2, const uint64_t* row3, int cell_count, uint64_t* active) {
+	int words = classification_words(cell_count + 1);
+	for (int w = 0; w < words; w++) active[w] = active_cell_word(row0, row1, row2, row3, cell_count, w);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Grid points are classified into bit rows, bit k of a row is set when the point k of that row is below the threshold
+// Rows are padded to whole 64 bit words
+inline int classification_words(int count) {
+	return (count + 63) / 64;
+}
+
+// Classifies count consecutive values, vectorized with AVX or SSE when the compiler targets them
+void classify_points(const float* values, int count, float threshold, uint64_t* bits);
+
+// Classifies the count points of a row starting at point first, leaving the other bits of the row as they are
+void classify_point_range(const float* values, int first, int count, float threshold, uint64_t* bits);
+// Sets the count points of a row starting at point first to the same side, for ranges already known not to cross the threshold
+void fill_point_range(int first, int count, bool below, uint64_t* bits);
+
+// Scalar classification of integer samples
+template <typename Scalar>
+void classify_points(const Scalar* values, int count, float threshold, uint64_t* bits) {
+	for (int w = 0; w < classification_words(count); w++) {
+		uint64_t word = 0;
+		for (int k = 0; k < 64 && w * 64 + k < count; k++) {
+			word |= uint64_t(float(values[w * 64 + k]) < threshold) << k;
+		}
+		bits[w] = word;
+	}
+}
+template <typename Scalar>
+void classify_point_range(const Scalar* values, int first, int count, float threshold, uint64_t* bits) {
+	for (int k = first; k < first + count; k++) {
+		uint64_t bit = uint64_t(1) << (k & 63);
+		if (float(values[k]) < threshold) bits[k >> 6] |= bit;
+		else bits[k >> 6] &= ~bit;
+	}
+}
+
+// Marks the cells of a row that the surface goes through, the ones whose corners are not all on the same side
+// row0/row1 are the point rows j and j+1 of layer i and row2/row3 the same rows of layer i+1
+void classify_active_cells(const uint64_t* row0, const uint64_t* row1, const uint64_t* row2, const uint64_t* row3, int cell_count, uint64_t* active);
+
+// Active cells of word w of the same rows, for passes that only look at part of a row
+// Cell k has its corners at points k and k+1 of every row, so each row is combined with itself shifted by one point
+// 64 cells are classified at once, a cell is active when some but not all of its corners are below the threshold
+inline uint64_t active_cell_word(const uint64_t* row0, const uint64_t* row1, const uint64_t* row2, const uint64_t* row3, int cell_count, int w) {
+	int words = classification_words(cell_count + 1);
+	const uint64_t* rows[4] = { row0, row1, row2, row3 };
+	uint64_t any_below = 0;
+	uint64_t all_below = ~uint64_t(0);
+	for (int r = 0; r < 4; r++) {
+		uint64_t next = w + 1 < words ? rows[r][w + 1] : 0;
+		uint64_t shifted = (rows[r][w] >> 1) | (next << 63);
+		any_below |= rows[r][w] | shifted;
+		all_below &= rows[r][w] & shifted;
+	}
+	uint64_t valid = ~uint64_t(0);
+	int remaining = cell_count - w * 64;
+	if (remaining <= 0) valid = 0;
+	else if (remaining < 64) valid = (uint64_t(1) << remaining) - 1;
+	return any_below & ~all_below & valid;
+}
+
+// Bit of point k of a classified row
+inline int point_bit(const uint64_t* row, int k) {
+	return int((row[k >> 6] >> (k & 63)) & 1);
+}
+
+// Marching cubes configuration index of cell k from the classified point rows around it
+inline int cell_cube_index(const uint64_t* row0, const uint64_t* row1, const uint64_t* row2, const uint64_t* row3, int k) {
+	return point_bit(row0, k) | point_bit(row0, k + 1) << 1 | point_bit(row1, k + 1) << 2 | point_bit(row1, k) << 3 |
+		point_bit(row2, k) << 4 | point_bit(row2, k + 1) << 5 | point_bit(row3, k + 1) << 6 | point_bit(row3, k) << 7;
+}
+
+// Index of the lowest set bit, bits must not be 0
+inline int lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return int(index);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)bits)) return int(index);
+	_BitScanForward(&index, (unsigned long)(bits >> 32));
+	return int(index) + 32;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+// Index of the highest set bit, bits must not be 0
+inline int highest_bit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return int(index);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(bits >> 32))) return int(index) + 32;
+	_BitScanReverse(&index, (unsigned long)bits);
+	return int(index);
+#else
+	return 63 - __builtin_clzll(bits);
+#endif
+}
+
+// Number of set bits
+inline int bit_count(uint64_t bits) {
+#if defined(_MSC_VER)
+	bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+	bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return int((bits * 0x0101010101010101ull) >> 56);
+#else
+	return __builtin_popcountll(bits);
+#endif
+}
@@ -0,0 +1,250 @@
+#include "CompressedField.h"
+
+#include "BrickExtraction.h"
+#include "MinMaxPyramid.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+static uint32_t float_bits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+static float bits_float(uint32_t bits) {
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+static uint32_t zigzag(uint32_t difference) {
+	return (difference << 1) ^ uint32_t(int32_t(difference) >> 31);
+}
+static uint32_t unzigzag(uint32_t value) {
+	return (value >> 1) ^ (0u - (value & 1));
+}
+static float dequantize(const CompressedBrick& brick, uint32_t q) {
+	return brick.base + float(q) * brick.scale;
+}
+static uint32_t read_bits(const uint8_t* data, size_t position, uint32_t bits) {
+	uint64_t word;
+	memcpy(&word, data + (position >> 3), sizeof(word));
+	return uint32_t((word >> (position & 7)) & ((uint64_t(1) << bits) - 1));
+}
+
+// Points of the brick in brick order, the ones past the grid repeat its last points
+static void gather_brick(const float* grid, int resolution, int bi, int bj, int bk, float* values) {
+	for (int a = 0; a < sparse_brick_size; a++) {
+		int i = std::min(bi * sparse_brick_size + a, resolution - 1);
+		for (int b = 0; b < sparse_brick_size; b++) {
+			int j = std::min(bj * sparse_brick_size + b, resolution - 1);
+			const float* row = grid + (size_t(resolution) * i + j) * resolution;
+			for (int c = 0; c < sparse_brick_size; c++) {
+				values[sparse_point_index(a, b, c)] = row[std::min(bk * sparse_brick_size + c, resolution - 1)];
+			}
+		}
+	}
+}
+
+// Packed value of every point of the brick, filling its header but its data offset
+// Quantized bricks know their header from their range alone and only compute the codes when asked to
+static void encode_brick(const float* values, CompressedFieldMode mode, CompressedBrick& brick, uint32_t* codes, bool pack) {
+	auto range = std::minmax_element(values, values + sparse_brick_points);
+	brick.base = values[0];
+	brick.scale = 0;
+	brick.bits = 0;
+	if (mode == compressed_lossless) {
+		uint32_t all_codes = 0;
+		for (int row = 0; row < sparse_brick_size * sparse_brick_size; row++) {
+			uint32_t previous = float_bits(brick.base);
+			for (int c = 0; c < sparse_brick_size; c++) {
+				uint32_t bits = float_bits(values[row * sparse_brick_size + c]);
+				codes[row * sparse_brick_size + c] = zigzag(bits - previous);
+				all_codes |= codes[row * sparse_brick_size + c];
+				previous = bits;
+			}
+		}
+		while (brick.bits < 32 && (all_codes >> brick.bits) != 0) brick.bits++;
+		brick.min_value = *range.first;
+		brick.max_value = *range.second;
+		return;
+	}
+	brick.base = *range.first;
+	if (*range.first == *range.second) {
+		brick.min_value = brick.max_value = brick.base;
+		return;
+	}
+	brick.bits = mode == compressed_quantized_8 ? 8 : 12;
+	uint32_t levels = (1u << brick.bits) - 1;
+	brick.scale = (*range.second - *range.first) / levels;
+	// The smallest point decodes to base and the largest to the last level
+	brick.min_value = brick.base;
+	brick.max_value = dequantize(brick, levels);
+	if (!pack) return;
+	float inverse_scale = 1.0f / brick.scale;
+	for (int p = 0; p < sparse_brick_points; p++) {
+		codes[p] = std::min(uint32_t((values[p] - brick.base) * inverse_scale + 0.5f), levels);
+	}
+}
+
+void build_compressed_field(const float* grid, int resolution, CompressedFieldMode mode, CompressedField& field) {
+	field.resolution = resolution;
+	field.mode = mode;
+	field.bricks = resolution > 0 ? (resolution + sparse_brick_size - 1) / sparse_brick_size : 0;
+	size_t brick_count = size_t(field.bricks) * field.bricks * field.bricks;
+	field.headers.assign(brick_count, CompressedBrick());
+	field.data.clear();
+	if (brick_count == 0) return;
+
+	// Bricks only know their bits after seeing all their points, so they are encoded twice, once for the headers
+	// and once more to pack their points at the offsets of the headers, bits bytes per 8 points
+	auto encode_slab = [&](int bi, bool pack) {
+		float values[sparse_brick_points];
+		uint32_t codes[sparse_brick_points];
+		for (int bj = 0; bj < field.bricks; bj++) {
+			for (int bk = 0; bk < field.bricks; bk++) {
+				CompressedBrick& brick = field.headers[(size_t(field.bricks) * bi + bj) * field.bricks + bk];
+				uint32_t data_offset = brick.data_offset;
+				gather_brick(grid, resolution, bi, bj, bk, values);
+				encode_brick(values, mode, brick, codes, pack);
+				if (!pack || brick.bits == 0) continue;
+				brick.data_offset = data_offset;
+				uint64_t packed[sparse_brick_points * 32 / 64 + 1] = {};
+				for (int p = 0; p < sparse_brick_points; p++) {
+					size_t position = size_t(p) * brick.bits;
+					packed[position >> 6] |= uint64_t(codes[p]) << (position & 63);
+					if ((position & 63) + brick.bits > 64) packed[(position >> 6) + 1] |= uint64_t(codes[p]) >> (64 - (position & 63));
+				}
+				memcpy(&field.data[data_offset], packed, size_t(brick.bits) * sparse_brick_points / 8);
+			}
+		}
+	};
+	parallel_for(field.bricks, [&](int bi) { encode_slab(bi, false); });
+	size_t data_size = 0;
+	for (CompressedBrick& brick : field.headers) {
+		brick.data_offset = uint32_t(data_size);
+		data_size += size_t(brick.bits) * sparse_brick_points / 8;
+	}
+	field.data.assign(data_size + sizeof(uint64_t), 0);
+	parallel_for(field.bricks, [&](int bi) { encode_slab(bi, true); });
+}
+
+void decode_compressed_row(const CompressedField& field, const CompressedBrick& brick, int a, int b, int count, float* values) {
+	if (brick.bits == 0) {
+		std::fill_n(values, count, brick.base);
+		return;
+	}
+	const uint8_t* data = field.data.data() + brick.data_offset;
+	size_t first = sparse_point_index(a, b, 0);
+	if (field.mode == compressed_lossless) {
+		uint32_t bits = float_bits(brick.base);
+		for (int c = 0; c < count; c++) {
+			bits += unzigzag(read_bits(data, (first + c) * brick.bits, brick.bits));
+			values[c] = bits_float(bits);
+		}
+	}
+	else if (brick.bits == 8) {
+		for (int c = 0; c < count; c++) values[c] = dequantize(brick, data[first + c]);
+	}
+	else {
+		for (int c = 0; c < count; c++) values[c] = dequantize(brick, read_bits(data, (first + c) * brick.bits, brick.bits));
+	}
+}
+
+void decompress_field(const CompressedField& field, std::vector<float>& grid) {
+	int resolution = field.resolution;
+	grid.resize(size_t(resolution) * resolution * resolution);
+	parallel_for(resolution, [&](int i) {
+		float values[sparse_brick_size];
+		for (int j = 0; j < resolution; j++) {
+			for (int bk = 0; bk < field.bricks; bk++) {
+				const CompressedBrick& brick = field.headers[(size_t(field.bricks) * (i / sparse_brick_size) + j / sparse_brick_size) * field.bricks + bk];
+				int count = std::min(sparse_brick_size, resolution - bk * sparse_brick_size);
+				decode_compressed_row(field, brick, i % sparse_brick_size, j % sparse_brick_size, count, values);
+				std::copy_n(values, count, grid.begin() + (size_t(resolution) * i + j) * resolution + bk * sparse_brick_size);
+			}
+		}
+	});
+}
+
+size_t compressed_field_memory(const CompressedField& field) {
+	return field.headers.capacity() * sizeof(CompressedBrick) + field.data.capacity();
+}
+
+float compressed_field_max_error(const CompressedField& field) {
+	// Points round to the nearest level
+	float max_error = 0;
+	for (const CompressedBrick& brick : field.headers) max_error = std::max(max_error, brick.scale / 2.0f);
+	return max_error;
+}
+
+// Bricks whose range, or the range of a brick at +, straddles the threshold, in grid order
+typedef struct CompressedBrickSource {
+	const CompressedField* field;
+	int bricks;
+	std::vector<SparseCoordinates> active_bricks;
+	// Index of every brick of the grid in the active bricks, or -1
+	std::vector<int32_t> lookup;
+	size_t brick_count() const { return active_bricks.size(); }
+	SparseCoordinates brick_coordinates(size_t brick) const { return active_bricks[brick]; }
+	int find_brick(SparseCoordinates coordinates) const {
+		if (coordinates.i >= bricks || coordinates.j >= bricks || coordinates.k >= bricks) return -1;
+		return lookup[(size_t(bricks) * coordinates.i + coordinates.j) * bricks + coordinates.k];
+	}
+	const CompressedBrick& header(int bi, int bj, int bk) const {
+		return field->headers[(size_t(field->bricks) * bi + bj) * field->bricks + bk];
+	}
+	// Decodes the rows of the brick and the first point of the rows of the bricks at +
+	void load_brick_points(size_t brick, float* points) const {
+		const int side = sparse_brick_size + 1;
+		SparseCoordinates coordinates = active_bricks[brick];
+		for (int a = 0; a < side; a++) {
+			int bi = coordinates.i + (a >> sparse_brick_log2);
+			if (bi >= bricks) break;
+			for (int b = 0; b < side; b++) {
+				int bj = coordinates.j + (b >> sparse_brick_log2);
+				if (bj >= bricks) break;
+				float* row = points + (a * side + b) * side;
+				decode_compressed_row(*field, header(bi, bj, coordinates.k), a, b, sparse_brick_size, row);
+				if (coordinates.k + 1 < bricks) decode_compressed_row(*field, header(bi, bj, coordinates.k + 1), a, b, 1, row + sparse_brick_size);
+			}
+		}
+	}
+} CompressedBrickSource;
+
+void extract_marching_cubes_compressed(const CompressedField& field, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	int resolution = parameters.resolution;
+	// The bricks are laid out for the resolution of the field, any other one would cut or overrun them
+	if (resolution < 2 || resolution != field.resolution) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	CompressedBrickSource source;
+	source.field = &field;
+	source.bricks = (resolution + sparse_brick_size - 1) / sparse_brick_size;
+	int bricks = source.bricks;
+	source.lookup.assign(size_t(bricks) * bricks * bricks, -1);
+	parallel_for(bricks, [&](int bi) {
+		for (int bj = 0; bj < bricks; bj++) {
+			for (int bk = 0; bk < bricks; bk++) {
+				float min_value = source.header(bi, bj, bk).min_value;
+				float max_value = source.header(bi, bj, bk).max_value;
+				for (int n = 1; n < 8; n++) {
+					int ni = bi + (n >> 2), nj = bj + ((n >> 1) & 1), nk = bk + (n & 1);
+					if (ni >= bricks || nj >= bricks || nk >= bricks) continue;
+					min_value = std::min(min_value, source.header(ni, nj, nk).min_value);
+					max_value = std::max(max_value, source.header(ni, nj, nk).max_value);
+				}
+				if (block_straddles(min_value, max_value, parameters.threshold)) source.lookup[(size_t(bricks) * bi + bj) * bricks + bk] = 0;
+			}
+		}
+	});
+	for (size_t brick = 0; brick < source.lookup.size(); brick++) {
+		if (source.lookup[brick] < 0) continue;
+		source.lookup[brick] = int32_t(source.active_bricks.size());
+		source.active_bricks.push_back({ int(brick / (size_t(bricks) * bricks)), int(brick / bricks % bricks), int(brick % bricks) });
+	}
+	extract_marching_cubes_bricks(source, parameters, mesh);
+}
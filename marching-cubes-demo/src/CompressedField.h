@@ -0,0 +1,60 @@
+#pragma once
+
+// Compressed scalar field, the whole grid split into bricks of sparse_brick_size^3 points, each brick packed on its own
+//  - Quantized modes store every point as an 8 or 12 bit fraction of the range of its brick
+//  - The lossless mode stores the difference of the bits of every point with the point before it in its row,
+//    packed with the fewest bits that hold all the differences of the brick
+// Bricks of a single value take no data in any mode. Rows decode on their own, so the extraction decodes the
+// points of a brick and the ones right after it without touching the rest of the neighbour bricks
+
+#include "SparseField.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+enum CompressedFieldMode {
+	compressed_quantized_8,
+	compressed_quantized_12,
+	compressed_lossless
+};
+
+typedef struct CompressedBrick {
+	// Quantized bricks decode to base + q * scale, lossless rows start from the bits of base
+	float base;
+	float scale;
+	// Range of the decoded points, bricks whose range and the ones of their neighbours stay on one side of the
+	// threshold are skipped by the extraction
+	float min_value;
+	float max_value;
+	// Offset of the packed points in the data of the field and their bits per point
+	uint32_t data_offset;
+	uint32_t bits;
+} CompressedBrick;
+
+typedef struct CompressedField {
+	int resolution = 0;
+	// Bricks per axis
+	int bricks = 0;
+	CompressedFieldMode mode = compressed_quantized_8;
+	std::vector<CompressedBrick> headers;
+	// Packed points of all the bricks, followed by padding so rows can be read 64 bits at a time
+	std::vector<uint8_t> data;
+} CompressedField;
+
+void build_compressed_field(const float* grid, int resolution, CompressedFieldMode mode, CompressedField& field);
+
+// Decodes the first count points of the row (a, b) of a brick
+void decode_compressed_row(const CompressedField& field, const CompressedBrick& brick, int a, int b, int count, float* values);
+// Decodes the whole field back into a resolution^3 grid
+void decompress_field(const CompressedField& field, std::vector<float>& grid);
+
+size_t compressed_field_memory(const CompressedField& field);
+// Largest difference between a point and its decoded value, 0 for the lossless mode
+float compressed_field_max_error(const CompressedField& field);
+
+// Marching cubes over the points [0, resolution)^3 of a compressed field, decoding the bricks the surface goes
+// through one at a time into a buffer of the thread walking them
+// Gives the triangles of the dense extraction of the decoded grid, numbered brick by brick
+// The parameters must have the resolution the field was built with, any other one gives an empty mesh
+void extract_marching_cubes_compressed(const CompressedField& field, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh);
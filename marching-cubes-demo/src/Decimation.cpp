@@ -0,0 +1,304 @@
+#include "Decimation.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <queue>
+
+// Symmetric 4x4 quadric as xx, xy, xz, xw, yy, yz, yw, zz, zw, ww, in doubles as the errors of nearly flat
+// collapses are small differences of large sums
+typedef struct Quadric {
+	double a[10] = {};
+} Quadric;
+
+static Quadric plane_quadric(Vector3 normal, float distance) {
+	double n[4] = { normal.x, normal.y, normal.z, distance };
+	Quadric quadric;
+	int e = 0;
+	for (int row = 0; row < 4; row++) {
+		for (int column = row; column < 4; column++) quadric.a[e++] = n[row] * n[column];
+	}
+	return quadric;
+}
+static void add_quadric(Quadric& quadric, const Quadric& other) {
+	for (int e = 0; e < 10; e++) quadric.a[e] += other.a[e];
+}
+static double quadric_error(const Quadric& q, Vector3 position) {
+	double x = position.x, y = position.y, z = position.z;
+	const double* a = q.a;
+	double error = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+		a[7] * z * z + 2 * a[8] * z + a[9];
+	return std::max(error, 0.0);
+}
+// Position where the quadric is smallest, false when its 3x3 part is nearly singular, as along flat or straight
+// parts of the surface where the planes leave the position free
+static bool quadric_minimum(const Quadric& q, Vector3& position) {
+	const double* a = q.a;
+	double c00 = a[4] * a[7] - a[5] * a[5];
+	double c01 = a[2] * a[5] - a[1] * a[7];
+	double c02 = a[1] * a[5] - a[2] * a[4];
+	double c11 = a[0] * a[7] - a[2] * a[2];
+	double c12 = a[1] * a[2] - a[0] * a[5];
+	double c22 = a[0] * a[4] - a[1] * a[1];
+	double determinant = a[0] * c00 + a[1] * c01 + a[2] * c02;
+	double trace = a[0] + a[4] + a[7];
+	if (!(fabs(determinant) > 1e-3 * trace * trace * trace)) return false;
+	position = Vector3(float(-(c00 * a[3] + c01 * a[6] + c02 * a[8]) / determinant),
+		float(-(c01 * a[3] + c11 * a[6] + c12 * a[8]) / determinant),
+		float(-(c02 * a[3] + c12 * a[6] + c22 * a[8]) / determinant));
+	return true;
+}
+
+// Collapse of vertex v1 into vertex v0, valid while neither of them changed since it was queued
+typedef struct Collapse {
+	double cost;
+	uint32_t v0, v1;
+	uint32_t version0, version1;
+	Vector3 position;
+} Collapse;
+typedef struct CheaperCollapse {
+	bool operator()(const Collapse& a, const Collapse& b) const { return a.cost > b.cost; }
+} CheaperCollapse;
+
+void decimate_mesh(MarchingCubesMesh& mesh, const DecimationParameters& parameters, DecimationStats& stats) {
+	auto decimation_start = std::chrono::high_resolution_clock::now();
+	stats = DecimationStats();
+	if (mesh.indices.empty()) {
+		stats.input_triangles = stats.output_triangles = mesh.vertices.size() / 3;
+		return;
+	}
+	std::vector<uint32_t>& indices = mesh.indices;
+	std::vector<MeshVertex>& vertices = mesh.vertices;
+	uint32_t vertex_count = uint32_t(vertices.size());
+	size_t triangle_count = indices.size() / 3;
+	size_t target = parameters.target_triangles ? parameters.target_triangles : size_t(double(triangle_count) * parameters.target_ratio);
+	double max_cost = double(parameters.max_error) * parameters.max_error;
+	stats.input_triangles = triangle_count;
+
+	// Triangles around every vertex as a range of refs, a collapse writes the new range of the remaining vertex
+	// at the end of refs
+	std::vector<uint32_t> ref_starts(vertex_count + 1, 0);
+	std::vector<uint32_t> ref_counts(vertex_count, 0);
+	for (uint32_t index : indices) ref_starts[index + 1]++;
+	for (uint32_t v = 0; v < vertex_count; v++) ref_starts[v + 1] += ref_starts[v];
+	std::vector<uint32_t> refs(indices.size());
+	refs.reserve(indices.size() * 2);
+	for (size_t corner = 0; corner < indices.size(); corner++) {
+		uint32_t v = indices[corner];
+		refs[ref_starts[v] + ref_counts[v]++] = uint32_t(corner / 3);
+	}
+	std::vector<uint8_t> removed_triangles(triangle_count, 0);
+	std::vector<uint8_t> removed_vertices(vertex_count, 0);
+	std::vector<uint32_t> versions(vertex_count, 0);
+
+	// Quadrics of the planes of the triangles around every vertex, degenerate triangles have no plane
+	std::vector<Quadric> quadrics(vertex_count);
+	for (size_t t = 0; t < triangle_count; t++) {
+		Vector3 p0 = vertices[indices[t * 3]].position;
+		Vector3 p1 = vertices[indices[t * 3 + 1]].position;
+		Vector3 p2 = vertices[indices[t * 3 + 2]].position;
+		Vector3 normal = cross(p1 - p0, p2 - p0);
+		if (dot(normal, normal) == 0) continue;
+		normal = normalize(normal);
+		Quadric quadric = plane_quadric(normal, -dot(normal, p0));
+		for (int c = 0; c < 3; c++) add_quadric(quadrics[indices[t * 3 + c]], quadric);
+	}
+
+	// Neighbours of a vertex through its remaining triangles, and whether any edge to them is open, used by a
+	// single triangle. Vertices are marked with the current epoch while they are gathered
+	std::vector<uint32_t> marks(vertex_count, 0);
+	std::vector<uint32_t> uses(vertex_count, 0);
+	uint32_t epoch = 0;
+	std::vector<uint32_t> neighbours;
+	auto gather_neighbours = [&](uint32_t v, bool& border) {
+		epoch++;
+		neighbours.clear();
+		border = false;
+		for (uint32_t r = ref_starts[v]; r < ref_starts[v] + ref_counts[v]; r++) {
+			uint32_t t = refs[r];
+			if (removed_triangles[t]) continue;
+			for (int c = 0; c < 3; c++) {
+				uint32_t n = indices[t * 3 + c];
+				if (n == v) continue;
+				if (marks[n] != epoch) {
+					marks[n] = epoch;
+					uses[n] = 0;
+					neighbours.push_back(n);
+				}
+				uses[n]++;
+			}
+		}
+		for (uint32_t n : neighbours) border |= uses[n] == 1;
+	};
+	std::vector<uint8_t> locked(vertex_count, 0);
+	if (parameters.preserve_borders) {
+		for (uint32_t v = 0; v < vertex_count; v++) {
+			bool border;
+			gather_neighbours(v, border);
+			locked[v] = border;
+		}
+	}
+
+	// Collapses keep the locked vertex where it is, otherwise they move to the minimum of the summed quadric,
+	// or to the best of the two ends and the middle of the edge when it has none near the edge
+	std::priority_queue<Collapse, std::vector<Collapse>, CheaperCollapse> queue;
+	auto queue_collapse = [&](uint32_t a, uint32_t b) {
+		if (locked[a] && locked[b]) return;
+		if (locked[b]) std::swap(a, b);
+		Quadric quadric = quadrics[a];
+		add_quadric(quadric, quadrics[b]);
+		Vector3 pa = vertices[a].position;
+		Vector3 pb = vertices[b].position;
+		Collapse collapse;
+		collapse.v0 = a;
+		collapse.v1 = b;
+		collapse.version0 = versions[a];
+		collapse.version1 = versions[b];
+		collapse.position = pa;
+		if (!locked[a]) {
+			Vector3 middle = 0.5f * (pa + pb);
+			bool found = quadric_minimum(quadric, collapse.position);
+			Vector3 offset = collapse.position - middle;
+			if (!found || dot(offset, offset) > dot(pb - pa, pb - pa)) {
+				const Vector3 candidates[3] = { pa, pb, middle };
+				double best = -1;
+				for (Vector3 candidate : candidates) {
+					double error = quadric_error(quadric, candidate);
+					if (best < 0 || error < best) {
+						best = error;
+						collapse.position = candidate;
+					}
+				}
+			}
+		}
+		collapse.cost = quadric_error(quadric, collapse.position);
+		queue.push(collapse);
+	};
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		bool border;
+		gather_neighbours(v, border);
+		for (uint32_t n : neighbours) {
+			if (n > v) queue_collapse(v, n);
+		}
+	}
+
+	// Whether moving vertex v to position folds any of its triangles not shared with vertex other over
+	auto folds = [&](uint32_t v, uint32_t other, Vector3 position) {
+		for (uint32_t r = ref_starts[v]; r < ref_starts[v] + ref_counts[v]; r++) {
+			uint32_t t = refs[r];
+			if (removed_triangles[t]) continue;
+			const uint32_t* triangle = &indices[t * 3];
+			if (triangle[0] == other || triangle[1] == other || triangle[2] == other) continue;
+			Vector3 before[3], after[3];
+			for (int c = 0; c < 3; c++) {
+				before[c] = after[c] = vertices[triangle[c]].position;
+				if (triangle[c] == v) after[c] = position;
+			}
+			Vector3 normal_before = cross(before[1] - before[0], before[2] - before[0]);
+			Vector3 normal_after = cross(after[1] - after[0], after[2] - after[0]);
+			if (dot(normal_before, normal_after) <= 0) return true;
+		}
+		return false;
+	};
+
+	size_t live_triangles = triangle_count;
+	while (live_triangles > target && !queue.empty()) {
+		Collapse collapse = queue.top();
+		queue.pop();
+		uint32_t v0 = collapse.v0;
+		uint32_t v1 = collapse.v1;
+		if (removed_vertices[v0] || removed_vertices[v1] || versions[v0] != collapse.version0 || versions[v1] != collapse.version1) continue;
+		if (collapse.cost > max_cost) break;
+
+		// The edge must only have the neighbours of the triangles along it in common, more would pinch the surface
+		bool border;
+		gather_neighbours(v0, border);
+		uint32_t shared_triangles = 0;
+		uint32_t shared_neighbours = 0;
+		for (uint32_t r = ref_starts[v1]; r < ref_starts[v1] + ref_counts[v1]; r++) {
+			uint32_t t = refs[r];
+			if (removed_triangles[t]) continue;
+			for (int c = 0; c < 3; c++) {
+				uint32_t n = indices[t * 3 + c];
+				if (n == v0) shared_triangles++;
+				if (n == v0 || n == v1 || marks[n] != epoch) continue;
+				marks[n] = epoch - 1;
+				shared_neighbours++;
+			}
+		}
+		if (!shared_triangles || shared_neighbours != shared_triangles) continue;
+		if (folds(v0, v1, collapse.position) || folds(v1, v0, collapse.position)) continue;
+
+		// Collapse, the triangles along the edge go away and the other triangles of v1 move to v0
+		if (!locked[v0]) vertices[v0].normal = normalize(vertices[v0].normal + vertices[v1].normal);
+		vertices[v0].position = collapse.position;
+		add_quadric(quadrics[v0], quadrics[v1]);
+		removed_vertices[v1] = 1;
+		versions[v0]++;
+		versions[v1]++;
+		for (uint32_t r = ref_starts[v1]; r < ref_starts[v1] + ref_counts[v1]; r++) {
+			uint32_t t = refs[r];
+			if (removed_triangles[t]) continue;
+			uint32_t* triangle = &indices[t * 3];
+			if (triangle[0] == v0 || triangle[1] == v0 || triangle[2] == v0) {
+				removed_triangles[t] = 1;
+				live_triangles--;
+				continue;
+			}
+			for (int c = 0; c < 3; c++) {
+				if (triangle[c] == v1) triangle[c] = v0;
+			}
+		}
+		uint32_t start = uint32_t(refs.size());
+		for (uint32_t v : { v0, v1 }) {
+			for (uint32_t r = ref_starts[v]; r < ref_starts[v] + ref_counts[v]; r++) {
+				if (!removed_triangles[refs[r]]) refs.push_back(refs[r]);
+			}
+		}
+		ref_starts[v0] = start;
+		ref_counts[v0] = uint32_t(refs.size()) - start;
+		stats.collapses++;
+
+		gather_neighbours(v0, border);
+		for (uint32_t n : neighbours) queue_collapse(v0, n);
+	}
+
+	// Compact the remaining vertices and triangles, both in their original order
+	std::vector<uint32_t> remap(vertex_count, 0);
+	for (size_t t = 0; t < triangle_count; t++) {
+		if (removed_triangles[t]) continue;
+		for (int c = 0; c < 3; c++) remap[indices[t * 3 + c]] = 1;
+	}
+	uint32_t kept_vertices = 0;
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		if (!remap[v]) continue;
+		vertices[kept_vertices] = vertices[v];
+		remap[v] = kept_vertices++;
+	}
+	vertices.resize(kept_vertices);
+	size_t kept_indices = 0;
+	for (size_t t = 0; t < triangle_count; t++) {
+		if (removed_triangles[t]) continue;
+		for (int c = 0; c < 3; c++) indices[kept_indices++] = remap[indices[t * 3 + c]];
+	}
+	indices.resize(kept_indices);
+	stats.output_triangles = live_triangles;
+	stats.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decimation_start).count();
+}
+
+void decimate_meshes(const std::vector<MarchingCubesMesh*>& meshes, const DecimationParameters& parameters, DecimationStats& stats) {
+	auto decimation_start = std::chrono::high_resolution_clock::now();
+	std::vector<DecimationStats> mesh_stats(meshes.size());
+	parallel_for(int(meshes.size()), [&](int m) {
+		decimate_mesh(*meshes[m], parameters, mesh_stats[m]);
+	});
+	stats = DecimationStats();
+	for (const DecimationStats& single : mesh_stats) {
+		stats.input_triangles += single.input_triangles;
+		stats.output_triangles += single.output_triangles;
+		stats.collapses += single.collapses;
+	}
+	stats.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decimation_start).count();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Mesh simplification with the quadric error metric of Garland and Heckbert
+// Every vertex starts with the quadric of the planes of the triangles around it, and collapsing an edge sums the
+// quadrics of its two vertices and moves the remaining vertex to where that quadric is smallest. Edges are
+// collapsed cheapest first from a priority queue until the mesh is down to its target triangle count or the
+// cheapest collapse left goes over the error bound
+// Collapses that would fold a triangle over or pinch the surface into a non manifold edge are skipped
+// With borders preserved the vertices of open edges, where a chunk or a grid ends, never move or go away, so
+// meshes meeting there still meet after decimation
+
+#include "MarchingCubes.h"
+
+#include <vector>
+#include <cstddef>
+
+typedef struct DecimationParameters {
+	// Collapses stop once the mesh is down to target_ratio of its triangles, or to target_triangles when it is set
+	float target_ratio = 0.25f;
+	size_t target_triangles = 0;
+	// Collapses stop before the first one whose error goes over max_error, the error being the root of the summed
+	// squared distances of the moved vertex to the planes of the original triangles it now stands for
+	float max_error = 1e30f;
+	bool preserve_borders = true;
+} DecimationParameters;
+
+typedef struct DecimationStats {
+	size_t input_triangles = 0;
+	size_t output_triangles = 0;
+	size_t collapses = 0;
+	// Milliseconds, wall clock time when meshes are decimated concurrently
+	double time = 0;
+} DecimationStats;
+
+// Decimates an indexed mesh in place, keeping the order of the remaining vertices and triangles
+// Triangle soups have no shared vertices to collapse and are left as they are
+void decimate_mesh(MarchingCubesMesh& mesh, const DecimationParameters& parameters, DecimationStats& stats);
+
+// Decimates independent meshes concurrently, one task per mesh, with the stats summed over all of them
+void decimate_meshes(const std::vector<MarchingCubesMesh*>& meshes, const DecimationParameters& parameters, DecimationStats& stats);
@@ -0,0 +1,127 @@
+#include "DualContouring.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define QEF_AVX
+#endif
+
+// Arithmetic of the solver on one cell at a time
+typedef struct QefScalarLanes {
+	typedef float Value;
+	typedef bool Mask;
+	static const int width = 1;
+	static Value load(const float* values) { return *values; }
+	static void store(float* values, Value value) { *values = value; }
+	static Value set(float value) { return value; }
+	static Value add(Value a, Value b) { return a + b; }
+	static Value sub(Value a, Value b) { return a - b; }
+	static Value mul(Value a, Value b) { return a * b; }
+	static Value div(Value a, Value b) { return a / b; }
+	static Value sqrt(Value a) { return sqrtf(a); }
+	static Value abs(Value a) { return fabsf(a); }
+	static Value min(Value a, Value b) { return a < b ? a : b; }
+	static Value max(Value a, Value b) { return a > b ? a : b; }
+	static Mask less(Value a, Value b) { return a < b; }
+	static Value select(Mask mask, Value a, Value b) { return mask ? a : b; }
+} QefScalarLanes;
+
+#if defined(QEF_AVX)
+// The same arithmetic on 8 cells at a time
+typedef struct QefAvxLanes {
+	typedef __m256 Value;
+	typedef __m256 Mask;
+	static const int width = 8;
+	static Value load(const float* values) { return _mm256_loadu_ps(values); }
+	static void store(float* values, Value value) { _mm256_storeu_ps(values, value); }
+	static Value set(float value) { return _mm256_set1_ps(value); }
+	static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+	static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+	static Value div(Value a, Value b) { return _mm256_div_ps(a, b); }
+	static Value sqrt(Value a) { return _mm256_sqrt_ps(a); }
+	static Value abs(Value a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static Value min(Value a, Value b) { return _mm256_min_ps(a, b); }
+	static Value max(Value a, Value b) { return _mm256_max_ps(a, b); }
+	static Mask less(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Value select(Mask mask, Value a, Value b) { return _mm256_blendv_ps(b, a, mask); }
+} QefAvxLanes;
+#endif
+
+// Jacobi rotation zeroing a[p][q] of the symmetric matrix a, accumulated into the eigenvectors v
+// Off diagonal elements that are already about zero get the identity rotation
+template <typename Lanes>
+static void jacobi_rotation(typename Lanes::Value a[3][3], typename Lanes::Value v[3][3], int p, int q) {
+	typedef typename Lanes::Value Value;
+	int r = 3 - p - q;
+	Value apq = a[p][q];
+	auto negligible = Lanes::less(Lanes::abs(apq), Lanes::set(1e-10f));
+	Value theta = Lanes::div(Lanes::sub(a[q][q], a[p][p]), Lanes::mul(Lanes::set(2.0f), Lanes::select(negligible, Lanes::set(1.0f), apq)));
+	Value sign = Lanes::select(Lanes::less(theta, Lanes::set(0.0f)), Lanes::set(-1.0f), Lanes::set(1.0f));
+	Value t = Lanes::div(sign, Lanes::add(Lanes::abs(theta), Lanes::sqrt(Lanes::add(Lanes::mul(theta, theta), Lanes::set(1.0f)))));
+	t = Lanes::select(negligible, Lanes::set(0.0f), t);
+	Value c = Lanes::div(Lanes::set(1.0f), Lanes::sqrt(Lanes::add(Lanes::mul(t, t), Lanes::set(1.0f))));
+	Value s = Lanes::mul(t, c);
+	a[p][p] = Lanes::sub(a[p][p], Lanes::mul(t, apq));
+	a[q][q] = Lanes::add(a[q][q], Lanes::mul(t, apq));
+	a[p][q] = a[q][p] = Lanes::set(0.0f);
+	Value arp = a[r][p];
+	Value arq = a[r][q];
+	a[r][p] = a[p][r] = Lanes::sub(Lanes::mul(c, arp), Lanes::mul(s, arq));
+	a[r][q] = a[q][r] = Lanes::add(Lanes::mul(s, arp), Lanes::mul(c, arq));
+	for (int row = 0; row < 3; row++) {
+		Value vp = v[row][p];
+		Value vq = v[row][q];
+		v[row][p] = Lanes::sub(Lanes::mul(c, vp), Lanes::mul(s, vq));
+		v[row][q] = Lanes::add(Lanes::mul(s, vp), Lanes::mul(c, vq));
+	}
+}
+
+// Solves the quadrics of cells n to n + Lanes::width of the batch
+template <typename Lanes>
+static void solve_qefs(QefBatch& batch, int n) {
+	typedef typename Lanes::Value Value;
+	const int symmetric[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+	Value ata[3][3], a[3][3], v[3][3];
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 3; column++) {
+			ata[row][column] = a[row][column] = Lanes::load(batch.ata[symmetric[row][column]] + n);
+			v[row][column] = Lanes::set(row == column ? 1.0f : 0.0f);
+		}
+	}
+	// A few sweeps are enough for 3x3 matrices to the precision of floats
+	for (int sweep = 0; sweep < 4; sweep++) {
+		jacobi_rotation<Lanes>(a, v, 0, 1);
+		jacobi_rotation<Lanes>(a, v, 0, 2);
+		jacobi_rotation<Lanes>(a, v, 1, 2);
+	}
+
+	// Minimizer around the mass point, mass + V D+ V^T (A^T b - A^T A mass)
+	Value mass[3], residual[3], projected[3];
+	for (int row = 0; row < 3; row++) mass[row] = Lanes::load(batch.mass[row] + n);
+	for (int row = 0; row < 3; row++) {
+		residual[row] = Lanes::load(batch.atb[row] + n);
+		for (int column = 0; column < 3; column++) residual[row] = Lanes::sub(residual[row], Lanes::mul(ata[row][column], mass[column]));
+	}
+	for (int e = 0; e < 3; e++) {
+		projected[e] = Lanes::set(0.0f);
+		for (int row = 0; row < 3; row++) projected[e] = Lanes::add(projected[e], Lanes::mul(v[row][e], residual[row]));
+		auto singular = Lanes::less(a[e][e], Lanes::set(qef_singular_threshold));
+		projected[e] = Lanes::select(singular, Lanes::set(0.0f), Lanes::div(projected[e], Lanes::select(singular, Lanes::set(1.0f), a[e][e])));
+	}
+	for (int row = 0; row < 3; row++) {
+		Value solution = mass[row];
+		for (int e = 0; e < 3; e++) solution = Lanes::add(solution, Lanes::mul(v[row][e], projected[e]));
+		solution = Lanes::min(Lanes::max(solution, Lanes::set(0.0f)), Lanes::set(1.0f));
+		Lanes::store(batch.solutions[row] + n, solution);
+	}
+}
+
+void solve_qef_batch(QefBatch& batch) {
+	int n = 0;
+#if defined(QEF_AVX)
+	for (; n + QefAvxLanes::width <= batch.count; n += QefAvxLanes::width) solve_qefs<QefAvxLanes>(batch, n);
+#endif
+	for (; n < batch.count; n++) solve_qefs<QefScalarLanes>(batch, n);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// Dual Contouring over the same grid layout as marching cubes
+// The Hermite data of every active cell, the crossings of its edges and the gradient normals of the field there,
+// make up a quadric error function whose minimizer is the vertex of the cell, so the vertices land on the edges
+// and corners the crossings agree on instead of being rounded off like the mean of Surface Nets
+// The quadric is solved around the mass point of the crossings with the pseudo-inverse of its 3x3 matrix, from a
+// Jacobi eigen decomposition dropping the directions the normals leave unconstrained, and the vertex is clamped
+// to its cell. Cells are solved in batches, 8 at a time with AVX when the compiler targets it, as both projects do
+// Cells and quads are the ones of Surface Nets
+
+#include "SurfaceNets.h"
+#include "GradientNormals.h"
+
+const int qef_batch_size = 64;
+
+// Eigenvalues of the quadric below this are dropped, the normals are unit length so a direction constrained
+// by a single crossing has an eigenvalue of about 1
+const float qef_singular_threshold = 0.1f;
+
+// Quadrics of a batch of cells waiting to be solved, in the cell coordinates (k, i, j) from the cell corner
+typedef struct QefBatch {
+	int count = 0;
+	uint32_t vertices[qef_batch_size];
+	int32_t i[qef_batch_size];
+	int32_t j[qef_batch_size];
+	int32_t k[qef_batch_size];
+	// A^T A as xx, xy, xz, yy, yz, zz, A^T b and the mass point of the crossings
+	float ata[6][qef_batch_size];
+	float atb[3][qef_batch_size];
+	float mass[3][qef_batch_size];
+	// Minimizers written by solve_qef_batch
+	float solutions[3][qef_batch_size];
+} QefBatch;
+
+// Writes the minimizers of the quadrics of the batch to its solutions, clamped to the cell
+void solve_qef_batch(QefBatch& batch);
+
+template <typename Scalar, typename Placement, typename VertexFormat>
+void generate_dual_contouring_kernel(const Scalar* grid, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh) {
+	int resolution = parameters.resolution;
+	bool gradient = parameters.gradient_normals;
+	if (resolution < 2) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	MarchingCubesWorkspace& workspace = marching_cubes_workspace();
+	size_t triangle_count = find_dual_cells(grid, parameters, workspace);
+	std::vector<uint32_t>& indices = parameters.indexed ? mesh.indices : workspace.indices;
+	indices.resize(triangle_count * 3);
+
+	// Every slab gathers the quadrics of its cells from the crossings and the gradients of the eight corners,
+	// then solves them a batch at a time
+	// Gradient normals are the mean of the normals of the crossings
+	float half_size = parameters.cube_size / 2.0f;
+	float last = float(resolution - 1);
+	const int* corner_offsets = surface_nets_corners();
+	size_t offsets[8];
+	for (int corner = 0; corner < 8; corner++) {
+		offsets[corner] = (size_t(resolution) * (corner >> 2) + ((corner >> 1) & 1)) * resolution + (corner & 1);
+	}
+	parallel_for(int(workspace.slabs.size()), [&](int s) {
+		QefBatch batch;
+		auto flush = [&]() {
+			solve_qef_batch(batch);
+			for (int n = 0; n < batch.count; n++) {
+				workspace.positions[batch.vertices[n]] = Vector3(map(float(batch.k[n]) + batch.solutions[0][n], 0.0f, last, -half_size, half_size),
+					map(float(batch.i[n]) + batch.solutions[1][n], 0.0f, last, -half_size, half_size),
+					map(float(batch.j[n]) + batch.solutions[2][n], 0.0f, last, -half_size, half_size));
+			}
+			batch.count = 0;
+		};
+		for_each_dual_cell(workspace, resolution, s, [&](int i, int j, int k, int cube_index, uint32_t id) {
+			const Scalar* cell = grid + (size_t(resolution) * i + j) * resolution + k;
+			float values[8];
+			Vector3 gradients[8];
+			for (int corner = 0; corner < 8; corner++) {
+				values[corner] = float(cell[offsets[corner]]);
+				gradients[corner] = point_gradient(grid, resolution, i + (corner >> 2), j + ((corner >> 1) & 1), k + (corner & 1));
+			}
+			float ata[6] = {};
+			Vector3 atb, mass, normal_sum;
+			int crossing_count = 0;
+			for (int edges = edgeTable[cube_index]; edges; edges &= edges - 1) {
+				const int* edge = cube_edges[lowest_bit(uint64_t(edges))];
+				int corner = edge[0] << 2 | edge[1] << 1 | edge[2];
+				int end = corner + corner_offsets[edge[3]];
+				float fraction = Placement::fraction(values[corner], values[end], parameters);
+				Vector3 point(float(edge[2]) + (edge[3] == 0 ? fraction : 0.0f),
+					float(edge[0]) + (edge[3] == 2 ? fraction : 0.0f),
+					float(edge[1]) + (edge[3] == 1 ? fraction : 0.0f));
+				Vector3 normal = normalize(gradients[corner] + fraction * (gradients[end] - gradients[corner]));
+				ata[0] += normal.x * normal.x;
+				ata[1] += normal.x * normal.y;
+				ata[2] += normal.x * normal.z;
+				ata[3] += normal.y * normal.y;
+				ata[4] += normal.y * normal.z;
+				ata[5] += normal.z * normal.z;
+				atb = atb + dot(normal, point) * normal;
+				mass = mass + point;
+				normal_sum = normal_sum + normal;
+				crossing_count++;
+			}
+			mass = mass / float(crossing_count);
+			int n = batch.count++;
+			batch.vertices[n] = id;
+			batch.i[n] = i;
+			batch.j[n] = j;
+			batch.k[n] = k;
+			for (int e = 0; e < 6; e++) batch.ata[e][n] = ata[e];
+			batch.atb[0][n] = atb.x;
+			batch.atb[1][n] = atb.y;
+			batch.atb[2][n] = atb.z;
+			batch.mass[0][n] = mass.x;
+			batch.mass[1][n] = mass.y;
+			batch.mass[2][n] = mass.z;
+			if (gradient) workspace.normals[id] = normalize(normal_sum);
+			if (batch.count == qef_batch_size) flush();
+		});
+		if (batch.count) flush();
+	});
+
+	write_dual_quads(workspace, resolution, indices);
+	write_marching_cubes_mesh(workspace, indices, parameters.indexed, gradient, format, mesh);
+}
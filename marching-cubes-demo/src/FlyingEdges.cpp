@@ -0,0 +1,140 @@
+#include "FlyingEdges.h"
+
+// Crossed edges of a row leading to the next row, compared point by point within the trim of both rows, which
+// widens the points first to last of the row
+static uint32_t count_pair_crossings(const MarchingCubesWorkspace& workspace, int resolution, size_t row, size_t next_row, int& first, int& last) {
+	int words = classification_words(resolution);
+	size_t pair[2] = { row, next_row };
+	int pair_first, pair_last;
+	trim_flying_edges_rows(workspace, resolution, pair, 2, pair_first, pair_last);
+	if (pair_first > pair_last) return 0;
+	first = std::min(first, pair_first);
+	last = std::max(last, pair_last);
+	const uint64_t* bits = workspace.point_bits.data() + row * words;
+	const uint64_t* next_bits = workspace.point_bits.data() + next_row * words;
+	uint32_t count = 0;
+	for (int w = pair_first >> 6; w <= pair_last >> 6; w++) count += bit_count(bits[w] ^ next_bits[w]);
+	return count;
+}
+
+size_t count_flying_edges(const MarchingCubesParameters& parameters, MarchingCubesWorkspace& workspace) {
+	int resolution = parameters.resolution;
+	int cells = resolution - 1;
+	int words = classification_words(resolution);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	const int* triangle_count_table = triangle_counts();
+	const std::vector<MarchingCubesSlab>& slabs = workspace.slabs;
+	int slab_count = int(slabs.size());
+	workspace.row_vertex_counts.resize(size_t(resolution) * resolution);
+	workspace.row_vertex_offsets.resize(size_t(resolution) * resolution);
+	workspace.cell_rows.resize(size_t(cells) * cells);
+
+	// Every row counts its crossed z and y edges within the trims of the rows they lead to, and every row of cells trims itself to the rows around it and
+	// counts the triangles of its active cells
+	parallel_for(slab_count, [&](int s) {
+		int last_point_layer = s == slab_count - 1 ? resolution : slabs[s].last_layer;
+		for (int i = slabs[s].first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				size_t row = size_t(resolution) * i + j;
+				FlyingEdgesRow& edge_row = workspace.edge_rows[row];
+				edge_row.first = edge_row.left;
+				edge_row.last = edge_row.right;
+				edge_row.z_count = j + 1 < resolution ? count_pair_crossings(workspace, resolution, row, row + 1, edge_row.first, edge_row.last) : 0;
+				edge_row.y_count = i + 1 < resolution ? count_pair_crossings(workspace, resolution, row, row + resolution, edge_row.first, edge_row.last) : 0;
+				workspace.row_vertex_counts[row] = edge_row.x_count + edge_row.z_count + edge_row.y_count;
+				if (i >= cells || j >= cells) continue;
+
+				FlyingEdgesCellRow& cell_row = workspace.cell_rows[size_t(cells) * i + j];
+				size_t rows[4] = { row, row + 1, row + resolution, row + resolution + 1 };
+				trim_flying_edges_rows(workspace, resolution, rows, 4, cell_row.first, cell_row.last);
+				cell_row.triangle_count = 0;
+				const uint64_t* row_bits[4];
+				for (int r = 0; r < 4; r++) row_bits[r] = point_bits + rows[r] * words;
+				for (int w = cell_row.first >> 6; cell_row.first < cell_row.last && w <= (cell_row.last - 1) >> 6; w++) {
+					for (uint64_t active = active_cell_word(row_bits[0], row_bits[1], row_bits[2], row_bits[3], cells, w); active; active &= active - 1) {
+						int k = w * 64 + lowest_bit(active);
+						cell_row.triangle_count += triangle_count_table[cell_cube_index(row_bits[0], row_bits[1], row_bits[2], row_bits[3], k)];
+					}
+				}
+			}
+		}
+	});
+
+	// Prefix sums give every row its first vertex id and every row of cells its range of the index buffer
+	uint32_t vertex_count = 0;
+	for (size_t row = 0; row < workspace.row_vertex_counts.size(); row++) {
+		workspace.row_vertex_offsets[row] = vertex_count;
+		vertex_count += workspace.row_vertex_counts[row];
+	}
+	size_t triangle_count = 0;
+	for (FlyingEdgesCellRow& cell_row : workspace.cell_rows) {
+		cell_row.index_offset = triangle_count * 3;
+		triangle_count += cell_row.triangle_count;
+	}
+	workspace.positions.resize(vertex_count);
+	if (parameters.gradient_normals) workspace.normals.resize(vertex_count);
+	return triangle_count;
+}
+
+// Edge streams of a row of cells, the x edges of its rows (i, j), (i, j + 1), (i + 1, j) and (i + 1, j + 1), the z
+// edges of rows (i, j) and (i + 1, j) and the y edges of rows (i, j) and (i, j + 1)
+static int edge_stream(const int* edge) {
+	int di = edge[0], dj = edge[1];
+	return edge[3] == 0 ? di * 2 + dj : edge[3] == 1 ? 4 + di : 6 + dj;
+}
+
+void write_flying_edges_triangles(const MarchingCubesWorkspace& workspace, int resolution, std::vector<uint32_t>& indices) {
+	int cells = resolution - 1;
+	int words = classification_words(resolution);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	const std::vector<MarchingCubesSlab>& slabs = workspace.slabs;
+	int streams[12];
+	for (int e = 0; e < 12; e++) streams[e] = edge_stream(cube_edges[e]);
+
+	// Every row of cells walks the words of its trim keeping the id of the first crossing of every edge stream in
+	// the word, the id of an edge of a cell adds the crossings of its stream before it
+	// No stream crosses before the trim, so they all start from the first id of their row and axis
+	parallel_for(int(slabs.size()), [&](int s) {
+		for (int i = slabs[s].first_layer; i < slabs[s].last_layer; i++) {
+			for (int j = 0; j < cells; j++) {
+				const FlyingEdgesCellRow& cell_row = workspace.cell_rows[size_t(cells) * i + j];
+				if (!cell_row.triangle_count) continue;
+				uint32_t* triangle_indices = indices.data() + cell_row.index_offset;
+				size_t row = size_t(resolution) * i + j;
+				size_t rows[4] = { row, row + 1, row + resolution, row + resolution + 1 };
+				const uint64_t* row_bits[4];
+				uint32_t ids[8];
+				for (int r = 0; r < 4; r++) {
+					row_bits[r] = point_bits + rows[r] * words;
+					ids[r] = workspace.row_vertex_offsets[rows[r]];
+				}
+				ids[4] = ids[0] + workspace.edge_rows[rows[0]].x_count;
+				ids[5] = ids[2] + workspace.edge_rows[rows[2]].x_count;
+				ids[6] = ids[4] + workspace.edge_rows[rows[0]].z_count;
+				ids[7] = ids[1] + workspace.edge_rows[rows[1]].x_count + workspace.edge_rows[rows[1]].z_count;
+				for (int w = cell_row.first >> 6; w <= (cell_row.last - 1) >> 6; w++) {
+					uint64_t crossings[8], unused;
+					row_crossings(row_bits[0], row_bits[1], row_bits[2], w, words, resolution, crossings[0], crossings[4], crossings[6]);
+					row_crossings(row_bits[1], nullptr, row_bits[3], w, words, resolution, crossings[1], unused, crossings[7]);
+					row_crossings(row_bits[2], row_bits[3], nullptr, w, words, resolution, crossings[2], crossings[5], unused);
+					row_crossings(row_bits[3], nullptr, nullptr, w, words, resolution, crossings[3], unused, unused);
+					for (uint64_t active = active_cell_word(row_bits[0], row_bits[1], row_bits[2], row_bits[3], cells, w); active; active &= active - 1) {
+						int bit = lowest_bit(active);
+						int cube_index = cell_cube_index(row_bits[0], row_bits[1], row_bits[2], row_bits[3], w * 64 + bit);
+						uint32_t cube_vertices[12];
+						for (int edges = edgeTable[cube_index]; edges; edges &= edges - 1) {
+							int e = lowest_bit(uint64_t(edges));
+							int point = bit + cube_edges[e][2];
+							uint64_t before = point == 64 ? ~uint64_t(0) : (uint64_t(1) << point) - 1;
+							cube_vertices[e] = ids[streams[e]] + bit_count(crossings[streams[e]] & before);
+						}
+						for (int m = 0; triTable[cube_index][m] != -1; m++) {
+							*triangle_indices++ = cube_vertices[triTable[cube_index][m]];
+						}
+					}
+					for (int stream = 0; stream < 8; stream++) ids[stream] += bit_count(crossings[stream]);
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// Flying Edges over the same grid layout as marching cubes, running along the rows of points instead of cell by cell
+//  - The first pass classifies every row and its x edges, counting the crossed ones and trimming the row to the
+//    points between its first and last crossing, outside of which the row is all on the side of its ends
+//  - The second pass counts the crossed z and y edges of every row and the triangles of every row of cells, only
+//    between the trims of the rows involved, so rows away from the surface cost a few comparisons
+//  - Prefix sums give every row its first vertex and every row of cells its first triangle
+//  - The last passes write the vertices of every row and the triangles of every row of cells at those offsets
+// Rows are independent of each other in every pass, they are split into slabs of layers to run in parallel
+// The vertices of a row are numbered x edges first, then z and y edges, each in point order, so the id of an edge
+// is the number of crossings before it along its row and cells get the ids of their 12 edges without an edge cache
+// Triangles come from triTable in the same order as the marching cubes kernel, the surface is the same one and
+// only the order of the vertices differs
+
+#include "MarchingCubesKernel.h"
+
+#include <algorithm>
+
+// Points [first, last] of a set of rows their crossings along any axis can be in, both when the rows cannot cross
+// Before the smallest left trim and from the largest right trim on, every row stays on the side of its end, so
+// nothing crosses there unless the rows disagree at that end
+inline void trim_flying_edges_rows(const MarchingCubesWorkspace& workspace, int resolution, const size_t* rows, int count, int& first, int& last) {
+	int words = classification_words(resolution);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	first = resolution - 1;
+	last = 0;
+	bool left_differs = false;
+	bool right_differs = false;
+	for (int r = 0; r < count; r++) {
+		const FlyingEdgesRow& edge_row = workspace.edge_rows[rows[r]];
+		first = std::min(first, edge_row.left);
+		last = std::max(last, edge_row.right);
+		left_differs |= point_bit(point_bits + rows[r] * words, 0) != point_bit(point_bits + rows[0] * words, 0);
+		right_differs |= point_bit(point_bits + rows[r] * words, resolution - 1) != point_bit(point_bits + rows[0] * words, resolution - 1);
+	}
+	if (left_differs) first = 0;
+	if (right_differs) last = resolution - 1;
+}
+
+// Second pass and prefix sums, counts the crossed z and y edges of every row and the triangles of every row of
+// cells, then numbers the vertices and sizes the shared vertex buffers. Returns the triangle count
+size_t count_flying_edges(const MarchingCubesParameters& parameters, MarchingCubesWorkspace& workspace);
+
+// Writes the triangles of every row of cells into its range of indices
+void write_flying_edges_triangles(const MarchingCubesWorkspace& workspace, int resolution, std::vector<uint32_t>& indices);
+
+template <typename Scalar, typename Placement, typename VertexFormat>
+void generate_flying_edges_kernel(const Scalar* grid, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh) {
+	int resolution = parameters.resolution;
+	float threshold = parameters.threshold;
+	bool gradient = parameters.gradient_normals;
+	if (resolution < 2) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	MarchingCubesWorkspace& workspace = marching_cubes_workspace();
+	std::vector<MarchingCubesSlab>& slabs = workspace.slabs;
+	int cells = resolution - 1;
+	int slab_count = std::min(cells, get_thread_count() * 4);
+	slabs.resize(slab_count);
+	for (int s = 0; s < slab_count; s++) {
+		slabs[s].first_layer = cells * s / slab_count;
+		slabs[s].last_layer = cells * (s + 1) / slab_count;
+	}
+
+	// First pass, classify every row of points and trim it to its crossed x edges
+	int words = classification_words(resolution);
+	workspace.point_bits.resize(size_t(resolution) * resolution * words);
+	workspace.edge_rows.resize(size_t(resolution) * resolution);
+	parallel_for(slab_count, [&](int s) {
+		int last_point_layer = s == slab_count - 1 ? resolution : slabs[s].last_layer;
+		for (int i = slabs[s].first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				size_t row = size_t(resolution) * i + j;
+				uint64_t* row_bits = &workspace.point_bits[row * words];
+				classify_points(grid + row * resolution, resolution, threshold, row_bits);
+				FlyingEdgesRow& edge_row = workspace.edge_rows[row];
+				edge_row.left = resolution - 1;
+				edge_row.right = 0;
+				edge_row.x_count = 0;
+				for (int w = 0; w < words; w++) {
+					uint64_t x_crossings, z_crossings, y_crossings;
+					row_crossings(row_bits, nullptr, nullptr, w, words, resolution, x_crossings, z_crossings, y_crossings);
+					if (!x_crossings) continue;
+					edge_row.left = std::min(edge_row.left, w * 64 + lowest_bit(x_crossings));
+					edge_row.right = w * 64 + highest_bit(x_crossings) + 1;
+					edge_row.x_count += bit_count(x_crossings);
+				}
+			}
+		}
+	});
+
+	size_t triangle_count = count_flying_edges(parameters, workspace);
+	std::vector<uint32_t>& indices = parameters.indexed ? mesh.indices : workspace.indices;
+	indices.resize(triangle_count * 3);
+
+	// Every row writes the crossings of its edges between the points holding them
+	// Gradient normals are queued with the positions and computed in batches of the layer
+	const uint64_t* point_bits = workspace.point_bits.data();
+	parallel_for(slab_count, [&](int s) {
+		GradientBatch gradient_batch;
+		Vector3* normals = workspace.normals.data();
+		int last_point_layer = s == slab_count - 1 ? resolution : slabs[s].last_layer;
+		for (int i = slabs[s].first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				size_t row = size_t(resolution) * i + j;
+				const FlyingEdgesRow& edge_row = workspace.edge_rows[row];
+				if (!workspace.row_vertex_counts[row]) continue;
+				const uint64_t* row_bits = point_bits + row * words;
+				const uint64_t* next_row = j + 1 < resolution ? row_bits + words : nullptr;
+				const uint64_t* upper_row = i + 1 < resolution ? row_bits + size_t(resolution) * words : nullptr;
+				uint32_t ids[3];
+				ids[0] = workspace.row_vertex_offsets[row];
+				ids[1] = ids[0] + edge_row.x_count;
+				ids[2] = ids[1] + edge_row.z_count;
+				for (int w = edge_row.first >> 6; w <= edge_row.last >> 6; w++) {
+					uint64_t crossings[3];
+					row_crossings(row_bits, next_row, upper_row, w, words, resolution, crossings[0], crossings[1], crossings[2]);
+					for (int axis = 0; axis < 3; axis++) {
+						for (uint64_t axis_crossings = crossings[axis]; axis_crossings; axis_crossings &= axis_crossings - 1) {
+							int k = w * 64 + lowest_bit(axis_crossings);
+							uint32_t id = ids[axis]++;
+							workspace.positions[id] = edge_crossing<Placement>(grid, parameters, i, j, k, axis);
+							if (gradient) queue_gradient_normal<Placement>(grid, parameters, i, j, k, axis, id, gradient_batch, normals);
+						}
+					}
+				}
+			}
+			if (gradient_batch.count) compute_gradient_normals(grid, resolution, i, gradient_batch, normals);
+		}
+	});
+
+	write_flying_edges_triangles(workspace, resolution, indices);
+	write_marching_cubes_mesh(workspace, indices, parameters.indexed, gradient, format, mesh);
+}
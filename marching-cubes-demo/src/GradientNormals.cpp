@@ -0,0 +1,81 @@
+#include "GradientNormals.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GRADIENT_AVX2
+#endif
+
+#if defined(GRADIENT_AVX2)
+// Difference between the points before and after the 8 points at offsets along one axis, over their distance
+// One sided on the faces of the grid, where the coordinates are 0 or the last one
+static __m256 gradient_difference(const float* base, __m256i offsets, __m256i coordinates, __m256i last, int stride) {
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i before = _mm256_and_si256(_mm256_cmpgt_epi32(coordinates, _mm256_setzero_si256()), one);
+	__m256i after = _mm256_and_si256(_mm256_cmpgt_epi32(last, coordinates), one);
+	__m256i stride8 = _mm256_set1_epi32(stride);
+	__m256 low = _mm256_i32gather_ps(base, _mm256_sub_epi32(offsets, _mm256_mullo_epi32(before, stride8)), 4);
+	__m256 high = _mm256_i32gather_ps(base, _mm256_add_epi32(offsets, _mm256_mullo_epi32(after, stride8)), 4);
+	return _mm256_div_ps(_mm256_sub_ps(high, low), _mm256_cvtepi32_ps(_mm256_add_epi32(before, after)));
+}
+
+// Gradient at the 8 grid points (i, j, k), base pointing at the first point of layer base_i
+static void gradient8(const float* base, int base_i, int resolution, __m256i i, __m256i j, __m256i k, __m256& x, __m256& y, __m256& z) {
+	__m256i last = _mm256_set1_epi32(resolution - 1);
+	__m256i row = _mm256_set1_epi32(resolution);
+	__m256i layer_i = _mm256_sub_epi32(i, _mm256_set1_epi32(base_i));
+	__m256i offsets = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(layer_i, row), j), row), k);
+	x = gradient_difference(base, offsets, k, last, 1);
+	y = gradient_difference(base, offsets, i, last, resolution * resolution);
+	z = gradient_difference(base, offsets, j, last, resolution);
+}
+
+// Gradient at fractions of the way from (x0, y0, z0) to (x1, y1, z1), normalized, the same operations as
+// crossing_gradient_normal and normalize
+static void gradient_normal8(__m256 fractions, __m256 x0, __m256 y0, __m256 z0, __m256 x1, __m256 y1, __m256 z1, __m256& x, __m256& y, __m256& z) {
+	x = _mm256_add_ps(x0, _mm256_mul_ps(fractions, _mm256_sub_ps(x1, x0)));
+	y = _mm256_add_ps(y0, _mm256_mul_ps(fractions, _mm256_sub_ps(y1, y0)));
+	z = _mm256_add_ps(z0, _mm256_mul_ps(fractions, _mm256_sub_ps(z1, z0)));
+	__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+	__m256 nonzero = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+	x = _mm256_blendv_ps(x, _mm256_div_ps(x, length), nonzero);
+	y = _mm256_blendv_ps(y, _mm256_div_ps(y, length), nonzero);
+	z = _mm256_blendv_ps(z, _mm256_div_ps(z, length), nonzero);
+}
+#endif
+
+void compute_gradient_normals(const float* grid, int resolution, int i, GradientBatch& batch, Vector3* normals) {
+	int n = 0;
+#if defined(GRADIENT_AVX2)
+	// Gathers read from the layer below i, the points they read are at most three layers further, which keeps
+	// their offsets within 32 bits up to resolutions of about 26000
+	int base_i = std::max(i - 1, 0);
+	const float* base = grid + size_t(resolution) * resolution * base_i;
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i i8 = _mm256_set1_epi32(i);
+	for (; n + 8 <= batch.count; n += 8) {
+		__m256i j = _mm256_loadu_si256((const __m256i*)(batch.j + n));
+		__m256i k = _mm256_loadu_si256((const __m256i*)(batch.k + n));
+		__m256i axes = _mm256_loadu_si256((const __m256i*)(batch.axes + n));
+		__m256i along_x = _mm256_and_si256(_mm256_cmpeq_epi32(axes, _mm256_setzero_si256()), one);
+		__m256i along_z = _mm256_and_si256(_mm256_cmpeq_epi32(axes, one), one);
+		__m256i along_y = _mm256_and_si256(_mm256_cmpeq_epi32(axes, _mm256_set1_epi32(2)), one);
+		__m256 x0, y0, z0, x1, y1, z1, x, y, z;
+		gradient8(base, base_i, resolution, i8, j, k, x0, y0, z0);
+		gradient8(base, base_i, resolution, _mm256_add_epi32(i8, along_y), _mm256_add_epi32(j, along_z), _mm256_add_epi32(k, along_x), x1, y1, z1);
+		gradient_normal8(_mm256_loadu_ps(batch.fractions + n), x0, y0, z0, x1, y1, z1, x, y, z);
+		alignas(32) float xs[8], ys[8], zs[8];
+		_mm256_store_ps(xs, x);
+		_mm256_store_ps(ys, y);
+		_mm256_store_ps(zs, z);
+		for (int lane = 0; lane < 8; lane++) {
+			normals[batch.vertices[n + lane]] = Vector3(xs[lane], ys[lane], zs[lane]);
+		}
+	}
+#endif
+	for (; n < batch.count; n++) {
+		normals[batch.vertices[n]] = crossing_gradient_normal(grid, resolution, i, batch.j[n], batch.k[n], batch.axes[n], batch.fractions[n]);
+	}
+	batch.count = 0;
+}
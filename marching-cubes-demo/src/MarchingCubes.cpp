@@ -0,0 +1,25 @@
+#include "MarchingCubes.h"
+
+#include "SurfaceExtraction.h"
+
+const char* const extraction_engine_names[extraction_engine_count] = { "Marching Cubes", "Surface Nets", "Dual Contouring", "Flying Edges" };
+
+void extract_marching_cubes(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	MeshVertexFormat format;
+	if (parameters.interpolation) {
+		if (parameters.indexed) generate_marching_cubes_kernel<float, LinearInterpolation, SmoothNormals>(grid.data(), parameters, format, mesh);
+		else generate_marching_cubes_kernel<float, LinearInterpolation, FaceNormals>(grid.data(), parameters, format, mesh);
+	}
+	else {
+		if (parameters.indexed) generate_marching_cubes_kernel<float, MidpointPlacement, SmoothNormals>(grid.data(), parameters, format, mesh);
+		else generate_marching_cubes_kernel<float, MidpointPlacement, FaceNormals>(grid.data(), parameters, format, mesh);
+	}
+}
+
+void extract_surface(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	extract_surface_kernel(grid.data(), parameters, MeshVertexFormat(), mesh);
+}
+
+void extract_marching_cubes_generic(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	generate_marching_cubes_kernel<float, RuntimeInterpolation, RuntimeNormals>(grid.data(), parameters, MeshVertexFormat(), mesh);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+
+typedef struct Vector3 {
+	float x, y, z;
+	Vector3() : x(0), y(0), z(0) {}
+	Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	inline Vector3 operator+(Vector3 other) const { return Vector3(x + other.x, y + other.y, z + other.z); }
+	inline Vector3 operator-(Vector3 other) const { return Vector3(x - other.x, y - other.y, z - other.z); }
+	inline Vector3 operator+(float other) const { return Vector3(x + other, y + other, z + other); }
+	inline Vector3 operator-(float other) const { return Vector3(x - other, y - other, z - other); }
+	inline Vector3 operator/(float other) const { return Vector3(x / other, y / other, z / other); }
+} Vector3;
+inline Vector3 operator*(float other, Vector3 v) { return Vector3(v.x * other, v.y * other, v.z * other); }
+inline Vector3 cross(Vector3 a, Vector3 b) { return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline float dot(Vector3 a, Vector3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vector3 normalize(Vector3 v) {
+	float length = sqrtf(dot(v, v));
+	return length > 0 ? v / length : v;
+}
+
+inline float map(float input, float input_start, float input_end, float output_start, float output_end) {
+	return output_start + ((output_end - output_start) / (input_end - input_start)) * (input - input_start);
+}
+
+// Extraction engines of dense grids, all reading the same grid layout and parameters and writing the same meshes
+enum ExtractionEngine {
+	engine_marching_cubes,
+	engine_surface_nets,
+	engine_dual_contouring,
+	engine_flying_edges,
+	extraction_engine_count
+};
+extern const char* const extraction_engine_names[extraction_engine_count];
+
+typedef struct MarchingCubesParameters {
+	int resolution;
+	float cube_size;
+	float threshold;
+	bool interpolation;
+	// Shared vertices with smooth normals, otherwise a triangle soup with face normals
+	bool indexed;
+	// Normals from the gradient of the field at the crossings for either output, computed once per shared vertex
+	// Dense grids only, the other extractions keep the normals of the triangles
+	bool gradient_normals = false;
+	// Engine of dense grid extractions, the other extractions always run marching cubes
+	int engine = engine_marching_cubes;
+} MarchingCubesParameters;
+
+typedef struct MeshVertex {
+	Vector3 position;
+	Vector3 normal;
+} MeshVertex;
+
+// Triangle list, when indexed every edge crossing of the grid is stored once and shared by all the cells around that edge
+// Unindexed meshes leave indices empty and store three vertices per triangle
+template <typename VertexType>
+struct IndexedMesh {
+	std::vector<VertexType> vertices;
+	std::vector<uint32_t> indices;
+};
+typedef IndexedMesh<MeshVertex> MarchingCubesMesh;
+
+// Receives a mesh piece by piece while it is extracted, for outputs that never hold the whole mesh
+// Vertices arrive numbered after the ones before them with their final normals. Indexed triangles only reference
+// vertices already received, unindexed meshes receive three vertices per triangle and no indices
+typedef struct MeshStream {
+	std::function<void(const Vector3* positions, const Vector3* normals, size_t count)> write_vertices;
+	std::function<void(const uint32_t* indices, size_t count)> write_indices;
+} MeshStream;
+
+// Runs marching cubes over a resolution^3 grid laid out as grid[resolution*resolution*i + resolution*j + k]
+// Uses the kernel specialized for the interpolation and indexed settings of the parameters
+void extract_marching_cubes(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh);
+// Runs the engine chosen by the parameters over the same grid
+void extract_surface(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh);
+// Same extraction through the generic kernel, which checks those settings at runtime, kept to benchmark the specializations
+void extract_marching_cubes_generic(const std::vector<float>& grid, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh);
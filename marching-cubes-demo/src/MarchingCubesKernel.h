@@ -0,0 +1,527 @@
+#pragma once
+
+// Marching cubes extraction kernel, specialized at compile time on
+//  - Scalar: type of the grid samples
+//  - Placement: how crossings are placed along their edge
+//  - Normals: smooth normals on shared vertices or face normals on a triangle soup
+//  - VertexFormat: layout of the output vertices
+// Either output takes its normals from the field gradient instead when the parameters ask for gradient normals
+// The Runtime* policies read the choice from MarchingCubesParameters instead, they make up the generic path
+
+#include "MarchingCubes.h"
+#include "MarchingCubesTables.h"
+#include "Classification.h"
+#include "Parallel.h"
+#include "MinMaxPyramid.h"
+#include "GradientNormals.h"
+
+#include <algorithm>
+#include <utility>
+
+// Crossing placement policies, fraction gives how far along the edge the crossing is, for the gradient normals
+typedef struct LinearInterpolation {
+	static Vector3 place(Vector3 P0, Vector3 P1, float V0, float V1, const MarchingCubesParameters& parameters) {
+		return P0 + (parameters.threshold - V0) * (P1 - P0) / (V1 - V0);
+	}
+	static float fraction(float V0, float V1, const MarchingCubesParameters& parameters) {
+		return (parameters.threshold - V0) / (V1 - V0);
+	}
+} LinearInterpolation;
+typedef struct MidpointPlacement {
+	static Vector3 place(Vector3 P0, Vector3 P1, float V0, float V1, const MarchingCubesParameters& parameters) {
+		return (P0 + P1) / 2.0f;
+	}
+	static float fraction(float V0, float V1, const MarchingCubesParameters& parameters) {
+		return 0.5f;
+	}
+} MidpointPlacement;
+typedef struct RuntimeInterpolation {
+	static Vector3 place(Vector3 P0, Vector3 P1, float V0, float V1, const MarchingCubesParameters& parameters) {
+		return !parameters.interpolation ? (P0 + P1) / 2.0f : P0 + (parameters.threshold - V0) * (P1 - P0) / (V1 - V0);
+	}
+	static float fraction(float V0, float V1, const MarchingCubesParameters& parameters) {
+		return !parameters.interpolation ? 0.5f : (parameters.threshold - V0) / (V1 - V0);
+	}
+} RuntimeInterpolation;
+
+// Normal policies, indexed output gets smooth normals and unindexed output gets face normals
+typedef struct SmoothNormals {
+	static bool indexed(const MarchingCubesParameters& parameters) { return true; }
+} SmoothNormals;
+typedef struct FaceNormals {
+	static bool indexed(const MarchingCubesParameters& parameters) { return false; }
+} FaceNormals;
+typedef struct RuntimeNormals {
+	static bool indexed(const MarchingCubesParameters& parameters) { return parameters.indexed; }
+} RuntimeNormals;
+
+// Vertex format writing MeshVertex, other formats provide the same VertexType and write members
+typedef struct MeshVertexFormat {
+	typedef MeshVertex VertexType;
+	void write(MeshVertex& vertex, Vector3 position, Vector3 normal) const {
+		vertex.position = position;
+		vertex.normal = normal;
+	}
+} MeshVertexFormat;
+
+// Cube edges as {di, dj, dk, axis}, the grid point they start from relative to the cube origin and the axis they run along
+// Axis 0 goes along k (x), axis 1 along j (z) and axis 2 along i (y)
+constexpr int cube_edges[12][4] = {
+	{0, 0, 0, 0}, {0, 0, 1, 1}, {0, 1, 0, 0}, {0, 0, 0, 1},
+	{1, 0, 0, 0}, {1, 0, 1, 1}, {1, 1, 0, 0}, {1, 0, 0, 1},
+	{0, 0, 0, 2}, {0, 0, 1, 2}, {0, 1, 1, 2}, {0, 1, 0, 2}
+};
+
+// Number of triangles of every cube configuration, derived from triTable
+typedef struct TriangleCountTable {
+	int counts[256];
+	TriangleCountTable() {
+		for (int cube_index = 0; cube_index < 256; cube_index++) {
+			int m = 0;
+			while (triTable[cube_index][m] != -1) m += 3;
+			counts[cube_index] = m / 3;
+		}
+	}
+} TriangleCountTable;
+inline const int* triangle_counts() {
+	static const TriangleCountTable table;
+	return table.counts;
+}
+
+// Cell the surface goes through, found by the classification pass
+typedef struct ActiveCell {
+	int i, j, k;
+	int cube_index;
+} ActiveCell;
+
+// Range of cell layers meshed by one task, with the counts and offsets of its part of the output buffers
+typedef struct MarchingCubesSlab {
+	int first_layer;
+	int last_layer;
+	std::vector<uint64_t> active_bits;
+	std::vector<ActiveCell> active_cells;
+	size_t triangle_count;
+	size_t index_offset;
+} MarchingCubesSlab;
+
+// Flying edges, a row of points with the trim of its x edges, its points before left and from right on are all on
+// the side of its ends, the count of its crossed edges along every axis and the points first to last holding
+// all of them
+// Rows without crossed x edges have left at the last point and right at the first one
+typedef struct FlyingEdgesRow {
+	int left;
+	int right;
+	uint32_t x_count;
+	uint32_t z_count;
+	uint32_t y_count;
+	int first;
+	int last;
+} FlyingEdgesRow;
+
+// Flying edges, the cells first to last - 1 of a row of cells that may be active and its part of the index buffer
+typedef struct FlyingEdgesCellRow {
+	int first;
+	int last;
+	size_t triangle_count;
+	size_t index_offset;
+} FlyingEdgesCellRow;
+
+// Scratch buffers of an extraction, kept per calling thread so their capacity is reused and extractions on
+// different threads do not share them
+typedef struct MarchingCubesWorkspace {
+	std::vector<MarchingCubesSlab> slabs;
+	// Classification bits of every grid point, one bit row per (i, j) row of points
+	std::vector<uint64_t> point_bits;
+	// Level 0 blocks of the min/max pyramid straddling the threshold and the (bi, bj) rows of blocks holding any of them
+	std::vector<uint8_t> active_blocks;
+	std::vector<uint8_t> active_block_rows;
+	// Classification bits of a row of points of every (bi, bj) row of blocks when nothing is read from the grid,
+	// every point set to the side of its block
+	std::vector<uint64_t> block_row_bits;
+	// Vertices are numbered in grid order, by the row of points their edge starts from
+	// Crossed edges of every row of points and id of the first vertex of every row
+	std::vector<uint32_t> row_vertex_counts;
+	std::vector<uint32_t> row_vertex_offsets;
+	// Surface nets, active cells of every row of cells
+	std::vector<uint64_t> cell_bits;
+	// Flying edges, every row of points and every row of cells
+	std::vector<FlyingEdgesRow> edge_rows;
+	std::vector<FlyingEdgesCellRow> cell_rows;
+	// Shared vertex positions, their accumulated or gradient normals and the triangles of the unindexed output
+	std::vector<Vector3> positions;
+	std::vector<Vector3> normals;
+	std::vector<uint32_t> indices;
+} MarchingCubesWorkspace;
+inline MarchingCubesWorkspace& marching_cubes_workspace() {
+	static thread_local MarchingCubesWorkspace workspace;
+	return workspace;
+}
+
+// Sliding edge cache, vertex ids of the edges starting at the points of two consecutive point layers
+// Each slice holds 3 ids per point, one per axis, so cells find all 12 of their edges in the slices of their two layers
+// Kept per thread instead of per grid, so it only costs two layers of memory per thread
+inline std::vector<uint32_t>* marching_cubes_edge_slices() {
+	static thread_local std::vector<uint32_t> slices[2];
+	return slices;
+}
+
+// Crossed edges starting at the points of word w of a classified row, one bit mask per axis
+// An edge is crossed when its two points are classified differently
+inline void row_crossings(const uint64_t* row, const uint64_t* next_row, const uint64_t* upper_row, int w, int words, int resolution,
+	uint64_t& x_crossings, uint64_t& z_crossings, uint64_t& y_crossings) {
+	uint64_t next_word = w + 1 < words ? row[w + 1] : 0;
+	x_crossings = row[w] ^ ((row[w] >> 1) | (next_word << 63));
+	if (w == words - 1) x_crossings &= (uint64_t(1) << ((resolution - 1) & 63)) - 1;
+	z_crossings = next_row ? row[w] ^ next_row[w] : 0;
+	y_crossings = upper_row ? row[w] ^ upper_row[w] : 0;
+}
+
+// Computes the crossing of an edge always from its lower to its upper grid point, so the result
+// does not depend on which of the cells sharing the edge asks for it
+template <typename Placement, typename Scalar>
+inline Vector3 edge_crossing(const Scalar* grid, const MarchingCubesParameters& parameters, int i, int j, int k, int axis) {
+	int resolution = parameters.resolution;
+	float half_size = parameters.cube_size / 2.0f;
+	size_t grid_index = (size_t(resolution) * i + j) * resolution + k;
+	size_t end_index = grid_index + (axis == 0 ? 1 : axis == 1 ? resolution : size_t(resolution) * resolution);
+	float V0 = float(grid[grid_index]);
+	float V1 = float(grid[end_index]);
+	Vector3 P0 = Vector3(map(float(k), 0.0f, float(resolution - 1), -half_size, half_size),
+		map(float(i), 0.0f, float(resolution - 1), -half_size, half_size),
+		map(float(j), 0.0f, float(resolution - 1), -half_size, half_size));
+	Vector3 P1 = Vector3(map(float(k + (axis == 0)), 0.0f, float(resolution - 1), -half_size, half_size),
+		map(float(i + (axis == 2)), 0.0f, float(resolution - 1), -half_size, half_size),
+		map(float(j + (axis == 1)), 0.0f, float(resolution - 1), -half_size, half_size));
+	return Placement::place(P0, P1, V0, V1, parameters);
+}
+
+// Queues the crossing of an edge of point layer i for its gradient normal, flushing the batch when it is full
+template <typename Placement, typename Scalar>
+inline void queue_gradient_normal(const Scalar* grid, const MarchingCubesParameters& parameters, int i, int j, int k, int axis, uint32_t vertex,
+	GradientBatch& batch, Vector3* normals) {
+	int resolution = parameters.resolution;
+	size_t grid_index = (size_t(resolution) * i + j) * resolution + k;
+	size_t end_index = grid_index + (axis == 0 ? 1 : axis == 1 ? resolution : size_t(resolution) * resolution);
+	int n = batch.count++;
+	batch.vertices[n] = vertex;
+	batch.j[n] = j;
+	batch.k[n] = k;
+	batch.axes[n] = axis;
+	batch.fractions[n] = Placement::fraction(float(grid[grid_index]), float(grid[end_index]), parameters);
+	if (batch.count == gradient_batch_size) compute_gradient_normals(grid, resolution, i, batch, normals);
+}
+
+// Reads the vertex ids of all 12 edges of a cube from the edge cache, unrolled into constant offsets
+// Edges that are not crossed read stale ids, triTable never references them
+template <size_t... L>
+inline void gather_cube_vertices(const uint32_t* const slices[2], size_t base, size_t row_stride, uint32_t* cube_vertices, std::index_sequence<L...>) {
+	int expand[] = { (cube_vertices[L] = slices[cube_edges[L][0]][base + cube_edges[L][1] * row_stride + cube_edges[L][2] * 3 + cube_edges[L][3]], 0)... };
+	(void)expand;
+}
+
+// Writes the output vertices from the shared vertex positions of the workspace and the triangles indexing them
+// Indexed output gets smooth normals on the shared vertices, otherwise every triangle gets its own three vertices
+// With gradient normals the workspace already holds the normals of the shared vertices and both outputs use them
+template <typename VertexFormat>
+void write_marching_cubes_mesh(MarchingCubesWorkspace& workspace, const std::vector<uint32_t>& indices, bool indexed, bool gradient_normals,
+	const VertexFormat& format, IndexedMesh<typename VertexFormat::VertexType>& mesh) {
+	uint32_t vertex_count = uint32_t(workspace.positions.size());
+	size_t triangle_count = indices.size() / 3;
+	// Vertex ranges converted to the output format by each task
+	const int vertex_tasks = get_thread_count() * 4;
+	if (indexed && gradient_normals) {
+		const Vector3* positions = workspace.positions.data();
+		const Vector3* normals = workspace.normals.data();
+		mesh.vertices.resize(vertex_count);
+		parallel_for(vertex_tasks, [&](int task) {
+			size_t first = size_t(vertex_count) * task / vertex_tasks;
+			size_t last = size_t(vertex_count) * (task + 1) / vertex_tasks;
+			for (size_t v = first; v < last; v++) {
+				format.write(mesh.vertices[v], positions[v], normals[v]);
+			}
+		});
+	}
+	else if (indexed) {
+		// Smooth normals, every vertex gets the sum of the area weighted normals of the triangles around it
+		// Accumulated in triangle order so the sums do not depend on the slab split
+		workspace.normals.assign(vertex_count, Vector3());
+		const Vector3* positions = workspace.positions.data();
+		Vector3* normals = workspace.normals.data();
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			uint32_t v1 = indices[t];
+			uint32_t v2 = indices[t + 1];
+			uint32_t v3 = indices[t + 2];
+			Vector3 normal = cross(positions[v2] - positions[v1], positions[v3] - positions[v1]);
+			normals[v1] = normals[v1] + normal;
+			normals[v2] = normals[v2] + normal;
+			normals[v3] = normals[v3] + normal;
+		}
+		mesh.vertices.resize(vertex_count);
+		parallel_for(vertex_tasks, [&](int task) {
+			size_t first = size_t(vertex_count) * task / vertex_tasks;
+			size_t last = size_t(vertex_count) * (task + 1) / vertex_tasks;
+			for (size_t v = first; v < last; v++) {
+				format.write(mesh.vertices[v], positions[v], normalize(normals[v]));
+			}
+		});
+	}
+	else {
+		// Expand every triangle into its own three vertices with the face normal, or the gradient normals of its vertices
+		mesh.indices.clear();
+		mesh.vertices.resize(triangle_count * 3);
+		const Vector3* positions = workspace.positions.data();
+		const Vector3* normals = workspace.normals.data();
+		parallel_for(vertex_tasks, [&](int task) {
+			size_t first = triangle_count * task / vertex_tasks;
+			size_t last = triangle_count * (task + 1) / vertex_tasks;
+			if (gradient_normals) {
+				for (size_t t = first * 3; t < last * 3; t++) {
+					format.write(mesh.vertices[t], positions[indices[t]], normals[indices[t]]);
+				}
+				return;
+			}
+			for (size_t t = first; t < last; t++) {
+				Vector3 p1 = positions[indices[t * 3]];
+				Vector3 p2 = positions[indices[t * 3 + 1]];
+				Vector3 p3 = positions[indices[t * 3 + 2]];
+				Vector3 normal = normalize(cross(p2 - p1, p3 - p1));
+				format.write(mesh.vertices[t * 3], p1, normal);
+				format.write(mesh.vertices[t * 3 + 1], p2, normal);
+				format.write(mesh.vertices[t * 3 + 2], p3, normal);
+			}
+		});
+	}
+}
+
+// Runs marching cubes over a resolution^3 grid laid out as grid[resolution*resolution*i + resolution*j + k]
+// With a min/max pyramid of the grid, the blocks that cannot hold the surface are neither read nor scanned
+template <typename Scalar, typename Placement, typename Normals, typename VertexFormat>
+void generate_marching_cubes_kernel(const Scalar* grid, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh, const MinMaxPyramid* pyramid = nullptr) {
+	int resolution = parameters.resolution;
+	float threshold = parameters.threshold;
+	bool indexed = Normals::indexed(parameters);
+	bool gradient = parameters.gradient_normals;
+	if (resolution < 2) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	MarchingCubesWorkspace& workspace = marching_cubes_workspace();
+	std::vector<MarchingCubesSlab>& slabs = workspace.slabs;
+	const int* triangle_count_table = triangle_counts();
+
+	// Split the cell layers into slabs, a few per thread so uneven slabs still balance out
+	int cell_layers = resolution - 1;
+	int slab_count = std::min(cell_layers, get_thread_count() * 4);
+	slabs.resize(slab_count);
+	for (int s = 0; s < slab_count; s++) {
+		slabs[s].first_layer = cell_layers * s / slab_count;
+		slabs[s].last_layer = cell_layers * (s + 1) / slab_count;
+	}
+
+	// Find the blocks of the pyramid straddling the threshold
+	// The edges starting at the points of a block and its cells stay inside the block, so rows of points whose
+	// blocks are all skipped have no crossings and no active cells
+	bool use_pyramid = pyramid && pyramid->resolution == resolution && !pyramid->levels.empty();
+	int blocks = use_pyramid ? pyramid->levels[0].blocks : 0;
+	if (use_pyramid) find_active_blocks(*pyramid, threshold, workspace.active_blocks, workspace.active_block_rows);
+	const uint8_t* active_blocks = workspace.active_blocks.data();
+	const uint8_t* active_block_rows = workspace.active_block_rows.data();
+	auto row_active = [&](int i, int j) {
+		return !use_pyramid || active_block_rows[size_t(blocks) * point_block(i, blocks) + point_block(j, blocks)];
+	};
+
+	// Classify every grid point against the threshold, a whole row at a time
+	// Points of skipped blocks are all on the same side, their rows start from the sides of their row of blocks
+	// and only the points of active blocks are read from the grid
+	int words = classification_words(resolution);
+	if (use_pyramid) {
+		const std::vector<float>& max_values = pyramid->levels[0].max_values;
+		workspace.block_row_bits.assign(size_t(blocks) * blocks * words, 0);
+		for (size_t block_row = 0; block_row < size_t(blocks) * blocks; block_row++) {
+			for (int bk = 0; bk < blocks; bk++) {
+				int first = bk * min_max_block_size;
+				int count = (bk == blocks - 1 ? resolution : first + min_max_block_size) - first;
+				if (max_values[block_row * blocks + bk] < threshold) fill_point_range(first, count, true, &workspace.block_row_bits[block_row * words]);
+			}
+		}
+	}
+	workspace.point_bits.resize(size_t(resolution) * resolution * words);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	parallel_for(slab_count, [&](int s) {
+		int last_point_layer = s == slab_count - 1 ? resolution : slabs[s].last_layer;
+		for (int i = slabs[s].first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				size_t row = size_t(resolution) * i + j;
+				uint64_t* row_bits = &workspace.point_bits[row * words];
+				if (!use_pyramid) {
+					classify_points(grid + row * resolution, resolution, threshold, row_bits);
+					continue;
+				}
+				size_t block_row = size_t(blocks) * point_block(i, blocks) + point_block(j, blocks);
+				std::copy_n(&workspace.block_row_bits[block_row * words], words, row_bits);
+				if (!active_block_rows[block_row]) continue;
+				for (int bk = 0; bk < blocks; bk++) {
+					if (!active_blocks[block_row * blocks + bk]) continue;
+					int first = bk * min_max_block_size;
+					int count = (bk == blocks - 1 ? resolution : first + min_max_block_size) - first;
+					classify_point_range(grid + row * resolution, first, count, threshold, row_bits);
+				}
+			}
+		}
+	});
+
+	// First pass, count the output of every slab
+	// Every slab counts the crossed edges starting at each of its rows of points, the last one also owns the top layer
+	// The cells of the slab that the surface goes through are gathered in its active cell list
+	workspace.row_vertex_counts.resize(size_t(resolution) * resolution);
+	workspace.row_vertex_offsets.resize(size_t(resolution) * resolution);
+	parallel_for(slab_count, [&](int s) {
+		MarchingCubesSlab& slab = slabs[s];
+		slab.active_bits.resize(words);
+		int last_point_layer = s == slab_count - 1 ? resolution : slab.last_layer;
+		size_t active_count = 0;
+		for (int i = slab.first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				if (!row_active(i, j)) {
+					workspace.row_vertex_counts[size_t(resolution) * i + j] = 0;
+					continue;
+				}
+				const uint64_t* row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* next_row = j + 1 < resolution ? row + words : nullptr;
+				const uint64_t* upper_row = i + 1 < resolution ? row + size_t(resolution) * words : nullptr;
+				uint32_t row_count = 0;
+				for (int w = 0; w < words; w++) {
+					uint64_t x_crossings, z_crossings, y_crossings;
+					row_crossings(row, next_row, upper_row, w, words, resolution, x_crossings, z_crossings, y_crossings);
+					row_count += bit_count(x_crossings) + bit_count(z_crossings) + bit_count(y_crossings);
+				}
+				workspace.row_vertex_counts[size_t(resolution) * i + j] = row_count;
+				if (i >= slab.last_layer || j + 1 >= resolution) continue;
+				classify_active_cells(row, next_row, upper_row, upper_row + words, resolution - 1, slab.active_bits.data());
+				for (int w = 0; w < words; w++) active_count += bit_count(slab.active_bits[w]);
+			}
+		}
+
+		// Size the active cell list once, then fill it and count the triangles of its cells
+		slab.active_cells.resize(active_count);
+		size_t active_index = 0;
+		size_t triangle_count = 0;
+		for (int i = slab.first_layer; i < slab.last_layer; i++) {
+			for (int j = 0; j < resolution - 1; j++) {
+				if (!row_active(i, j)) continue;
+				const uint64_t* row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* upper_row = row + size_t(resolution) * words;
+				// Entirely inside or outside cells are skipped 64 at a time
+				classify_active_cells(row, row + words, upper_row, upper_row + words, resolution - 1, slab.active_bits.data());
+				for (int w = 0; w < words; w++) {
+					for (uint64_t active = slab.active_bits[w]; active; active &= active - 1) {
+						int k = w * 64 + lowest_bit(active);
+						ActiveCell& cell = slab.active_cells[active_index++];
+						cell.i = i;
+						cell.j = j;
+						cell.k = k;
+						cell.cube_index = cell_cube_index(row, row + words, upper_row, upper_row + words, k);
+						triangle_count += triangle_count_table[cell.cube_index];
+					}
+				}
+			}
+		}
+		slab.triangle_count = triangle_count;
+	});
+
+	// Prefix sums give every row of points its first vertex id and every slab its range of the index buffer
+	// The buffers are sized exactly once
+	uint32_t vertex_count = 0;
+	for (size_t row = 0; row < workspace.row_vertex_counts.size(); row++) {
+		workspace.row_vertex_offsets[row] = vertex_count;
+		vertex_count += workspace.row_vertex_counts[row];
+	}
+	size_t triangle_count = 0;
+	for (MarchingCubesSlab& slab : slabs) {
+		slab.index_offset = triangle_count * 3;
+		triangle_count += slab.triangle_count;
+	}
+	workspace.positions.resize(vertex_count);
+	if (gradient) workspace.normals.resize(vertex_count);
+	std::vector<uint32_t>& indices = indexed ? mesh.indices : workspace.indices;
+	indices.resize(triangle_count * 3);
+
+	// Second pass, every slab walks its layers with the sliding edge cache and writes its vertices and triangles
+	// straight into its range of the buffers
+	parallel_for(slab_count, [&](int s) {
+		MarchingCubesSlab& slab = slabs[s];
+		int last_point_layer = s == slab_count - 1 ? resolution : slab.last_layer;
+		size_t row_stride = size_t(resolution) * 3;
+		std::vector<uint32_t>* edge_slices = marching_cubes_edge_slices();
+		edge_slices[0].resize(row_stride * resolution);
+		edge_slices[1].resize(row_stride * resolution);
+
+		// Numbers the crossed edges of a point layer into a slice, computing each crossing only once by the slab owning it
+		// The layer right above the slab belongs to the next slab, its ids are needed but its vertices are not written
+		// Gradient normals are queued with the positions and computed in batches of the layer
+		GradientBatch gradient_batch;
+		Vector3* normals = workspace.normals.data();
+		auto add_vertex = [&](int i, int j, int k, int axis, uint32_t id) {
+			workspace.positions[id] = edge_crossing<Placement>(grid, parameters, i, j, k, axis);
+			if (gradient) queue_gradient_normal<Placement>(grid, parameters, i, j, k, axis, id, gradient_batch, normals);
+		};
+		auto fill_slice = [&](int i, uint32_t* slice) {
+			bool owned = i < last_point_layer;
+			for (int j = 0; j < resolution; j++) {
+				if (!row_active(i, j)) continue;
+				const uint64_t* row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* next_row = j + 1 < resolution ? row + words : nullptr;
+				const uint64_t* upper_row = i + 1 < resolution ? row + size_t(resolution) * words : nullptr;
+				uint32_t id = workspace.row_vertex_offsets[size_t(resolution) * i + j];
+				uint32_t* row_slice = slice + row_stride * j;
+				for (int w = 0; w < words; w++) {
+					uint64_t x_crossings, z_crossings, y_crossings;
+					row_crossings(row, next_row, upper_row, w, words, resolution, x_crossings, z_crossings, y_crossings);
+					for (uint64_t crossings = x_crossings | z_crossings | y_crossings; crossings; crossings &= crossings - 1) {
+						int bit = lowest_bit(crossings);
+						int k = w * 64 + bit;
+						if ((x_crossings >> bit) & 1) {
+							row_slice[k * 3] = id;
+							if (owned) add_vertex(i, j, k, 0, id);
+							id++;
+						}
+						if ((z_crossings >> bit) & 1) {
+							row_slice[k * 3 + 1] = id;
+							if (owned) add_vertex(i, j, k, 1, id);
+							id++;
+						}
+						if ((y_crossings >> bit) & 1) {
+							row_slice[k * 3 + 2] = id;
+							if (owned) add_vertex(i, j, k, 2, id);
+							id++;
+						}
+					}
+				}
+			}
+			if (gradient_batch.count) compute_gradient_normals(grid, resolution, i, gradient_batch, normals);
+		};
+
+		uint32_t* triangle_indices = indices.data() + slab.index_offset;
+		const ActiveCell* cell = slab.active_cells.data();
+		const ActiveCell* cells_end = cell + slab.active_cells.size();
+		int current = 0;
+		fill_slice(slab.first_layer, edge_slices[current].data());
+		for (int i = slab.first_layer; i < last_point_layer; i++) {
+			if (i + 1 < resolution) fill_slice(i + 1, edge_slices[1 - current].data());
+			// Triangulate the active cells of the layer from the ids cached in both slices
+			const uint32_t* const slices[2] = { edge_slices[current].data(), edge_slices[1 - current].data() };
+			for (; cell != cells_end && cell->i == i; cell++) {
+				uint32_t cube_vertices[12];
+				gather_cube_vertices(slices, row_stride * cell->j + size_t(cell->k) * 3, row_stride, cube_vertices, std::make_index_sequence<12>());
+				for (int m = 0; triTable[cell->cube_index][m] != -1; m++) {
+					*triangle_indices++ = cube_vertices[triTable[cell->cube_index][m]];
+				}
+			}
+			current = 1 - current;
+		}
+	});
+
+	write_marching_cubes_mesh(workspace, indices, indexed, gradient, format, mesh);
+}
@@ -0,0 +1,354 @@
+#include "MeshCache.h"
+
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char mesh_cache_magic[4] = { 'M', 'C', 'M', 'C' };
+static const char mesh_cache_index_magic[4] = { 'M', 'C', 'I', 'X' };
+static const char volume_hashes_magic[4] = { 'M', 'C', 'V', 'H' };
+// Volume hashes kept, the oldest dropped past it
+static const size_t max_volume_hashes = 256;
+
+// Four lane multiply and rotate hash, 32 bytes per step
+static const uint64_t hash_prime_1 = 0x9E3779B185EBCA87ull;
+static const uint64_t hash_prime_2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t hash_prime_3 = 0x165667B19E3779F9ull;
+static const uint64_t hash_prime_4 = 0x85EBCA77C2B2AE63ull;
+static uint64_t rotate_left(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+static uint64_t hash_round(uint64_t lane, uint64_t word) {
+	return rotate_left(lane + word * hash_prime_2, 31) * hash_prime_1;
+}
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t lanes[4] = { seed + hash_prime_1 + hash_prime_2, seed + hash_prime_2, seed, seed - hash_prime_1 };
+	size_t blocks = size / 32;
+	for (size_t block = 0; block < blocks; block++) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			memcpy(&word, bytes + block * 32 + lane * 8, sizeof(word));
+			lanes[lane] = hash_round(lanes[lane], word);
+		}
+	}
+	uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18) + size;
+	for (size_t position = blocks * 32; position < size; position += 8) {
+		uint64_t word = 0;
+		memcpy(&word, bytes + position, std::min(size - position, sizeof(word)));
+		hash = rotate_left(hash ^ hash_round(0, word), 27) * hash_prime_1 + hash_prime_4;
+	}
+	hash ^= hash >> 33;
+	hash *= hash_prime_2;
+	hash ^= hash >> 29;
+	hash *= hash_prime_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// Bytes of slices mapped at once by volume_content_hash
+static const size_t hashed_window_bytes = 16 * 1024 * 1024;
+
+static uint64_t volume_description_hash(const VolumeDescription& description, uint64_t seed) {
+	const uint64_t values[6] = { uint64_t(description.size_x), uint64_t(description.size_y), uint64_t(description.size_z),
+		uint64_t(description.sample_type), uint64_t(description.big_endian), description.data_offset };
+	return hash_bytes(values, sizeof(values), seed);
+}
+
+uint64_t volume_file_identity(const MappedVolume& volume) {
+	const uint64_t file_values[2] = { volume.file_size, volume.modified_time };
+	uint64_t hash = hash_bytes(file_values, sizeof(file_values), hash_bytes(volume.data_path.data(), volume.data_path.size()));
+	return volume_description_hash(volume.description, hash);
+}
+
+bool volume_content_hash(MappedVolume& volume, uint64_t& hash, const std::atomic<bool>* cancel) {
+	const VolumeDescription& description = volume.description;
+	size_t slice_bytes = volume_slice_bytes(description);
+	int window_slices = int(std::max<size_t>(hashed_window_bytes / std::max<size_t>(slice_bytes, 1), 1));
+	hash = volume_description_hash(description, 0);
+	bool complete = true;
+	for (int z = 0; z < description.size_z; z += window_slices) {
+		if (cancel && cancel->load(std::memory_order_relaxed)) {
+			complete = false;
+			break;
+		}
+		int count = std::min(window_slices, description.size_z - z);
+		const uint8_t* samples = map_volume_slices(volume, z, count);
+		if (!samples) {
+			complete = false;
+			break;
+		}
+		hash = hash_bytes(samples, slice_bytes * count, hash);
+	}
+	map_volume_slices(volume, 0, 0);
+	return complete;
+}
+
+uint64_t mesh_cache_key(uint64_t field_hash, const MarchingCubesParameters& parameters, uint32_t vertex_stride, uint64_t format_hash,
+	const MeshPostPasses& post_passes) {
+	uint32_t cube_size, threshold;
+	memcpy(&cube_size, &parameters.cube_size, sizeof(cube_size));
+	memcpy(&threshold, &parameters.threshold, sizeof(threshold));
+	const uint64_t values[8] = { field_hash, uint64_t(parameters.resolution), cube_size, threshold,
+		uint64_t(parameters.interpolation) | uint64_t(parameters.indexed) << 1 | uint64_t(parameters.gradient_normals) << 2 |
+		uint64_t(parameters.engine) << 3, vertex_stride, format_hash, uint64_t(post_passes.optimize_vertex_order) | uint64_t(post_passes.decimate) << 1 };
+	if (!post_passes.decimate) return hash_bytes(values, sizeof(values));
+	// The decimation settings only count when the mesh is decimated, each in its own word
+	const DecimationParameters& decimation = post_passes.decimation;
+	uint32_t target_ratio, max_error;
+	memcpy(&target_ratio, &decimation.target_ratio, sizeof(target_ratio));
+	memcpy(&max_error, &decimation.max_error, sizeof(max_error));
+	const uint64_t decimation_values[4] = { target_ratio, uint64_t(decimation.target_triangles), max_error, uint64_t(decimation.preserve_borders) };
+	return hash_bytes(decimation_values, sizeof(decimation_values), hash_bytes(values, sizeof(values)));
+}
+
+static std::string entry_path(const MeshCache& cache, uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)key);
+	return cache.directory + "/" + name;
+}
+static std::string index_path(const MeshCache& cache) {
+	return cache.directory + "/index.bin";
+}
+static std::string volume_hashes_path(const MeshCache& cache) {
+	return cache.directory + "/volumes.bin";
+}
+
+static void write_volume_hashes(const MeshCache& cache) {
+	std::ofstream file(volume_hashes_path(cache), std::ios::binary | std::ios::trunc);
+	uint32_t count = uint32_t(cache.volume_hashes.size());
+	file.write(volume_hashes_magic, sizeof(volume_hashes_magic));
+	file.write(reinterpret_cast<const char*>(&mesh_cache_version), sizeof(mesh_cache_version));
+	file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	file.write(reinterpret_cast<const char*>(cache.volume_hashes.data()), std::streamsize(cache.volume_hashes.size() * sizeof(VolumeHashEntry)));
+}
+
+static void read_volume_hashes(MeshCache& cache) {
+	std::ifstream file(volume_hashes_path(cache), std::ios::binary);
+	char magic[4];
+	uint32_t version = 0, count = 0;
+	if (!file.read(magic, sizeof(magic)) || memcmp(magic, volume_hashes_magic, sizeof(magic)) != 0 ||
+		!file.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != mesh_cache_version ||
+		!file.read(reinterpret_cast<char*>(&count), sizeof(count)) || count > max_volume_hashes) return;
+	cache.volume_hashes.resize(count);
+	if (!file.read(reinterpret_cast<char*>(cache.volume_hashes.data()), std::streamsize(count * sizeof(VolumeHashEntry)))) cache.volume_hashes.clear();
+}
+
+static void write_index(const MeshCache& cache) {
+	std::ofstream index(index_path(cache), std::ios::binary | std::ios::trunc);
+	uint32_t count = uint32_t(cache.entries.size());
+	index.write(mesh_cache_index_magic, sizeof(mesh_cache_index_magic));
+	index.write(reinterpret_cast<const char*>(&mesh_cache_version), sizeof(mesh_cache_version));
+	index.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	index.write(reinterpret_cast<const char*>(cache.entries.data()), std::streamsize(cache.entries.size() * sizeof(MeshCacheEntry)));
+}
+
+// Removes the oldest entries until the rest fit, but for the newest one which is always kept
+static void evict_entries(MeshCache& cache) {
+	size_t evicted = 0;
+	while (cache.size > cache.capacity && evicted + 1 < cache.entries.size()) {
+		remove(entry_path(cache, cache.entries[evicted].key).c_str());
+		cache.size -= cache.entries[evicted].size;
+		cache.evictions++;
+		evicted++;
+	}
+	cache.entries.erase(cache.entries.begin(), cache.entries.begin() + evicted);
+}
+
+void open_mesh_cache(MeshCache& cache, const char* directory, uint64_t capacity) {
+	cache = MeshCache();
+	cache.directory = directory;
+	cache.capacity = capacity;
+#if defined(_WIN32)
+	CreateDirectoryA(directory, nullptr);
+#else
+	mkdir(directory, 0755);
+#endif
+	read_volume_hashes(cache);
+	std::ifstream index(index_path(cache), std::ios::binary);
+	char magic[4];
+	uint32_t version = 0, count = 0;
+	if (!index.read(magic, sizeof(magic)) || memcmp(magic, mesh_cache_index_magic, sizeof(magic)) != 0 ||
+		!index.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != mesh_cache_version ||
+		!index.read(reinterpret_cast<char*>(&count), sizeof(count))) return;
+	cache.entries.resize(count);
+	if (!index.read(reinterpret_cast<char*>(cache.entries.data()), std::streamsize(count * sizeof(MeshCacheEntry)))) cache.entries.clear();
+	for (const MeshCacheEntry& entry : cache.entries) cache.size += entry.size;
+	evict_entries(cache);
+}
+
+void set_mesh_cache_capacity(MeshCache& cache, uint64_t capacity) {
+	cache.capacity = capacity;
+	evict_entries(cache);
+	write_index(cache);
+}
+
+void clear_mesh_cache(MeshCache& cache) {
+	for (const MeshCacheEntry& entry : cache.entries) remove(entry_path(cache, entry.key).c_str());
+	cache.entries.clear();
+	cache.size = 0;
+	write_index(cache);
+}
+
+bool find_volume_hash(MeshCache& cache, uint64_t identity, uint64_t& content_hash) {
+	for (size_t e = 0; e < cache.volume_hashes.size(); e++) {
+		if (cache.volume_hashes[e].identity != identity) continue;
+		content_hash = cache.volume_hashes[e].content_hash;
+		return true;
+	}
+	return false;
+}
+
+void store_volume_hash(MeshCache& cache, uint64_t identity, uint64_t content_hash) {
+	std::vector<VolumeHashEntry>& hashes = cache.volume_hashes;
+	hashes.erase(std::remove_if(hashes.begin(), hashes.end(), [&](const VolumeHashEntry& entry) { return entry.identity == identity; }), hashes.end());
+	if (hashes.size() >= max_volume_hashes) hashes.erase(hashes.begin(), hashes.begin() + (hashes.size() - max_volume_hashes + 1));
+	hashes.push_back({ identity, content_hash });
+	write_volume_hashes(cache);
+}
+
+static bool map_entry(const std::string& path, MappedMesh& mesh) {
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	mesh.file = intptr_t(file);
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	mesh.view_size = size_t(file_size.QuadPart);
+	if (mesh.view_size < sizeof(MeshCacheHeader)) return false;
+	mesh.mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mesh.mapping) return false;
+	mesh.view = MapViewOfFile(mesh.mapping, FILE_MAP_READ, 0, 0, 0);
+	return mesh.view != nullptr;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	mesh.file = file;
+	struct stat file_status;
+	fstat(file, &file_status);
+	mesh.view_size = size_t(file_status.st_size);
+	if (mesh.view_size < sizeof(MeshCacheHeader)) return false;
+	void* view = mmap(nullptr, mesh.view_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED) return false;
+	mesh.view = view;
+	return true;
+#endif
+}
+
+void unmap_cached_mesh(MappedMesh& mesh) {
+#if defined(_WIN32)
+	if (mesh.view) UnmapViewOfFile(mesh.view);
+	if (mesh.mapping) CloseHandle(mesh.mapping);
+	if (mesh.file != -1) CloseHandle(HANDLE(mesh.file));
+#else
+	if (mesh.view) munmap(mesh.view, mesh.view_size);
+	if (mesh.file != -1) close(int(mesh.file));
+#endif
+	mesh = MappedMesh();
+}
+
+// Checks the header against the key and the file size, then the checksum of the buffers
+static bool check_entry(const MappedMesh& mesh, uint64_t key) {
+	const MeshCacheHeader& header = *static_cast<const MeshCacheHeader*>(mesh.view);
+	if (memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) != 0 || header.version != mesh_cache_version || header.key != key) return false;
+	if (header.vertices_offset < sizeof(MeshCacheHeader) || header.indices_offset < header.vertices_offset + header.vertex_count * header.vertex_stride ||
+		header.indices_offset + header.index_count * sizeof(uint32_t) != mesh.view_size) return false;
+	const uint8_t* view = static_cast<const uint8_t*>(mesh.view);
+	uint64_t vertices_hash = hash_bytes(view + header.vertices_offset, size_t(header.vertex_count) * header.vertex_stride);
+	return hash_bytes(view + header.indices_offset, size_t(header.index_count) * sizeof(uint32_t), vertices_hash) == header.checksum;
+}
+
+bool find_cached_mesh(MeshCache& cache, uint64_t key, MappedMesh& mesh) {
+	unmap_cached_mesh(mesh);
+	auto entry = std::find_if(cache.entries.begin(), cache.entries.end(), [&](const MeshCacheEntry& cached) { return cached.key == key; });
+	if (entry == cache.entries.end()) {
+		cache.misses++;
+		return false;
+	}
+	MeshCacheEntry found = *entry;
+	cache.entries.erase(entry);
+	if (!map_entry(entry_path(cache, key), mesh) || !check_entry(mesh, key)) {
+		// Damaged entries are dropped and extracted again
+		unmap_cached_mesh(mesh);
+		remove(entry_path(cache, key).c_str());
+		cache.size -= found.size;
+		cache.misses++;
+		write_index(cache);
+		return false;
+	}
+	cache.entries.push_back(found);
+	write_index(cache);
+	const uint8_t* view = static_cast<const uint8_t*>(mesh.view);
+	mesh.header = reinterpret_cast<const MeshCacheHeader*>(view);
+	mesh.vertices = view + mesh.header->vertices_offset;
+	mesh.indices = reinterpret_cast<const uint32_t*>(view + mesh.header->indices_offset);
+	cache.hits++;
+	return true;
+}
+
+void store_cached_mesh(MeshCache& cache, uint64_t key, const void* vertices, size_t vertex_count, uint32_t vertex_stride,
+	const uint32_t* indices, size_t index_count, const MeshPostPassStats& post_pass_stats) {
+	auto align = [](uint64_t offset) { return (offset + 15) & ~uint64_t(15); };
+	MeshCacheHeader header = {};
+	memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+	header.version = mesh_cache_version;
+	header.key = key;
+	header.vertex_count = vertex_count;
+	header.index_count = index_count;
+	header.vertex_stride = vertex_stride;
+	header.vertices_offset = align(sizeof(MeshCacheHeader));
+	header.indices_offset = align(header.vertices_offset + uint64_t(vertex_count) * vertex_stride);
+	uint64_t size = header.indices_offset + index_count * sizeof(uint32_t);
+	header.checksum = hash_bytes(indices, index_count * sizeof(uint32_t), hash_bytes(vertices, size_t(vertex_count) * vertex_stride));
+	header.post_pass_stats = post_pass_stats;
+
+	// Written under a temporary name first so a crash never leaves a partial entry under the real one
+	std::string path = entry_path(cache, key);
+	std::string temporary_path = path + ".tmp";
+	BufferedFile file;
+	if (!open_buffered_file(file, temporary_path.c_str())) return;
+	const uint8_t padding[16] = {};
+	write_buffered_file(file, &header, sizeof(header));
+	write_buffered_file(file, padding, size_t(header.vertices_offset - sizeof(header)));
+	write_buffered_file(file, vertices, size_t(vertex_count) * vertex_stride);
+	write_buffered_file(file, padding, size_t(header.indices_offset - header.vertices_offset - uint64_t(vertex_count) * vertex_stride));
+	write_buffered_file(file, indices, index_count * sizeof(uint32_t));
+	if (!close_buffered_file(file)) {
+		remove(temporary_path.c_str());
+		return;
+	}
+	auto existing = std::find_if(cache.entries.begin(), cache.entries.end(), [&](const MeshCacheEntry& cached) { return cached.key == key; });
+	if (existing != cache.entries.end()) {
+		cache.size -= existing->size;
+		cache.entries.erase(existing);
+	}
+	remove(path.c_str());
+	if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+		remove(temporary_path.c_str());
+		write_index(cache);
+		return;
+	}
+	cache.entries.push_back({ key, size });
+	cache.size += size;
+	evict_entries(cache);
+	write_index(cache);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// On disk cache of extracted meshes, keyed by a hash of the field and of everything else that changes the mesh
+// Every entry is a file laid out like the vertex and index buffers, so a hit maps the file and copies the buffers
+// out without parsing anything. A checksum of the buffers catches truncated or damaged entries
+// The cache keeps its entries least recently used first in an index file and removes the oldest ones when the
+// entries take more than its capacity
+
+#include "MarchingCubes.h"
+#include "VertexCache.h"
+#include "Decimation.h"
+#include "VolumeFile.h"
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+const uint32_t mesh_cache_version = 3;
+
+// Passes run over the extracted mesh before it is stored, part of the key of the entry
+typedef struct MeshPostPasses {
+	bool decimate = false;
+	DecimationParameters decimation;
+	bool optimize_vertex_order = false;
+} MeshPostPasses;
+
+// What the post passes measured when the mesh was extracted, stored with the entry so a hit reports them too
+typedef struct MeshPostPassStats {
+	DecimationStats decimation;
+	VertexCacheMetrics vertex_cache_before;
+	VertexCacheMetrics vertex_cache_after;
+	double vertex_order_time = 0;
+} MeshPostPassStats;
+
+typedef struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint64_t vertex_count;
+	uint64_t index_count;
+	uint32_t vertex_stride;
+	uint32_t reserved;
+	// From the start of the file, both 16 byte aligned
+	uint64_t vertices_offset;
+	uint64_t indices_offset;
+	// Hash of the vertices chained into the hash of the indices, the padding is left out
+	uint64_t checksum;
+	MeshPostPassStats post_pass_stats;
+} MeshCacheHeader;
+
+typedef struct MeshCacheEntry {
+	uint64_t key;
+	uint64_t size;
+} MeshCacheEntry;
+
+// Hash of every sample of a volume file, remembered under the identity of the file so it is read in full only once
+typedef struct VolumeHashEntry {
+	uint64_t identity;
+	uint64_t content_hash;
+} VolumeHashEntry;
+
+typedef struct MeshCache {
+	std::string directory;
+	uint64_t capacity = 0;
+	// Least recently used first
+	std::vector<MeshCacheEntry> entries;
+	// Least recently used first, kept in their own file next to the index
+	std::vector<VolumeHashEntry> volume_hashes;
+	uint64_t size = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+} MeshCache;
+
+// Cached mesh mapped in memory, valid until unmapped
+typedef struct MappedMesh {
+	const MeshCacheHeader* header = nullptr;
+	const void* vertices = nullptr;
+	const uint32_t* indices = nullptr;
+	// Platform file and mapping handles and the mapped file
+	intptr_t file = -1;
+	void* mapping = nullptr;
+	void* view = nullptr;
+	size_t view_size = 0;
+} MappedMesh;
+
+// 64 bit hash of a block of bytes, chained through seed
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+// Hash of the path, size and last write time of a volume file and the description of its samples, standing for the
+// file only to find its content hash again, never as a key itself
+uint64_t volume_file_identity(const MappedVolume& volume);
+// Hash of the description and every sample of the volume, mapping a few slices at a time. Returns false when
+// cancel is set before the last slice
+bool volume_content_hash(MappedVolume& volume, uint64_t& hash, const std::atomic<bool>* cancel = nullptr);
+// Key of the mesh of a field, its extraction parameters, the vertex layout and the post passes, format_hash
+// covering whatever the vertex format writes besides the position and the normal
+uint64_t mesh_cache_key(uint64_t field_hash, const MarchingCubesParameters& parameters, uint32_t vertex_stride, uint64_t format_hash,
+	const MeshPostPasses& post_passes);
+
+// Opens the cache in directory, creating it if needed, and reads back the entries of earlier runs
+void open_mesh_cache(MeshCache& cache, const char* directory, uint64_t capacity);
+void set_mesh_cache_capacity(MeshCache& cache, uint64_t capacity);
+void clear_mesh_cache(MeshCache& cache);
+// Content hash stored for a volume identity by an earlier run, if any
+bool find_volume_hash(MeshCache& cache, uint64_t identity, uint64_t& content_hash);
+void store_volume_hash(MeshCache& cache, uint64_t identity, uint64_t content_hash);
+
+// Maps the entry of key and checks it, counting a hit or a miss
+bool find_cached_mesh(MeshCache& cache, uint64_t key, MappedMesh& mesh);
+void unmap_cached_mesh(MappedMesh& mesh);
+// Copies the entry of key into mesh and unmaps it, so the mesh stays valid once the entry is evicted or cleared
+template <typename VertexType>
+bool load_cached_mesh(MeshCache& cache, uint64_t key, IndexedMesh<VertexType>& mesh, MeshPostPassStats& post_pass_stats) {
+	MappedMesh mapped;
+	if (!find_cached_mesh(cache, key, mapped)) return false;
+	bool loaded = mapped.header->vertex_stride == sizeof(VertexType);
+	if (loaded) {
+		const VertexType* vertices = static_cast<const VertexType*>(mapped.vertices);
+		mesh.vertices.assign(vertices, vertices + mapped.header->vertex_count);
+		mesh.indices.assign(mapped.indices, mapped.indices + mapped.header->index_count);
+		post_pass_stats = mapped.header->post_pass_stats;
+	}
+	unmap_cached_mesh(mapped);
+	return loaded;
+}
+// Adds the mesh as the most recent entry, removing the oldest ones past the capacity
+void store_cached_mesh(MeshCache& cache, uint64_t key, const void* vertices, size_t vertex_count, uint32_t vertex_stride,
+	const uint32_t* indices, size_t index_count, const MeshPostPassStats& post_pass_stats);
@@ -0,0 +1,283 @@
+#include "MeshWriter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+bool open_buffered_file(BufferedFile& file, const char* path) {
+	file.file.open(path, std::ios::binary | std::ios::trunc);
+	file.buffer.resize(buffered_file_size);
+	file.used = 0;
+	file.bytes_written = 0;
+	file.failed = !file.file;
+	return !file.failed;
+}
+
+void flush_buffered_file(BufferedFile& file) {
+	if (file.used == 0) return;
+	if (!file.file.write(file.buffer.data(), file.used)) file.failed = true;
+	file.bytes_written += file.used;
+	file.used = 0;
+}
+
+void write_buffered_file(BufferedFile& file, const void* data, size_t size) {
+	if (file.used + size > file.buffer.size()) {
+		flush_buffered_file(file);
+		// Blocks larger than the buffer go straight to the file
+		if (size > file.buffer.size()) {
+			if (!file.file.write(static_cast<const char*>(data), size)) file.failed = true;
+			file.bytes_written += size;
+			return;
+		}
+	}
+	memcpy(file.buffer.data() + file.used, data, size);
+	file.used += size;
+}
+
+void patch_buffered_file(BufferedFile& file, uint64_t offset, const void* data, size_t size) {
+	flush_buffered_file(file);
+	file.file.seekp(std::streamoff(offset));
+	if (!file.file.write(static_cast<const char*>(data), size)) file.failed = true;
+	file.file.seekp(0, std::ios::end);
+}
+
+bool close_buffered_file(BufferedFile& file) {
+	flush_buffered_file(file);
+	file.file.close();
+	if (!file.file) file.failed = true;
+	file.buffer = std::vector<char>();
+	return !file.failed;
+}
+
+char* format_integer(char* text, uint64_t value) {
+	char digits[20];
+	int count = 0;
+	do {
+		digits[count++] = char('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (count) *text++ = digits[--count];
+	return text;
+}
+
+char* format_float(char* text, float value) {
+	// Shortest digits that read back as the same float, without the locale lookups of printf
+	return std::to_chars(text, text + 15, value).ptr;
+}
+
+// Counts are padded to a fixed width so they can be written over once known
+static const int count_width = 20;
+static void write_padded_count(BufferedFile& file, uint64_t offset, uint64_t count) {
+	char text[count_width];
+	std::fill_n(text, count_width, ' ');
+	format_integer(text, count);
+	patch_buffered_file(file, offset, text, count_width);
+}
+
+bool open_mesh_writer(MeshWriter& writer, const char* path, MeshFileFormat format, bool indexed) {
+	writer.format = format;
+	writer.indexed = indexed;
+	writer.path = path;
+	writer.vertex_count = 0;
+	writer.triangle_count = 0;
+	writer.error.clear();
+	if (format == mesh_file_stl && indexed) {
+		writer.error = "STL files need an unindexed mesh";
+		return false;
+	}
+	if (!open_buffered_file(writer.file, path)) {
+		writer.error = "Cannot create " + writer.path;
+		return false;
+	}
+	if (format == mesh_file_ply) {
+		std::string padding(count_width, ' ');
+		std::string header = "ply\nformat binary_little_endian 1.0\ncomment marching cubes\nelement vertex ";
+		writer.vertex_count_offset = header.size();
+		header += padding + "\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\nelement face ";
+		writer.triangle_count_offset = header.size();
+		header += padding + "\nproperty list uchar int vertex_indices\nend_header\n";
+		write_buffered_file(writer.file, header.data(), header.size());
+		if (indexed) {
+			writer.faces_path = writer.path + ".faces";
+			if (!open_buffered_file(writer.faces, writer.faces_path.c_str())) {
+				writer.error = "Cannot create " + writer.faces_path;
+				close_buffered_file(writer.file);
+				return false;
+			}
+		}
+	}
+	else if (format == mesh_file_stl) {
+		char header[80] = "marching cubes";
+		uint32_t triangle_count = 0;
+		write_buffered_file(writer.file, header, sizeof(header));
+		writer.triangle_count_offset = sizeof(header);
+		write_buffered_file(writer.file, &triangle_count, sizeof(triangle_count));
+	}
+	else {
+		const char header[] = "# marching cubes\n";
+		write_buffered_file(writer.file, header, sizeof(header) - 1);
+	}
+	return true;
+}
+
+// PLY face records, a vertex count then three indices, packed without padding
+static void write_ply_faces(BufferedFile& file, const uint32_t* indices, size_t count) {
+	char record[13] = { 3 };
+	for (size_t t = 0; t + 2 < count; t += 3) {
+		memcpy(record + 1, indices + t, 3 * sizeof(uint32_t));
+		write_buffered_file(file, record, sizeof(record));
+	}
+}
+// OBJ faces, position and normal indices are the same 1-based vertex index
+static void write_obj_faces(BufferedFile& file, const uint32_t* indices, size_t count) {
+	char line[96];
+	for (size_t t = 0; t + 2 < count; t += 3) {
+		char* text = line;
+		*text++ = 'f';
+		for (int v = 0; v < 3; v++) {
+			*text++ = ' ';
+			text = format_integer(text, uint64_t(indices[t + v]) + 1);
+			*text++ = '/';
+			*text++ = '/';
+			text = format_integer(text, uint64_t(indices[t + v]) + 1);
+		}
+		*text++ = '\n';
+		write_buffered_file(file, line, text - line);
+	}
+}
+
+MeshStream mesh_writer_stream(MeshWriter& writer) {
+	MeshStream stream;
+	stream.write_vertices = [&writer](const Vector3* positions, const Vector3* normals, size_t count) {
+		uint32_t first = uint32_t(writer.vertex_count);
+		writer.vertex_count += count;
+		if (writer.format == mesh_file_ply) {
+			for (size_t v = 0; v < count; v++) {
+				const float vertex[6] = { positions[v].x, positions[v].y, positions[v].z, normals[v].x, normals[v].y, normals[v].z };
+				write_buffered_file(writer.file, vertex, sizeof(vertex));
+			}
+			if (!writer.indexed) writer.triangle_count += count / 3;
+		}
+		else if (writer.format == mesh_file_stl) {
+			char facet[50] = {};
+			for (size_t v = 0; v + 2 < count; v += 3) {
+				memcpy(facet, &normals[v], 12);
+				memcpy(facet + 12, &positions[v], 12);
+				memcpy(facet + 24, &positions[v + 1], 12);
+				memcpy(facet + 36, &positions[v + 2], 12);
+				write_buffered_file(writer.file, facet, sizeof(facet));
+			}
+			writer.triangle_count += count / 3;
+		}
+		else {
+			char lines[192];
+			for (size_t v = 0; v < count; v++) {
+				char* text = lines;
+				const Vector3* vectors[2] = { &positions[v], &normals[v] };
+				for (int n = 0; n < 2; n++) {
+					*text++ = 'v';
+					if (n == 1) *text++ = 'n';
+					const float coordinates[3] = { vectors[n]->x, vectors[n]->y, vectors[n]->z };
+					for (float coordinate : coordinates) {
+						*text++ = ' ';
+						text = format_float(text, coordinate);
+					}
+					*text++ = '\n';
+				}
+				write_buffered_file(writer.file, lines, text - lines);
+			}
+			if (!writer.indexed) {
+				uint32_t indices[3];
+				for (size_t v = 0; v + 2 < count; v += 3) {
+					for (int n = 0; n < 3; n++) indices[n] = first + uint32_t(v) + n;
+					write_obj_faces(writer.file, indices, 3);
+				}
+				writer.triangle_count += count / 3;
+			}
+		}
+	};
+	stream.write_indices = [&writer](const uint32_t* indices, size_t count) {
+		writer.triangle_count += count / 3;
+		if (writer.format == mesh_file_ply) write_ply_faces(writer.faces, indices, count);
+		else if (writer.format == mesh_file_obj) write_obj_faces(writer.file, indices, count);
+	};
+	return stream;
+}
+
+bool close_mesh_writer(MeshWriter& writer) {
+	bool written = true;
+	if (writer.format == mesh_file_ply) {
+		if (writer.indexed) {
+			// Appends the side file of triangles after the vertices
+			written = close_buffered_file(writer.faces);
+			std::ifstream faces(writer.faces_path, std::ios::binary);
+			flush_buffered_file(writer.file);
+			while (written && faces) {
+				faces.read(writer.file.buffer.data(), std::streamsize(writer.file.buffer.size()));
+				writer.file.used = size_t(faces.gcount());
+				flush_buffered_file(writer.file);
+			}
+			faces.close();
+			remove(writer.faces_path.c_str());
+		}
+		else {
+			// Unindexed triangles take their three vertices in order
+			for (uint64_t t = 0; t < writer.triangle_count; t++) {
+				uint32_t indices[3] = { uint32_t(t * 3), uint32_t(t * 3 + 1), uint32_t(t * 3 + 2) };
+				write_ply_faces(writer.file, indices, 3);
+			}
+		}
+		write_padded_count(writer.file, writer.vertex_count_offset, writer.vertex_count);
+		write_padded_count(writer.file, writer.triangle_count_offset, writer.triangle_count);
+	}
+	else if (writer.format == mesh_file_stl) {
+		uint32_t triangle_count = uint32_t(writer.triangle_count);
+		patch_buffered_file(writer.file, writer.triangle_count_offset, &triangle_count, sizeof(triangle_count));
+	}
+	written = close_buffered_file(writer.file) && written;
+	if (!written) writer.error = "Cannot write " + writer.path;
+	return written;
+}
+
+uint64_t mesh_writer_bytes(const MeshWriter& writer) {
+	return writer.file.bytes_written;
+}
+
+bool write_mesh_file(MeshWriter& writer, const char* path, MeshFileFormat format, size_t vertex_count, const std::function<MeshVertex(uint32_t)>& vertex,
+	const uint32_t* indices, size_t index_count) {
+	bool indexed = index_count > 0;
+	bool expand = indexed && format == mesh_file_stl;
+	if (!open_mesh_writer(writer, path, format, indexed && !expand)) return false;
+	MeshStream stream = mesh_writer_stream(writer);
+	// Vertices go to the writer in blocks of whole triangles
+	const size_t block_size = 3 * 1024;
+	std::vector<Vector3> positions, normals;
+	auto write_block = [&]() {
+		if (!positions.empty()) stream.write_vertices(positions.data(), normals.data(), positions.size());
+		positions.clear();
+		normals.clear();
+	};
+	if (expand) {
+		for (size_t i = 0; i + 2 < index_count; i += 3) {
+			Vector3 p1 = vertex(indices[i]).position;
+			Vector3 p2 = vertex(indices[i + 1]).position;
+			Vector3 p3 = vertex(indices[i + 2]).position;
+			Vector3 normal = normalize(cross(p2 - p1, p3 - p1));
+			positions.insert(positions.end(), { p1, p2, p3 });
+			normals.insert(normals.end(), { normal, normal, normal });
+			if (positions.size() >= block_size) write_block();
+		}
+	}
+	else {
+		for (size_t v = 0; v < vertex_count; v++) {
+			MeshVertex decoded = vertex(uint32_t(v));
+			positions.push_back(decoded.position);
+			normals.push_back(decoded.normal);
+			if (positions.size() >= block_size) write_block();
+		}
+	}
+	write_block();
+	if (indexed && !expand) stream.write_indices(indices, index_count);
+	return close_mesh_writer(writer);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Mesh files written while the mesh is extracted, fed through a MeshStream so the whole mesh never has to be held
+//  - Binary little endian PLY with positions, normals and triangles. The triangles of indexed meshes arrive mixed
+//    with the vertices, so they go to a side file appended after the vertices when the writer closes
+//  - Binary STL, one facet per triangle with its face normal. STL has no shared vertices, meshes must be unindexed
+//  - OBJ with positions, normals and 1-based triangles, written as they arrive
+// Counts only known at the end are reserved in the header and written when the writer closes
+
+#include "MarchingCubes.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// Bytes gathered before each write to a file
+const size_t buffered_file_size = 1 << 20;
+
+// Output file written in blocks of buffered_file_size bytes
+typedef struct BufferedFile {
+	std::ofstream file;
+	std::vector<char> buffer;
+	size_t used = 0;
+	uint64_t bytes_written = 0;
+	bool failed = false;
+} BufferedFile;
+
+bool open_buffered_file(BufferedFile& file, const char* path);
+void write_buffered_file(BufferedFile& file, const void* data, size_t size);
+void flush_buffered_file(BufferedFile& file);
+// Writes size bytes at offset, in a part of the file already flushed
+void patch_buffered_file(BufferedFile& file, uint64_t offset, const void* data, size_t size);
+// Flushes and closes the file, returning false if any write failed
+bool close_buffered_file(BufferedFile& file);
+
+enum MeshFileFormat {
+	mesh_file_ply,
+	mesh_file_stl,
+	mesh_file_obj
+};
+
+typedef struct MeshWriter {
+	MeshFileFormat format = mesh_file_ply;
+	bool indexed = true;
+	std::string path;
+	BufferedFile file;
+	// Triangles of indexed PLY files until the vertices are all written
+	BufferedFile faces;
+	std::string faces_path;
+	// Where the counts go in the header
+	uint64_t vertex_count_offset = 0;
+	uint64_t triangle_count_offset = 0;
+	uint64_t vertex_count = 0;
+	uint64_t triangle_count = 0;
+	std::string error;
+} MeshWriter;
+
+bool open_mesh_writer(MeshWriter& writer, const char* path, MeshFileFormat format, bool indexed);
+// Stream writing to the writer, valid while the writer is
+MeshStream mesh_writer_stream(MeshWriter& writer);
+// Completes the file, returning false with the reason in error if anything could not be written
+bool close_mesh_writer(MeshWriter& writer);
+uint64_t mesh_writer_bytes(const MeshWriter& writer);
+
+// Writes a whole mesh held in memory to path, vertex giving each of the vertex_count vertices in the layout they
+// are kept in. STL expands indexed meshes into separate triangles with the face normal of every triangle
+bool write_mesh_file(MeshWriter& writer, const char* path, MeshFileFormat format, size_t vertex_count, const std::function<MeshVertex(uint32_t)>& vertex,
+	const uint32_t* indices, size_t index_count);
+
+// Shortest text that reads back as the same float, returning the end
+// At most 15 characters, without a terminating zero
+char* format_float(char* text, float value);
+char* format_integer(char* text, uint64_t value);
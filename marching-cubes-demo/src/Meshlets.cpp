@@ -0,0 +1,233 @@
+#include "Meshlets.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const uint8_t no_slot = 0xff;
+
+// Scratch buffers of a build, kept per calling thread so their capacity is reused
+typedef struct MeshletWorkspace {
+	// Triangles around every vertex, vertex_triangles[triangle_offsets[v]] on
+	std::vector<uint32_t> triangle_offsets;
+	std::vector<uint32_t> vertex_triangles;
+	std::vector<uint8_t> emitted;
+	// Triangles around every vertex no meshlet took yet
+	std::vector<uint32_t> live_triangles;
+	// Place of every vertex in the meshlet being built, no_slot when it is not in it
+	std::vector<uint8_t> slots;
+} MeshletWorkspace;
+static MeshletWorkspace& meshlet_workspace() {
+	static thread_local MeshletWorkspace workspace;
+	return workspace;
+}
+
+static Vector3 position_of(const float* positions, size_t position_stride, uint32_t v) {
+	const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * position_stride);
+	return Vector3(position[0], position[1], position[2]);
+}
+
+// Bounding sphere around the center of the bounding box, and the cone of the normals with its apex behind the
+// plane of every triangle
+static void compute_meshlet_bounds(const float* positions, size_t position_stride, const MeshletMesh& meshlets, Meshlet& meshlet) {
+	const uint32_t* vertices = meshlets.vertices.data() + meshlet.vertex_offset;
+	const uint8_t* triangles = meshlets.triangles.data() + meshlet.triangle_offset;
+	Vector3 low = position_of(positions, position_stride, vertices[0]);
+	Vector3 high = low;
+	for (uint32_t v = 1; v < meshlet.vertex_count; v++) {
+		Vector3 position = position_of(positions, position_stride, vertices[v]);
+		low = Vector3(std::min(low.x, position.x), std::min(low.y, position.y), std::min(low.z, position.z));
+		high = Vector3(std::max(high.x, position.x), std::max(high.y, position.y), std::max(high.z, position.z));
+	}
+	meshlet.center = 0.5f * (low + high);
+	float radius = 0;
+	for (uint32_t v = 0; v < meshlet.vertex_count; v++) {
+		Vector3 offset = position_of(positions, position_stride, vertices[v]) - meshlet.center;
+		radius = std::max(radius, dot(offset, offset));
+	}
+	meshlet.radius = sqrtf(radius);
+
+	Vector3 normals[max_meshlet_triangles];
+	Vector3 corners[max_meshlet_triangles];
+	int normal_count = 0;
+	Vector3 axis;
+	for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+		Vector3 p0 = position_of(positions, position_stride, vertices[triangles[t * 3]]);
+		Vector3 p1 = position_of(positions, position_stride, vertices[triangles[t * 3 + 1]]);
+		Vector3 p2 = position_of(positions, position_stride, vertices[triangles[t * 3 + 2]]);
+		Vector3 normal = cross(p1 - p0, p2 - p0);
+		if (dot(normal, normal) == 0) continue;
+		normals[normal_count] = normalize(normal);
+		corners[normal_count++] = p0;
+		axis = axis + normals[normal_count - 1];
+	}
+	meshlet.cone_apex = meshlet.center;
+	meshlet.cone_axis = normalize(axis);
+	meshlet.cone_cutoff = 2.0f;
+	float min_dot = 1.0f;
+	for (int n = 0; n < normal_count; n++) min_dot = std::min(min_dot, dot(normals[n], meshlet.cone_axis));
+	// Normals spreading over a half space or more never face away together
+	if (!normal_count || min_dot <= 0.1f) return;
+	float apex_distance = 0;
+	for (int n = 0; n < normal_count; n++) {
+		apex_distance = std::max(apex_distance, dot(meshlet.center - corners[n], normals[n]) / dot(meshlet.cone_axis, normals[n]));
+	}
+	meshlet.cone_apex = meshlet.center - apex_distance * meshlet.cone_axis;
+	meshlet.cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+void build_meshlets(const float* positions, size_t vertex_count, size_t position_stride, const uint32_t* indices, size_t index_count, MeshletMesh& meshlets) {
+	meshlets.meshlets.clear();
+	meshlets.vertices.clear();
+	meshlets.triangles.clear();
+	size_t triangle_count = index_count / 3;
+	if (!triangle_count) return;
+	MeshletWorkspace& workspace = meshlet_workspace();
+	std::vector<uint32_t>& offsets = workspace.triangle_offsets;
+	std::vector<uint32_t>& vertex_triangles = workspace.vertex_triangles;
+	std::vector<uint8_t>& emitted = workspace.emitted;
+	std::vector<uint8_t>& slots = workspace.slots;
+	std::vector<uint32_t>& live_triangles = workspace.live_triangles;
+	offsets.assign(vertex_count + 1, 0);
+	for (size_t i = 0; i < index_count; i++) offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+	vertex_triangles.resize(index_count);
+	for (size_t i = 0; i < index_count; i++) vertex_triangles[offsets[indices[i]]++] = uint32_t(i / 3);
+	// The fill moved every offset to the start of the next vertex
+	for (size_t v = vertex_count; v > 0; v--) offsets[v] = offsets[v - 1];
+	offsets[0] = 0;
+	live_triangles.resize(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++) live_triangles[v] = offsets[v + 1] - offsets[v];
+	emitted.assign(triangle_count, 0);
+	slots.assign(vertex_count, no_slot);
+
+	size_t seed = 0;
+	for (;;) {
+		while (seed < triangle_count && emitted[seed]) seed++;
+		if (seed == triangle_count) break;
+		Meshlet meshlet = {};
+		meshlet.vertex_offset = uint32_t(meshlets.vertices.size());
+		meshlet.triangle_offset = uint32_t(meshlets.triangles.size());
+		size_t next = seed;
+		// Meshlet vertices before open_vertex have no triangles left
+		uint32_t open_vertex = meshlet.vertex_offset;
+		while (next != triangle_count) {
+			emitted[next] = 1;
+			for (int c = 0; c < 3; c++) {
+				uint32_t v = indices[next * 3 + c];
+				live_triangles[v]--;
+				if (slots[v] == no_slot) {
+					slots[v] = uint8_t(meshlet.vertex_count++);
+					meshlets.vertices.push_back(v);
+				}
+				meshlets.triangles.push_back(slots[v]);
+			}
+			if (++meshlet.triangle_count == max_meshlet_triangles) break;
+
+			// The triangle around the meshlet vertices bringing the fewest new vertices that still fit
+			next = triangle_count;
+			int fewest = 3;
+			while (open_vertex < meshlets.vertices.size() && !live_triangles[meshlets.vertices[open_vertex]]) open_vertex++;
+			for (uint32_t m = open_vertex; m < meshlets.vertices.size() && fewest; m++) {
+				uint32_t v = meshlets.vertices[m];
+				if (!live_triangles[v]) continue;
+				for (uint32_t r = offsets[v]; r < offsets[v + 1]; r++) {
+					uint32_t t = vertex_triangles[r];
+					if (emitted[t]) continue;
+					int added = 0;
+					for (int c = 0; c < 3; c++) added += slots[indices[t * 3 + c]] == no_slot;
+					if (added >= fewest && next != triangle_count) continue;
+					if (meshlet.vertex_count + added > uint32_t(max_meshlet_vertices)) continue;
+					next = t;
+					fewest = added;
+					if (!fewest) break;
+				}
+			}
+		}
+		for (uint32_t m = meshlet.vertex_offset; m < meshlets.vertices.size(); m++) slots[meshlets.vertices[m]] = no_slot;
+		compute_meshlet_bounds(positions, position_stride, meshlets, meshlet);
+		meshlets.meshlets.push_back(meshlet);
+	}
+}
+
+void build_meshlets(const std::vector<const MarchingCubesMesh*>& meshes, std::vector<MeshletMesh>& meshlets) {
+	meshlets.resize(meshes.size());
+	parallel_for(int(meshes.size()), [&](int m) {
+		build_meshlets(*meshes[m], meshlets[m]);
+	});
+}
+
+MeshletFrustum camera_frustum(const MeshletCamera& camera) {
+	Vector3 forward = normalize(camera.target - camera.position);
+	Vector3 right = normalize(cross(forward, camera.up));
+	Vector3 up = cross(right, forward);
+	float tan_y = tanf(camera.field_of_view / 2.0f);
+	float tan_x = tan_y * camera.aspect;
+	MeshletFrustum frustum;
+	frustum.normals[0] = forward;
+	frustum.distances[0] = dot(forward, camera.position) + camera.near_plane;
+	frustum.normals[1] = -1.0f * forward;
+	frustum.distances[1] = -dot(forward, camera.position) - camera.far_plane;
+	// Side planes through the camera, a point at depth d along forward is inside while its offset along right or
+	// up is within d times the tangent of the half angle
+	frustum.normals[2] = normalize(tan_x * forward + right);
+	frustum.normals[3] = normalize(tan_x * forward - right);
+	frustum.normals[4] = normalize(tan_y * forward + up);
+	frustum.normals[5] = normalize(tan_y * forward - up);
+	for (int plane = 2; plane < 6; plane++) frustum.distances[plane] = dot(frustum.normals[plane], camera.position);
+	return frustum;
+}
+
+MeshletCullingStats run_meshlet_culling_script(const std::vector<const MarchingCubesMesh*>& meshes, const std::vector<MeshletMesh>& meshlets,
+	const std::vector<MeshletCamera>& path) {
+	MeshletCullingStats stats;
+	std::vector<uint8_t> culled;
+	for (const MeshletCamera& camera : path) {
+		MeshletFrustum frustum = camera_frustum(camera);
+		for (size_t m = 0; m < meshes.size(); m++) {
+			const MarchingCubesMesh& mesh = *meshes[m];
+			const MeshletMesh& mesh_meshlets = meshlets[m];
+			auto culling_start = std::chrono::high_resolution_clock::now();
+			culled.assign(mesh_meshlets.meshlets.size(), 0);
+			for (size_t c = 0; c < mesh_meshlets.meshlets.size(); c++) {
+				const Meshlet& meshlet = mesh_meshlets.meshlets[c];
+				if (meshlet_outside_frustum(meshlet, frustum)) {
+					culled[c] = 1;
+					stats.frustum_culled++;
+				}
+				else if (meshlet_backfacing(meshlet, camera.position)) {
+					culled[c] = 1;
+					stats.backface_culled++;
+				}
+			}
+			stats.culling_time += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - culling_start).count();
+			stats.meshlets += mesh_meshlets.meshlets.size();
+
+			// Every triangle against the view on its own
+			for (size_t c = 0; c < mesh_meshlets.meshlets.size(); c++) {
+				const Meshlet& meshlet = mesh_meshlets.meshlets[c];
+				for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+					Vector3 p[3];
+					for (int corner = 0; corner < 3; corner++) {
+						uint32_t slot = mesh_meshlets.triangles[meshlet.triangle_offset + t * 3 + corner];
+						p[corner] = mesh.vertices[mesh_meshlets.vertices[meshlet.vertex_offset + slot]].position;
+					}
+					bool invisible = dot(cross(p[1] - p[0], p[2] - p[0]), camera.position - p[0]) < 0;
+					for (int plane = 0; plane < 6 && !invisible; plane++) {
+						bool outside = true;
+						for (int corner = 0; corner < 3; corner++) outside &= dot(frustum.normals[plane], p[corner]) < frustum.distances[plane];
+						invisible = outside;
+					}
+					stats.triangles++;
+					stats.invisible_triangles += invisible;
+					stats.culled_triangles += culled[c];
+					stats.wrongly_culled += culled[c] && !invisible;
+				}
+			}
+		}
+		stats.frames++;
+	}
+	return stats;
+}
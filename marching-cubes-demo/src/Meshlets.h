@@ -0,0 +1,101 @@
+#pragma once
+
+// Meshlets, clusters of at most max_meshlet_vertices vertices and max_meshlet_triangles triangles of an indexed
+// mesh, small enough to be culled and streamed on their own
+// A meshlet starts from the first triangle no meshlet took yet and grows around it, adding the triangle next to
+// its vertices that brings the fewest new vertices, with its oldest vertices looked at first so it grows outward
+// evenly instead of along a strip. It ends when it is full or nothing next to it fits
+// Every meshlet gets a bounding sphere for frustum culling and a cone holding the normals of its triangles for
+// backface culling of the whole meshlet. Nothing here depends on Direct3D, so the culling runs headless
+
+#include "MarchingCubes.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+const int max_meshlet_vertices = 64;
+const int max_meshlet_triangles = 124;
+
+typedef struct Meshlet {
+	// Ranges of the meshlet in the vertices and triangles of its MeshletMesh
+	uint32_t vertex_offset;
+	uint32_t triangle_offset;
+	uint32_t vertex_count;
+	uint32_t triangle_count;
+	Vector3 center;
+	float radius;
+	// Every triangle faces away from a camera at position when dot(normalize(cone_apex - position), cone_axis) is
+	// cone_cutoff or more. The cutoff is above 1 when the normals spread too wide to ever cull the meshlet
+	Vector3 cone_apex;
+	Vector3 cone_axis;
+	float cone_cutoff;
+} Meshlet;
+
+typedef struct MeshletMesh {
+	std::vector<Meshlet> meshlets;
+	// Mesh vertices of every meshlet
+	std::vector<uint32_t> vertices;
+	// Three meshlet vertices per triangle
+	std::vector<uint8_t> triangles;
+} MeshletMesh;
+
+// Builds the meshlets of indexed triangles over positions of three floats every position_stride bytes, so the
+// positions can be read straight from a vertex buffer
+void build_meshlets(const float* positions, size_t vertex_count, size_t position_stride, const uint32_t* indices, size_t index_count, MeshletMesh& meshlets);
+inline void build_meshlets(const MarchingCubesMesh& mesh, MeshletMesh& meshlets) {
+	const float* positions = mesh.vertices.empty() ? nullptr : &mesh.vertices[0].position.x;
+	build_meshlets(positions, mesh.vertices.size(), sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size(), meshlets);
+}
+// Builds the meshlets of independent meshes, such as the chunks of a world, concurrently, one task per mesh
+void build_meshlets(const std::vector<const MarchingCubesMesh*>& meshes, std::vector<MeshletMesh>& meshlets);
+
+typedef struct MeshletCamera {
+	Vector3 position;
+	Vector3 target;
+	Vector3 up = Vector3(0, 1, 0);
+	// Vertical field of view in radians and width over height
+	float field_of_view = 0.785398f;
+	float aspect = 16.0f / 9.0f;
+	float near_plane = 0.01f;
+	float far_plane = 1000.0f;
+} MeshletCamera;
+
+// Planes of the view of a camera, inside where dot(normal, position) >= distance for all of them
+typedef struct MeshletFrustum {
+	Vector3 normals[6];
+	float distances[6];
+} MeshletFrustum;
+MeshletFrustum camera_frustum(const MeshletCamera& camera);
+
+inline bool meshlet_outside_frustum(const Meshlet& meshlet, const MeshletFrustum& frustum) {
+	for (int plane = 0; plane < 6; plane++) {
+		if (dot(frustum.normals[plane], meshlet.center) - frustum.distances[plane] < -meshlet.radius) return true;
+	}
+	return false;
+}
+inline bool meshlet_backfacing(const Meshlet& meshlet, Vector3 camera_position) {
+	return dot(normalize(meshlet.cone_apex - camera_position), meshlet.cone_axis) >= meshlet.cone_cutoff;
+}
+
+typedef struct MeshletCullingStats {
+	// Summed over the frames of the run
+	size_t frames = 0;
+	size_t meshlets = 0;
+	size_t frustum_culled = 0;
+	size_t backface_culled = 0;
+	size_t triangles = 0;
+	size_t culled_triangles = 0;
+	// Triangles facing away from the camera or with all their vertices outside one plane of the view, the ones
+	// culling every triangle on its own would drop
+	size_t invisible_triangles = 0;
+	// Triangles of culled meshlets that are not invisible, 0 as the tests are conservative
+	size_t wrongly_culled = 0;
+	// Milliseconds spent testing meshlets
+	double culling_time = 0;
+} MeshletCullingStats;
+
+// Culls the meshlets of every mesh for every camera of a scripted path and checks every triangle against the
+// result, meshes and meshlets matching one to one
+MeshletCullingStats run_meshlet_culling_script(const std::vector<const MarchingCubesMesh*>& meshes, const std::vector<MeshletMesh>& meshlets,
+	const std::vector<MeshletCamera>& path);
@@ -0,0 +1,75 @@
+#include "MinMaxPyramid.h"
+
+#include <utility>
+
+void build_min_max_levels(MinMaxPyramid& pyramid) {
+	while (pyramid.levels.back().blocks > 1) {
+		const MinMaxLevel& lower = pyramid.levels.back();
+		MinMaxLevel level;
+		level.blocks = (lower.blocks + 1) / 2;
+		level.min_values.resize(size_t(level.blocks) * level.blocks * level.blocks);
+		level.max_values.resize(size_t(level.blocks) * level.blocks * level.blocks);
+		for (int bi = 0; bi < level.blocks; bi++) {
+			for (int bj = 0; bj < level.blocks; bj++) {
+				for (int bk = 0; bk < level.blocks; bk++) {
+					size_t block = (size_t(level.blocks) * bi + bj) * level.blocks + bk;
+					size_t first_child = (size_t(lower.blocks) * bi * 2 + bj * 2) * lower.blocks + bk * 2;
+					float min_value = lower.min_values[first_child];
+					float max_value = lower.max_values[first_child];
+					// Children past the end of an odd sized level do not exist
+					for (int ci = bi * 2; ci < bi * 2 + 2 && ci < lower.blocks; ci++) {
+						for (int cj = bj * 2; cj < bj * 2 + 2 && cj < lower.blocks; cj++) {
+							for (int ck = bk * 2; ck < bk * 2 + 2 && ck < lower.blocks; ck++) {
+								size_t child = (size_t(lower.blocks) * ci + cj) * lower.blocks + ck;
+								min_value = lower.min_values[child] < min_value ? lower.min_values[child] : min_value;
+								max_value = lower.max_values[child] > max_value ? lower.max_values[child] : max_value;
+							}
+						}
+					}
+					level.min_values[block] = min_value;
+					level.max_values[block] = max_value;
+				}
+			}
+		}
+		pyramid.levels.push_back(std::move(level));
+	}
+}
+
+static size_t mark_active_blocks(const MinMaxPyramid& pyramid, float threshold, int level_index, int bi, int bj, int bk,
+	uint8_t* active, uint8_t* active_rows) {
+	const MinMaxLevel& level = pyramid.levels[level_index];
+	if (bi >= level.blocks || bj >= level.blocks || bk >= level.blocks) return 0;
+	size_t block = (size_t(level.blocks) * bi + bj) * level.blocks + bk;
+	if (!block_straddles(level.min_values[block], level.max_values[block], threshold)) return 0;
+	if (level_index == 0) {
+		if (active) active[block] = 1;
+		if (active_rows) active_rows[size_t(level.blocks) * bi + bj] = 1;
+		return 1;
+	}
+	size_t count = 0;
+	for (int child = 0; child < 8; child++) {
+		count += mark_active_blocks(pyramid, threshold, level_index - 1, bi * 2 + (child >> 2), bj * 2 + ((child >> 1) & 1), bk * 2 + (child & 1), active, active_rows);
+	}
+	return count;
+}
+
+size_t find_active_blocks(const MinMaxPyramid& pyramid, float threshold, std::vector<uint8_t>& active, std::vector<uint8_t>& active_rows) {
+	if (pyramid.levels.empty()) return 0;
+	int blocks = pyramid.levels[0].blocks;
+	active.assign(size_t(blocks) * blocks * blocks, 0);
+	active_rows.assign(size_t(blocks) * blocks, 0);
+	return mark_active_blocks(pyramid, threshold, int(pyramid.levels.size()) - 1, 0, 0, 0, active.data(), active_rows.data());
+}
+
+size_t count_active_blocks(const MinMaxPyramid& pyramid, float threshold) {
+	if (pyramid.levels.empty()) return 0;
+	return mark_active_blocks(pyramid, threshold, int(pyramid.levels.size()) - 1, 0, 0, 0, nullptr, nullptr);
+}
+
+size_t min_max_pyramid_memory(const MinMaxPyramid& pyramid) {
+	size_t bytes = 0;
+	for (const MinMaxLevel& level : pyramid.levels) {
+		bytes += (level.min_values.size() + level.max_values.size()) * sizeof(float);
+	}
+	return bytes;
+}
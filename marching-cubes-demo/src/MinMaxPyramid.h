@@ -0,0 +1,90 @@
+#pragma once
+
+// Min/max block pyramid over a resolution^3 grid, built once per grid and used to skip the blocks the surface
+// cannot go through whatever the threshold
+// Level 0 splits the cells into blocks of min_max_block_size^3 cells, each block storing the range of the points
+// of its cells, borders included. Every level above merges 2x2x2 blocks of the one below, up to a single block
+
+#include "Parallel.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+const int min_max_block_size = 16;
+
+typedef struct MinMaxLevel {
+	// Blocks along each axis, block (bi, bj, bk) is stored at (blocks * bi + bj) * blocks + bk
+	int blocks;
+	std::vector<float> min_values;
+	std::vector<float> max_values;
+} MinMaxLevel;
+
+typedef struct MinMaxPyramid {
+	int resolution = 0;
+	std::vector<MinMaxLevel> levels;
+} MinMaxPyramid;
+
+// Blocks along each axis of level 0, cells are split in blocks and points belong to the block of their cell,
+// the last point of every axis to the last block
+inline int min_max_blocks(int resolution) {
+	return (resolution - 1 + min_max_block_size - 1) / min_max_block_size;
+}
+inline int point_block(int point, int blocks) {
+	int block = point / min_max_block_size;
+	return block < blocks ? block : blocks - 1;
+}
+// A block can only hold crossings when some of its points are below the threshold and some are not
+inline bool block_straddles(float min_value, float max_value, float threshold) {
+	return min_value < threshold && max_value >= threshold;
+}
+
+// Builds the levels above level 0 once its ranges are filled
+void build_min_max_levels(MinMaxPyramid& pyramid);
+
+template <typename Scalar>
+void build_min_max_pyramid(const Scalar* grid, int resolution, MinMaxPyramid& pyramid) {
+	pyramid.resolution = resolution;
+	pyramid.levels.clear();
+	if (resolution < 2) return;
+	int blocks = min_max_blocks(resolution);
+	pyramid.levels.resize(1);
+	MinMaxLevel& leaves = pyramid.levels[0];
+	leaves.blocks = blocks;
+	leaves.min_values.resize(size_t(blocks) * blocks * blocks);
+	leaves.max_values.resize(size_t(blocks) * blocks * blocks);
+	parallel_for(blocks, [&](int bi) {
+		int last_i = (bi + 1) * min_max_block_size < resolution - 1 ? (bi + 1) * min_max_block_size : resolution - 1;
+		for (int bj = 0; bj < blocks; bj++) {
+			int last_j = (bj + 1) * min_max_block_size < resolution - 1 ? (bj + 1) * min_max_block_size : resolution - 1;
+			for (int bk = 0; bk < blocks; bk++) {
+				int last_k = (bk + 1) * min_max_block_size < resolution - 1 ? (bk + 1) * min_max_block_size : resolution - 1;
+				float min_value = float(grid[(size_t(resolution) * bi * min_max_block_size + bj * min_max_block_size) * resolution + bk * min_max_block_size]);
+				float max_value = min_value;
+				for (int i = bi * min_max_block_size; i <= last_i; i++) {
+					for (int j = bj * min_max_block_size; j <= last_j; j++) {
+						const Scalar* row = grid + (size_t(resolution) * i + j) * resolution;
+						for (int k = bk * min_max_block_size; k <= last_k; k++) {
+							float value = float(row[k]);
+							min_value = value < min_value ? value : min_value;
+							max_value = value > max_value ? value : max_value;
+						}
+					}
+				}
+				size_t block = (size_t(blocks) * bi + bj) * blocks + bk;
+				leaves.min_values[block] = min_value;
+				leaves.max_values[block] = max_value;
+			}
+		}
+	});
+	build_min_max_levels(pyramid);
+}
+
+// Marks the level 0 blocks whose range straddles the threshold, descending from the top level so whole regions
+// are skipped at once. active_rows marks the (bi, bj) rows of blocks with any active block
+// Returns the number of active blocks
+size_t find_active_blocks(const MinMaxPyramid& pyramid, float threshold, std::vector<uint8_t>& active, std::vector<uint8_t>& active_rows);
+// Same traversal, only counting the active blocks
+size_t count_active_blocks(const MinMaxPyramid& pyramid, float threshold);
+
+size_t min_max_pyramid_memory(const MinMaxPyramid& pyramid);
@@ -0,0 +1,356 @@
+#include "Noise.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NOISE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SSE
+#endif
+
+// Lane types, the noise kernels are written once over them. Masks have all the bits of a lane set or cleared,
+// integers are unsigned 32 bit and wrap around
+typedef struct ScalarLanes {
+	typedef float Float;
+	typedef uint32_t Int;
+	typedef bool Mask;
+	static Float broadcast(float value) { return value; }
+	static Int broadcast_int(uint32_t value) { return value; }
+	static Float floor(Float value) { return std::floor(value); }
+	// Of floored values, exact
+	static Int to_int(Float value) { return uint32_t(int32_t(value)); }
+	static Int multiply(Int a, Int b) { return a * b; }
+	static Int shift_right(Int value, int bits) { return value >> bits; }
+	static Mask less(Float a, Float b) { return a < b; }
+	static Mask greater_equal(Float a, Float b) { return a >= b; }
+	static Mask less_int(Int a, Int b) { return int32_t(a) < int32_t(b); }
+	static Mask equal_int(Int a, Int b) { return a == b; }
+	static Mask both(Mask a, Mask b) { return a && b; }
+	static Mask either(Mask a, Mask b) { return a || b; }
+	static Mask invert(Mask a) { return !a; }
+	static Float select(Mask mask, Float a, Float b) { return mask ? a : b; }
+	static Int select_int(Mask mask, Int a, Int b) { return mask ? a : b; }
+	// Flips the sign of value where bit 31 of sign is set
+	static Float flip_sign(Float value, Int sign) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		bits ^= sign & 0x80000000u;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	static Float abs(Float value) { return std::fabs(value); }
+	static Float min(Float a, Float b) { return a < b ? a : b; }
+	static Float max(Float a, Float b) { return a > b ? a : b; }
+} ScalarLanes;
+
+#if defined(NOISE_SSE)
+typedef struct Float4 {
+	__m128 v;
+} Float4;
+typedef struct Int4 {
+	__m128i v;
+} Int4;
+inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline Int4 operator+(Int4 a, Int4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+inline Int4 operator^(Int4 a, Int4 b) { return { _mm_xor_si128(a.v, b.v) }; }
+inline Int4 operator&(Int4 a, Int4 b) { return { _mm_and_si128(a.v, b.v) }; }
+inline Int4 operator<<(Int4 a, int bits) { return { _mm_slli_epi32(a.v, bits) }; }
+
+typedef struct SseLanes {
+	typedef Float4 Float;
+	typedef Int4 Int;
+	typedef Int4 Mask;
+	static Float broadcast(float value) { return { _mm_set1_ps(value) }; }
+	static Int broadcast_int(uint32_t value) { return { _mm_set1_epi32(int(value)) }; }
+	static Float floor(Float value) {
+		// Truncation rounds negative values up, those step one down
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value.v));
+		return { _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, value.v), _mm_set1_ps(1.0f))) };
+	}
+	static Int to_int(Float value) { return { _mm_cvttps_epi32(value.v) }; }
+	static Int multiply(Int a, Int b) {
+		// Low halves of the products of the even and of the odd lanes, SSE2 has no 32 bit multiply
+		__m128i even = _mm_mul_epu32(a.v, b.v);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+		return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+	}
+	static Int shift_right(Int value, int bits) { return { _mm_srli_epi32(value.v, bits) }; }
+	static Mask less(Float a, Float b) { return { _mm_castps_si128(_mm_cmplt_ps(a.v, b.v)) }; }
+	static Mask greater_equal(Float a, Float b) { return { _mm_castps_si128(_mm_cmpge_ps(a.v, b.v)) }; }
+	static Mask less_int(Int a, Int b) { return { _mm_cmplt_epi32(a.v, b.v) }; }
+	static Mask equal_int(Int a, Int b) { return { _mm_cmpeq_epi32(a.v, b.v) }; }
+	static Mask both(Mask a, Mask b) { return { _mm_and_si128(a.v, b.v) }; }
+	static Mask either(Mask a, Mask b) { return { _mm_or_si128(a.v, b.v) }; }
+	static Mask invert(Mask a) { return { _mm_xor_si128(a.v, _mm_set1_epi32(-1)) }; }
+	static Float select(Mask mask, Float a, Float b) {
+		__m128 m = _mm_castsi128_ps(mask.v);
+		return { _mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v)) };
+	}
+	static Int select_int(Mask mask, Int a, Int b) { return { _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v)) }; }
+	static Float flip_sign(Float value, Int sign) {
+		return { _mm_xor_ps(value.v, _mm_castsi128_ps(_mm_and_si128(sign.v, _mm_set1_epi32(int(0x80000000u))))) };
+	}
+	static Float abs(Float value) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), value.v) }; }
+	static Float min(Float a, Float b) { return { _mm_min_ps(a.v, b.v) }; }
+	static Float max(Float a, Float b) { return { _mm_max_ps(a.v, b.v) }; }
+} SseLanes;
+#endif
+
+#if defined(NOISE_AVX2)
+typedef struct Float8 {
+	__m256 v;
+} Float8;
+typedef struct Int8 {
+	__m256i v;
+} Int8;
+inline Float8 operator+(Float8 a, Float8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline Float8 operator-(Float8 a, Float8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Float8 operator*(Float8 a, Float8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline Int8 operator+(Int8 a, Int8 b) { return { _mm256_add_epi32(a.v, b.v) }; }
+inline Int8 operator^(Int8 a, Int8 b) { return { _mm256_xor_si256(a.v, b.v) }; }
+inline Int8 operator&(Int8 a, Int8 b) { return { _mm256_and_si256(a.v, b.v) }; }
+inline Int8 operator<<(Int8 a, int bits) { return { _mm256_slli_epi32(a.v, bits) }; }
+
+typedef struct Avx2Lanes {
+	typedef Float8 Float;
+	typedef Int8 Int;
+	typedef Int8 Mask;
+	static Float broadcast(float value) { return { _mm256_set1_ps(value) }; }
+	static Int broadcast_int(uint32_t value) { return { _mm256_set1_epi32(int(value)) }; }
+	static Float floor(Float value) { return { _mm256_floor_ps(value.v) }; }
+	static Int to_int(Float value) { return { _mm256_cvttps_epi32(value.v) }; }
+	static Int multiply(Int a, Int b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+	static Int shift_right(Int value, int bits) { return { _mm256_srli_epi32(value.v, bits) }; }
+	static Mask less(Float a, Float b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)) }; }
+	static Mask greater_equal(Float a, Float b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)) }; }
+	static Mask less_int(Int a, Int b) { return { _mm256_cmpgt_epi32(b.v, a.v) }; }
+	static Mask equal_int(Int a, Int b) { return { _mm256_cmpeq_epi32(a.v, b.v) }; }
+	static Mask both(Mask a, Mask b) { return { _mm256_and_si256(a.v, b.v) }; }
+	static Mask either(Mask a, Mask b) { return { _mm256_or_si256(a.v, b.v) }; }
+	static Mask invert(Mask a) { return { _mm256_xor_si256(a.v, _mm256_set1_epi32(-1)) }; }
+	static Float select(Mask mask, Float a, Float b) { return { _mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(mask.v)) }; }
+	static Int select_int(Mask mask, Int a, Int b) { return { _mm256_blendv_epi8(b.v, a.v, mask.v) }; }
+	static Float flip_sign(Float value, Int sign) {
+		return { _mm256_xor_ps(value.v, _mm256_castsi256_ps(_mm256_and_si256(sign.v, _mm256_set1_epi32(int(0x80000000u))))) };
+	}
+	static Float abs(Float value) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value.v) }; }
+	static Float min(Float a, Float b) { return { _mm256_min_ps(a.v, b.v) }; }
+	static Float max(Float a, Float b) { return { _mm256_max_ps(a.v, b.v) }; }
+} Avx2Lanes;
+#endif
+
+// Lattice coordinates are multiplied by a prime per axis and mixed with the seed
+static const uint32_t prime_x = 501125321u;
+static const uint32_t prime_y = 1136930381u;
+static const uint32_t prime_z = 1720413743u;
+static const uint32_t hash_multiplier = 0x27D4EB2Du;
+
+// Dot product of the offset with one of the 12 edge gradients of the cube, picked by the top 4 bits of the hash
+template <typename L>
+typename L::Float gradient_dot(typename L::Int seed, typename L::Int x, typename L::Int y, typename L::Int z,
+	typename L::Float dx, typename L::Float dy, typename L::Float dz) {
+	typename L::Int h = L::shift_right(L::multiply(seed ^ x ^ y ^ z, L::broadcast_int(hash_multiplier)), 28);
+	typename L::Float u = L::select(L::less_int(h, L::broadcast_int(8)), dx, dy);
+	typename L::Mask v_is_x = L::equal_int(h & L::broadcast_int(13), L::broadcast_int(12));
+	typename L::Float v = L::select(L::less_int(h, L::broadcast_int(4)), dy, L::select(v_is_x, dx, dz));
+	return L::flip_sign(u, h << 31) + L::flip_sign(v, h << 30);
+}
+
+template <typename L>
+typename L::Float gradient_noise(typename L::Int seed, typename L::Float x, typename L::Float y, typename L::Float z) {
+	typedef typename L::Float F;
+	typedef typename L::Int I;
+	F floor_x = L::floor(x), floor_y = L::floor(y), floor_z = L::floor(z);
+	I x0 = L::multiply(L::to_int(floor_x), L::broadcast_int(prime_x));
+	I y0 = L::multiply(L::to_int(floor_y), L::broadcast_int(prime_y));
+	I z0 = L::multiply(L::to_int(floor_z), L::broadcast_int(prime_z));
+	I x1 = x0 + L::broadcast_int(prime_x), y1 = y0 + L::broadcast_int(prime_y), z1 = z0 + L::broadcast_int(prime_z);
+	F dx0 = x - floor_x, dy0 = y - floor_y, dz0 = z - floor_z;
+	F one = L::broadcast(1.0f);
+	F dx1 = dx0 - one, dy1 = dy0 - one, dz1 = dz0 - one;
+	// Quintic fade, t^3 (t (6 t - 15) + 10)
+	auto fade = [](F t) { return t * t * t * (t * (t * L::broadcast(6.0f) - L::broadcast(15.0f)) + L::broadcast(10.0f)); };
+	auto lerp = [](F a, F b, F t) { return a + t * (b - a); };
+	F u = fade(dx0), v = fade(dy0), w = fade(dz0);
+	F x00 = lerp(gradient_dot<L>(seed, x0, y0, z0, dx0, dy0, dz0), gradient_dot<L>(seed, x1, y0, z0, dx1, dy0, dz0), u);
+	F x10 = lerp(gradient_dot<L>(seed, x0, y1, z0, dx0, dy1, dz0), gradient_dot<L>(seed, x1, y1, z0, dx1, dy1, dz0), u);
+	F x01 = lerp(gradient_dot<L>(seed, x0, y0, z1, dx0, dy0, dz1), gradient_dot<L>(seed, x1, y0, z1, dx1, dy0, dz1), u);
+	F x11 = lerp(gradient_dot<L>(seed, x0, y1, z1, dx0, dy1, dz1), gradient_dot<L>(seed, x1, y1, z1, dx1, dy1, dz1), u);
+	return lerp(lerp(x00, x10, v), lerp(x01, x11, v), w);
+}
+
+template <typename L>
+typename L::Float simplex_noise(typename L::Int seed, typename L::Float x, typename L::Float y, typename L::Float z) {
+	typedef typename L::Float F;
+	typedef typename L::Int I;
+	typedef typename L::Mask M;
+	// Skews the cube lattice into simplices and finds the simplex of the point from the order of its offsets
+	const float skew = 1.0f / 3.0f;
+	const float unskew = 1.0f / 6.0f;
+	F s = (x + y + z) * L::broadcast(skew);
+	F floor_x = L::floor(x + s), floor_y = L::floor(y + s), floor_z = L::floor(z + s);
+	F t = (floor_x + floor_y + floor_z) * L::broadcast(unskew);
+	F dx0 = x - (floor_x - t), dy0 = y - (floor_y - t), dz0 = z - (floor_z - t);
+	M x_ge_y = L::greater_equal(dx0, dy0);
+	M y_ge_z = L::greater_equal(dy0, dz0);
+	M x_ge_z = L::greater_equal(dx0, dz0);
+	M i1 = L::both(x_ge_y, x_ge_z);
+	M j1 = L::both(L::invert(x_ge_y), y_ge_z);
+	M k1 = L::both(L::invert(x_ge_z), L::invert(y_ge_z));
+	M i2 = L::either(x_ge_y, x_ge_z);
+	M j2 = L::either(L::invert(x_ge_y), y_ge_z);
+	M k2 = L::invert(L::both(x_ge_z, y_ge_z));
+	F zero = L::broadcast(0.0f), one = L::broadcast(1.0f);
+	F dx1 = dx0 - L::select(i1, one, zero) + L::broadcast(unskew);
+	F dy1 = dy0 - L::select(j1, one, zero) + L::broadcast(unskew);
+	F dz1 = dz0 - L::select(k1, one, zero) + L::broadcast(unskew);
+	F dx2 = dx0 - L::select(i2, one, zero) + L::broadcast(2.0f * unskew);
+	F dy2 = dy0 - L::select(j2, one, zero) + L::broadcast(2.0f * unskew);
+	F dz2 = dz0 - L::select(k2, one, zero) + L::broadcast(2.0f * unskew);
+	F dx3 = dx0 - one + L::broadcast(3.0f * unskew);
+	F dy3 = dy0 - one + L::broadcast(3.0f * unskew);
+	F dz3 = dz0 - one + L::broadcast(3.0f * unskew);
+	I px = L::broadcast_int(prime_x), py = L::broadcast_int(prime_y), pz = L::broadcast_int(prime_z), none = L::broadcast_int(0);
+	I x0 = L::multiply(L::to_int(floor_x), px);
+	I y0 = L::multiply(L::to_int(floor_y), py);
+	I z0 = L::multiply(L::to_int(floor_z), pz);
+	// Every corner adds (0.6 - d^2)^4 times its gradient dot, nothing past 0.6
+	auto corner = [&](I cx, I cy, I cz, F dx, F dy, F dz) {
+		F falloff = L::max(L::broadcast(0.6f) - dx * dx - dy * dy - dz * dz, zero);
+		falloff = falloff * falloff;
+		return falloff * falloff * gradient_dot<L>(seed, cx, cy, cz, dx, dy, dz);
+	};
+	F sum = corner(x0, y0, z0, dx0, dy0, dz0) +
+		corner(x0 + L::select_int(i1, px, none), y0 + L::select_int(j1, py, none), z0 + L::select_int(k1, pz, none), dx1, dy1, dz1) +
+		corner(x0 + L::select_int(i2, px, none), y0 + L::select_int(j2, py, none), z0 + L::select_int(k2, pz, none), dx2, dy2, dz2) +
+		corner(x0 + px, y0 + py, z0 + pz, dx3, dy3, dz3);
+	return sum * L::broadcast(32.0f);
+}
+
+template <typename L>
+typename L::Float basis_noise(const NoiseParameters& parameters, uint32_t seed, typename L::Float x, typename L::Float y, typename L::Float z) {
+	if (parameters.basis == noise_simplex) return simplex_noise<L>(L::broadcast_int(seed), x, y, z);
+	return gradient_noise<L>(L::broadcast_int(seed), x, y, z);
+}
+
+// Octaves at the same frequencies and amplitudes for every fractal, normalized by the sum of the amplitudes
+template <typename L>
+typename L::Float fractal_noise(const NoiseParameters& parameters, uint32_t seed, typename L::Float x, typename L::Float y, typename L::Float z) {
+	typedef typename L::Float F;
+	int octaves = parameters.fractal == noise_single ? 1 : std::max(parameters.octaves, 1);
+	F sum = L::broadcast(0.0f);
+	F weight = L::broadcast(1.0f);
+	float frequency = parameters.frequency;
+	float amplitude = 1.0f;
+	float amplitudes = 0.0f;
+	for (int octave = 0; octave < octaves; octave++) {
+		F f = L::broadcast(frequency);
+		F noise = basis_noise<L>(parameters, seed + uint32_t(octave), x * f, y * f, z * f);
+		if (parameters.fractal == noise_ridged) {
+			F signal = L::broadcast(parameters.ridge_offset) - L::abs(noise);
+			signal = signal * signal * weight;
+			weight = L::min(L::max(signal * L::broadcast(2.0f), L::broadcast(0.0f)), L::broadcast(1.0f));
+			noise = signal;
+		}
+		sum = sum + noise * L::broadcast(amplitude);
+		amplitudes += amplitude;
+		frequency *= parameters.lacunarity;
+		amplitude *= parameters.gain;
+	}
+	sum = sum * L::broadcast(1.0f / amplitudes);
+	// Ridges are in [0, offset^2], moved to about [-1, 1] like the other fractals
+	if (parameters.fractal == noise_ridged) sum = sum * L::broadcast(2.0f) - L::broadcast(1.0f);
+	return sum;
+}
+
+template <typename L>
+typename L::Float noise_lanes(const NoiseParameters& parameters, typename L::Float x, typename L::Float y, typename L::Float z) {
+	if (parameters.warp_amplitude != 0.0f) {
+		// Three fractals of other seeds at offset positions displace the sample
+		typename L::Float amplitude = L::broadcast(parameters.warp_amplitude);
+		typename L::Float warp_x = fractal_noise<L>(parameters, parameters.seed + 101u, x, y, z);
+		typename L::Float warp_y = fractal_noise<L>(parameters, parameters.seed + 202u, x + L::broadcast(5.2f), y + L::broadcast(1.3f), z + L::broadcast(2.8f));
+		typename L::Float warp_z = fractal_noise<L>(parameters, parameters.seed + 303u, x + L::broadcast(1.7f), y + L::broadcast(9.2f), z + L::broadcast(4.1f));
+		x = x + warp_x * amplitude;
+		y = y + warp_y * amplitude;
+		z = z + warp_z * amplitude;
+	}
+	return fractal_noise<L>(parameters, parameters.seed, x, y, z);
+}
+
+float evaluate_noise(const NoiseParameters& parameters, Vector3 position) {
+	return noise_lanes<ScalarLanes>(parameters, position.x, position.y, position.z);
+}
+
+void evaluate_noise_row(const NoiseParameters& parameters, Vector3 origin, Vector3 step, int count, float* values) {
+	int n = 0;
+	// Positions are origin + n * step in every path, so the lanes see the same coordinates as the scalar code
+#if defined(NOISE_AVX2)
+	for (; n + 8 <= count; n += 8) {
+		Float8 index = { _mm256_add_ps(_mm256_set1_ps(float(n)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)) };
+		Float8 x = Avx2Lanes::broadcast(origin.x) + Avx2Lanes::broadcast(step.x) * index;
+		Float8 y = Avx2Lanes::broadcast(origin.y) + Avx2Lanes::broadcast(step.y) * index;
+		Float8 z = Avx2Lanes::broadcast(origin.z) + Avx2Lanes::broadcast(step.z) * index;
+		_mm256_storeu_ps(values + n, noise_lanes<Avx2Lanes>(parameters, x, y, z).v);
+	}
+#endif
+#if defined(NOISE_SSE)
+	for (; n + 4 <= count; n += 4) {
+		Float4 index = { _mm_add_ps(_mm_set1_ps(float(n)), _mm_setr_ps(0, 1, 2, 3)) };
+		Float4 x = SseLanes::broadcast(origin.x) + SseLanes::broadcast(step.x) * index;
+		Float4 y = SseLanes::broadcast(origin.y) + SseLanes::broadcast(step.y) * index;
+		Float4 z = SseLanes::broadcast(origin.z) + SseLanes::broadcast(step.z) * index;
+		_mm_storeu_ps(values + n, noise_lanes<SseLanes>(parameters, x, y, z).v);
+	}
+#endif
+	for (; n < count; n++) {
+		float index = float(n);
+		values[n] = noise_lanes<ScalarLanes>(parameters, origin.x + step.x * index, origin.y + step.y * index, origin.z + step.z * index);
+	}
+}
+
+void fill_noise_grid(const NoiseParameters& parameters, NoiseFieldShape shape, int resolution, float cube_size, float* grid) {
+	float half_size = cube_size / 2.0f;
+	float spacing = resolution > 1 ? cube_size / (resolution - 1) : 0.0f;
+	size_t row_points = size_t(resolution);
+	if (shape == noise_field_terrain) {
+		// One height per column (j, k), then every point compares its height with the ground
+		std::vector<float> heights(row_points * resolution);
+		parallel_for(resolution, [&](int j) {
+			evaluate_noise_row(parameters, Vector3(-half_size, 0.0f, -half_size + j * spacing), Vector3(spacing, 0.0f, 0.0f), resolution, &heights[row_points * j]);
+		});
+		parallel_for(resolution, [&](int i) {
+			float height = (-half_size + i * spacing) / half_size;
+			for (int j = 0; j < resolution; j++) {
+				float* row = grid + (row_points * i + j) * row_points;
+				const float* row_heights = &heights[row_points * j];
+				for (int k = 0; k < resolution; k++) row[k] = 0.5f + 0.5f * (height - row_heights[k]);
+			}
+		});
+		return;
+	}
+	parallel_for(resolution, [&](int i) {
+		for (int j = 0; j < resolution; j++) {
+			float* row = grid + (row_points * i + j) * row_points;
+			evaluate_noise_row(parameters, Vector3(-half_size, -half_size + i * spacing, -half_size + j * spacing), Vector3(spacing, 0.0f, 0.0f), resolution, row);
+			for (int k = 0; k < resolution; k++) row[k] = 0.5f + 0.5f * row[k];
+		}
+	});
+}
+
+void fill_random_grid(uint64_t seed, int resolution, float* grid) {
+	size_t slab_points = size_t(resolution) * resolution;
+	parallel_for(resolution, [&](int i) {
+		for (size_t point = slab_points * i; point < slab_points * (i + 1); point++) grid[point] = counter_random_unit(seed, point);
+	});
+}
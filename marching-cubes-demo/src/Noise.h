@@ -0,0 +1,70 @@
+#pragma once
+
+// Coherent noise fields and white noise, gradient (Perlin) or simplex noise summed over octaves
+// Lattice gradients come from a hash of the lattice point and the seed, there are no permutation tables, so every
+// sample is computed on its own and any thread can fill any part of a grid with the same result
+// Rows of samples are evaluated 8 at a time with AVX2, which both projects target, or 4 at a time with SSE2,
+// with the same operations as the scalar code so all paths give the same values
+
+#include "MarchingCubes.h"
+
+#include <cstdint>
+
+enum NoiseBasis {
+	noise_gradient,
+	noise_simplex
+};
+
+enum NoiseFractal {
+	// The basis alone
+	noise_single,
+	// Octaves summed with decreasing amplitude
+	noise_fbm,
+	// Octaves of inverted absolute noise, each weighted by the octave before it, giving sharp ridges
+	noise_ridged
+};
+
+typedef struct NoiseParameters {
+	NoiseBasis basis = noise_simplex;
+	NoiseFractal fractal = noise_fbm;
+	uint32_t seed = 1337;
+	float frequency = 2.0f;
+	int octaves = 5;
+	// Frequency and amplitude factors from one octave to the next
+	float lacunarity = 2.0f;
+	float gain = 0.5f;
+	// Ridged noise is offset - |noise| before squaring
+	float ridge_offset = 1.0f;
+	// Samples are displaced by three more fractals of the same kind scaled by warp_amplitude, 0 turns warping off
+	float warp_amplitude = 0.0f;
+} NoiseParameters;
+
+// Noise at a position, roughly in [-1, 1]
+float evaluate_noise(const NoiseParameters& parameters, Vector3 position);
+// Noise at the count positions origin + n * step
+void evaluate_noise_row(const NoiseParameters& parameters, Vector3 origin, Vector3 step, int count, float* values);
+
+enum NoiseFieldShape {
+	// 0.5 + noise / 2 everywhere in the cube
+	noise_field_volume,
+	// Ground below a height field of noise across x and z, 0.5 on the ground surface
+	noise_field_terrain
+};
+
+// Fills a resolution^3 grid with the noise at the points of the cube, in parallel slabs
+void fill_noise_grid(const NoiseParameters& parameters, NoiseFieldShape shape, int resolution, float cube_size, float* grid);
+
+// Counter based white noise, the output of SplitMix64 for the seed at position index, so any sample can be
+// computed on its own without going through the ones before it
+inline uint64_t counter_random(uint64_t seed, uint64_t index) {
+	uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+// Uniform in [0, 1), the top 24 bits of the output
+inline float counter_random_unit(uint64_t seed, uint64_t index) {
+	return float(counter_random(seed, index) >> 40) * (1.0f / 16777216.0f);
+}
+// Fills a resolution^3 grid with white noise, point n of the grid taking sample n, in parallel slabs
+void fill_random_grid(uint64_t seed, int resolution, float* grid);
@@ -0,0 +1,84 @@
+#include "OutOfCore.h"
+
+#include "MeshWriter.h"
+
+#include <cstring>
+#include <fstream>
+
+static const char mesh_file_magic[4] = { 'M', 'C', 'M', 'S' };
+
+bool extract_marching_cubes_out_of_core(MappedVolume& volume, const MarchingCubesParameters& parameters, const char* mesh_path, OutOfCoreStats& stats) {
+	stats = OutOfCoreStats();
+	BufferedFile file;
+	if (!open_buffered_file(file, mesh_path)) {
+		stats.error = std::string("Cannot create ") + mesh_path;
+		return false;
+	}
+	MeshFileHeader header = {};
+	memcpy(header.magic, mesh_file_magic, sizeof(header.magic));
+	header.version = mesh_file_version;
+	header.indexed = parameters.indexed;
+	write_buffered_file(file, &header, sizeof(header));
+
+	MeshStream stream;
+	stream.write_vertices = [&](const Vector3* positions, const Vector3* normals, size_t count) {
+		MeshFileBlock block = { mesh_block_vertices, uint32_t(count) };
+		write_buffered_file(file, &block, sizeof(block));
+		for (size_t v = 0; v < count; v++) {
+			MeshVertex vertex = { positions[v], normals[v] };
+			write_buffered_file(file, &vertex, sizeof(vertex));
+		}
+		header.vertex_count += count;
+	};
+	stream.write_indices = [&](const uint32_t* indices, size_t count) {
+		MeshFileBlock block = { mesh_block_indices, uint32_t(count) };
+		write_buffered_file(file, &block, sizeof(block));
+		write_buffered_file(file, indices, count * sizeof(uint32_t));
+		header.index_count += count;
+	};
+	stream_marching_cubes_volume(volume, parameters, stream, stats.extraction);
+
+	// The counts are only known now, the header is written again over the first one
+	patch_buffered_file(file, 0, &header, sizeof(header));
+	stats.vertices = header.vertex_count;
+	stats.bytes_written = file.bytes_written;
+	stats.peak_memory = stats.extraction.peak_buffers + stats.extraction.peak_mapped + file.buffer.size();
+	bool written = close_buffered_file(file);
+	if (!volume.error.empty()) stats.error = volume.error;
+	else if (!written) stats.error = std::string("Cannot write ") + mesh_path;
+	return stats.error.empty();
+}
+
+bool read_mesh_file(const char* path, MarchingCubesMesh& mesh, std::string& error) {
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		error = std::string("Cannot open ") + path;
+		return false;
+	}
+	MeshFileHeader header;
+	bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) && memcmp(header.magic, mesh_file_magic, sizeof(header.magic)) == 0 &&
+		header.version == mesh_file_version;
+	if (valid) {
+		mesh.vertices.reserve(size_t(header.vertex_count));
+		mesh.indices.reserve(size_t(header.index_count));
+	}
+	MeshFileBlock block;
+	while (valid && file.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+		if (block.type == mesh_block_vertices) {
+			size_t first = mesh.vertices.size();
+			mesh.vertices.resize(first + block.count);
+			valid = bool(file.read(reinterpret_cast<char*>(mesh.vertices.data() + first), std::streamsize(block.count) * sizeof(MeshVertex)));
+		}
+		else if (block.type == mesh_block_indices) {
+			size_t first = mesh.indices.size();
+			mesh.indices.resize(first + block.count);
+			valid = bool(file.read(reinterpret_cast<char*>(mesh.indices.data() + first), std::streamsize(block.count) * sizeof(uint32_t)));
+		}
+		else valid = false;
+	}
+	valid = valid && mesh.vertices.size() == header.vertex_count && mesh.indices.size() == header.index_count;
+	if (!valid) error = std::string("Not a complete mesh file: ") + path;
+	return valid;
+}
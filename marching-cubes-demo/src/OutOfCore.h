@@ -0,0 +1,49 @@
+#pragma once
+
+// Out of core extraction, a volume streamed from its file and its mesh streamed to a mesh file as the layers are
+// finished, so neither the samples nor the mesh are ever whole in memory
+// Mesh files hold a MeshFileHeader, then the blocks in the order the extraction finished them, each a MeshFileBlock
+// followed by count MeshVertex or count indices. The header counts are filled in once the extraction is done
+
+#include "VolumeFile.h"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+const uint32_t mesh_file_version = 1;
+
+typedef struct MeshFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t indexed;
+	uint32_t reserved;
+	uint64_t vertex_count;
+	uint64_t index_count;
+} MeshFileHeader;
+
+enum MeshFileBlockType {
+	mesh_block_vertices,
+	mesh_block_indices
+};
+
+typedef struct MeshFileBlock {
+	uint32_t type;
+	uint32_t count;
+} MeshFileBlock;
+
+typedef struct OutOfCoreStats {
+	VolumeExtractionStats extraction;
+	uint64_t vertices = 0;
+	uint64_t bytes_written = 0;
+	// Extraction buffers, mapped window and write buffer at their largest, everything the extraction holds
+	size_t peak_memory = 0;
+	std::string error;
+} OutOfCoreStats;
+
+// Extracts the volume into the mesh file at mesh_path, returning false with the reason in error when the volume
+// or the file cannot be read or written
+bool extract_marching_cubes_out_of_core(MappedVolume& volume, const MarchingCubesParameters& parameters, const char* mesh_path, OutOfCoreStats& stats);
+
+// Reads a whole mesh file back, for meshes that fit in memory
+bool read_mesh_file(const char* path, MarchingCubesMesh& mesh, std::string& error);
@@ -0,0 +1,34 @@
+cbuffer cbPerspective {
+	matrix projection;
+};
+
+cbuffer camera_position {
+	float4 cam_pos;
+};
+
+// Per draw constants of packed meshes, the color and the cube_size the positions are quantized against
+cbuffer mesh_constants {
+	float4 mesh_color;
+	float4 cube_size;
+};
+
+// Same decoding as decode_octahedral_normal in VertexPacking.h
+float3 decode_octahedral_normal(float2 packed) {
+	float3 normal = float3(packed, 1.0f - abs(packed.x) - abs(packed.y));
+	if (normal.z < 0) {
+		normal.xy = (1.0f - abs(packed.yx)) * (packed >= 0 ? 1.0f : -1.0f);
+	}
+	return normalize(normal);
+}
+
+void main(float4 packed_pos : POSITION, float2 packed_normal : NORMAL,
+			out float4 out_pos : SV_POSITION, out float4 out_col : COLOR) {
+
+	float3 pos = packed_pos.xyz * cube_size.x - cube_size.x / 2.0f;
+	float3 normal = decode_octahedral_normal(packed_normal);
+
+	out_pos = mul(float4(pos, 1.0f), projection);
+
+	out_col.rgb = abs(dot(normalize(cam_pos.xyz - pos), normal)) * mesh_color.rgb;
+	out_col.a = 1.0f;
+}
\ No newline at end of file
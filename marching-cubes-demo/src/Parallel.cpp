@@ -0,0 +1,100 @@
+#include "Parallel.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Persistent worker pool, workers sleep until a new parallel_for job is published
+static std::vector<std::thread> workers;
+static std::mutex pool_mutex;
+static std::condition_variable job_available;
+static std::condition_variable job_finished;
+static bool stop_workers = false;
+static unsigned long long job_generation = 0;
+static int busy_workers = 0;
+static const std::function<void(int)>* job_task = nullptr;
+static int job_count = 0;
+static std::atomic<int> job_next(0);
+static int thread_count = 1;
+static thread_local bool inside_task = false;
+
+static void run_tasks() {
+	bool was_inside_task = inside_task;
+	inside_task = true;
+	for (int index = job_next++; index < job_count; index = job_next++) {
+		(*job_task)(index);
+	}
+	inside_task = was_inside_task;
+}
+
+static void worker_loop() {
+	unsigned long long seen_generation = 0;
+	std::unique_lock<std::mutex> lock(pool_mutex);
+	while (true) {
+		job_available.wait(lock, [&] { return stop_workers || job_generation != seen_generation; });
+		if (stop_workers) return;
+		seen_generation = job_generation;
+		lock.unlock();
+		run_tasks();
+		lock.lock();
+		if (--busy_workers == 0) job_finished.notify_one();
+	}
+}
+
+static void stop_pool() {
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		stop_workers = true;
+	}
+	job_available.notify_all();
+	for (std::thread& worker : workers) worker.join();
+	workers.clear();
+	stop_workers = false;
+}
+
+// Joins the workers before static destruction so the process can exit cleanly
+static struct PoolShutdown {
+	~PoolShutdown() { stop_pool(); }
+} pool_shutdown;
+
+void set_thread_count(int count) {
+	if (count < 1) count = 1;
+	if (count == thread_count) return;
+	stop_pool();
+	thread_count = count;
+	for (int t = 1; t < thread_count; t++) {
+		workers.emplace_back(worker_loop);
+	}
+}
+
+int get_thread_count() {
+	return thread_count;
+}
+
+int get_hardware_thread_count() {
+	unsigned int count = std::thread::hardware_concurrency();
+	return count > 0 ? int(count) : 1;
+}
+
+void parallel_for(int count, const std::function<void(int)>& task) {
+	if (count <= 0) return;
+	if (inside_task || workers.empty() || count == 1) {
+		for (int index = 0; index < count; index++) task(index);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		job_task = &task;
+		job_count = count;
+		job_next = 0;
+		busy_workers = int(workers.size());
+		job_generation++;
+	}
+	job_available.notify_all();
+	run_tasks();
+	std::unique_lock<std::mutex> lock(pool_mutex);
+	job_finished.wait(lock, [] { return busy_workers == 0; });
+	job_task = nullptr;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <functional>
+
+// Number of threads used by parallel_for, the calling thread counts as one of them
+void set_thread_count(int count);
+int get_thread_count();
+int get_hardware_thread_count();
+
+// Runs task(0) ... task(count - 1) spread over the worker threads and returns once all of them finished
+// Tasks are handed out dynamically, so results must only depend on the task index and never on the thread running it
+// Calls made from inside a task run serially on the calling thread
+void parallel_for(int count, const std::function<void(int)>& task);
@@ -0,0 +1,193 @@
+#include "SparseField.h"
+
+#include "BrickExtraction.h"
+#include "Parallel.h"
+
+#include <algorithm>
+
+void SparseFieldAccessor::load(SparseCoordinates brick) {
+	cached_brick = brick;
+	cached_values = nullptr;
+	SparseCoordinates node_coordinates = sparse_node_of_brick(brick);
+	auto node = field->nodes.find(node_coordinates);
+	if (node != field->nodes.end()) {
+		int child = sparse_child_index(brick.i, brick.j, brick.k);
+		int32_t brick_index = node->second.children[child];
+		if (brick_index >= 0) cached_values = &field->bricks[size_t(brick_index) * sparse_brick_points];
+		else cached_tile = node->second.tiles[child];
+		return;
+	}
+	auto tile = field->root_tiles.find(node_coordinates);
+	cached_tile = tile != field->root_tiles.end() ? tile->second : field->background;
+}
+
+void build_sparse_field(const float* grid, int resolution, float threshold, float band, SparseField& field) {
+	field.background = threshold + band;
+	field.min_threshold = threshold - band;
+	field.max_threshold = threshold + band;
+	field.nodes.clear();
+	field.root_tiles.clear();
+	field.bricks.clear();
+	field.brick_coordinates.clear();
+	if (resolution < 1) return;
+
+	// Decide which bricks are stored from the range of their points and the ones right around them
+	int bricks = (resolution + sparse_brick_size - 1) / sparse_brick_size;
+	std::vector<int32_t> brick_slots(size_t(bricks) * bricks * bricks);
+	std::vector<float> tile_values(brick_slots.size());
+	parallel_for(bricks, [&](int bi) {
+		auto range_first = [&](int b) { return b * sparse_brick_size - 1 < 0 ? 0 : b * sparse_brick_size - 1; };
+		auto range_last = [&](int b) { return (b + 1) * sparse_brick_size < resolution - 1 ? (b + 1) * sparse_brick_size : resolution - 1; };
+		for (int bj = 0; bj < bricks; bj++) {
+			for (int bk = 0; bk < bricks; bk++) {
+				float min_value = grid[(size_t(resolution) * range_first(bi) + range_first(bj)) * resolution + range_first(bk)];
+				float max_value = min_value;
+				for (int i = range_first(bi); i <= range_last(bi); i++) {
+					for (int j = range_first(bj); j <= range_last(bj); j++) {
+						const float* row = grid + (size_t(resolution) * i + j) * resolution;
+						for (int k = range_first(bk); k <= range_last(bk); k++) {
+							min_value = row[k] < min_value ? row[k] : min_value;
+							max_value = row[k] > max_value ? row[k] : max_value;
+						}
+					}
+				}
+				size_t brick = (size_t(bricks) * bi + bj) * bricks + bk;
+				bool below = max_value < threshold - band;
+				bool above = min_value > threshold + band;
+				brick_slots[brick] = below || above ? -1 : 0;
+				// The tile keeps the value closest to the band, on the side of the whole brick
+				tile_values[brick] = below ? max_value : min_value;
+			}
+		}
+	});
+
+	// Number the stored bricks in grid order and copy their points, points past the grid repeat its last points
+	int32_t brick_count = 0;
+	for (int32_t& slot : brick_slots) {
+		if (slot >= 0) slot = brick_count++;
+	}
+	field.bricks.resize(size_t(brick_count) * sparse_brick_points);
+	field.brick_coordinates.resize(brick_count);
+	parallel_for(bricks, [&](int bi) {
+		for (int bj = 0; bj < bricks; bj++) {
+			for (int bk = 0; bk < bricks; bk++) {
+				int32_t slot = brick_slots[(size_t(bricks) * bi + bj) * bricks + bk];
+				if (slot < 0) continue;
+				field.brick_coordinates[slot] = { bi, bj, bk };
+				float* values = &field.bricks[size_t(slot) * sparse_brick_points];
+				for (int a = 0; a < sparse_brick_size; a++) {
+					int i = std::min(bi * sparse_brick_size + a, resolution - 1);
+					for (int b = 0; b < sparse_brick_size; b++) {
+						int j = std::min(bj * sparse_brick_size + b, resolution - 1);
+						for (int c = 0; c < sparse_brick_size; c++) {
+							int k = std::min(bk * sparse_brick_size + c, resolution - 1);
+							values[sparse_point_index(a, b, c)] = grid[(size_t(resolution) * i + j) * resolution + k];
+						}
+					}
+				}
+			}
+		}
+	});
+
+	// Link the bricks and tiles into nodes, nodes made of tiles on the same side collapse into a root tile
+	int nodes = (bricks + sparse_node_size - 1) / sparse_node_size;
+	for (int ni = 0; ni < nodes; ni++) {
+		for (int nj = 0; nj < nodes; nj++) {
+			for (int nk = 0; nk < nodes; nk++) {
+				SparseNode node;
+				bool any_brick = false;
+				bool any_below = false;
+				bool any_above = false;
+				float tile_value = field.background;
+				for (int child = 0; child < sparse_node_children; child++) {
+					int bi = ni * sparse_node_size + (child >> (2 * sparse_node_log2));
+					int bj = nj * sparse_node_size + ((child >> sparse_node_log2) & (sparse_node_size - 1));
+					int bk = nk * sparse_node_size + (child & (sparse_node_size - 1));
+					node.children[child] = -1;
+					node.tiles[child] = field.background;
+					if (bi >= bricks || bj >= bricks || bk >= bricks) continue;
+					size_t brick = (size_t(bricks) * bi + bj) * bricks + bk;
+					node.children[child] = brick_slots[brick];
+					node.tiles[child] = tile_values[brick];
+					any_brick |= brick_slots[brick] >= 0;
+					if (brick_slots[brick] < 0) {
+						if (tile_values[brick] < threshold) any_below = true;
+						else any_above = true;
+						tile_value = tile_values[brick];
+					}
+				}
+				SparseCoordinates coordinates = { ni, nj, nk };
+				if (any_brick || (any_below && any_above)) field.nodes[coordinates] = node;
+				else if (any_below) field.root_tiles[coordinates] = tile_value;
+			}
+		}
+	}
+}
+
+void for_each_sparse_brick(const SparseField& field, const std::function<void(SparseCoordinates, const float*)>& visit) {
+	for (size_t brick = 0; brick < field.brick_coordinates.size(); brick++) {
+		visit(field.brick_coordinates[brick], &field.bricks[brick * sparse_brick_points]);
+	}
+}
+
+size_t sparse_field_memory(const SparseField& field) {
+	// Hash entries are counted with a pointer and a bucket of overhead each
+	size_t entry_overhead = 2 * sizeof(void*);
+	return field.bricks.capacity() * sizeof(float) + field.brick_coordinates.capacity() * sizeof(SparseCoordinates) +
+		field.nodes.size() * (sizeof(SparseCoordinates) + sizeof(SparseNode) + entry_overhead) +
+		field.root_tiles.size() * (sizeof(SparseCoordinates) + sizeof(float) + entry_overhead);
+}
+
+// Stored bricks inside the grid, in pool order, the points of tiles are read through an accessor
+typedef struct SparseBrickSource {
+	const SparseField* field;
+	std::vector<size_t> pool_bricks;
+	std::unordered_map<SparseCoordinates, int, SparseCoordinatesHash> lookup;
+	size_t brick_count() const { return pool_bricks.size(); }
+	SparseCoordinates brick_coordinates(size_t brick) const { return field->brick_coordinates[pool_bricks[brick]]; }
+	int find_brick(SparseCoordinates coordinates) const {
+		auto found = lookup.find(coordinates);
+		return found != lookup.end() ? found->second : -1;
+	}
+	void load_brick_points(size_t brick, float* points) const {
+		const int side = sparse_brick_size + 1;
+		SparseCoordinates coordinates = brick_coordinates(brick);
+		const float* values = &field->bricks[pool_bricks[brick] * sparse_brick_points];
+		for (int a = 0; a < sparse_brick_size; a++) {
+			for (int b = 0; b < sparse_brick_size; b++) {
+				std::copy_n(values + sparse_point_index(a, b, 0), sparse_brick_size, points + (a * side + b) * side);
+			}
+		}
+		// Points of the bricks at +, from the stored ones or their tiles
+		SparseFieldAccessor accessor(*field);
+		int origin_i = coordinates.i * sparse_brick_size;
+		int origin_j = coordinates.j * sparse_brick_size;
+		int origin_k = coordinates.k * sparse_brick_size;
+		for (int a = 0; a < side; a++) {
+			for (int b = 0; b < side; b++) {
+				for (int c = a < sparse_brick_size && b < sparse_brick_size ? sparse_brick_size : 0; c < side; c++) {
+					points[(a * side + b) * side + c] = accessor.value(origin_i + a, origin_j + b, origin_k + c);
+				}
+			}
+		}
+	}
+} SparseBrickSource;
+
+void extract_marching_cubes_sparse(const SparseField& field, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh) {
+	int resolution = parameters.resolution;
+	if (resolution < 2 || parameters.threshold < field.min_threshold || parameters.threshold > field.max_threshold) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	int bricks = (resolution + sparse_brick_size - 1) / sparse_brick_size;
+	SparseBrickSource source;
+	source.field = &field;
+	for (size_t brick = 0; brick < field.brick_coordinates.size(); brick++) {
+		SparseCoordinates coordinates = field.brick_coordinates[brick];
+		if (coordinates.i < 0 || coordinates.j < 0 || coordinates.k < 0 || coordinates.i >= bricks || coordinates.j >= bricks || coordinates.k >= bricks) continue;
+		source.lookup[coordinates] = int(source.pool_bricks.size());
+		source.pool_bricks.push_back(brick);
+	}
+	extract_marching_cubes_bricks(source, parameters, mesh);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+// Sparse scalar field storage, a hash of internal nodes over leaf bricks in the spirit of VDB
+//  - Leaf bricks hold 8^3 points
+//  - Internal nodes cover 16^3 bricks, 128^3 points, each child is a brick or a constant tile
+//  - The root hash maps node coordinates to nodes, points of missing nodes read the background value
+// Points are addressed like the dense grid, (i, j, k) with k the fastest axis
+// Only the bricks near the surface are stored, so memory grows with the surface area instead of the volume
+
+#include "MarchingCubes.h"
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+const int sparse_brick_log2 = 3;
+const int sparse_brick_size = 1 << sparse_brick_log2;
+const int sparse_brick_points = sparse_brick_size * sparse_brick_size * sparse_brick_size;
+const int sparse_node_log2 = 4;
+const int sparse_node_size = 1 << sparse_node_log2;
+const int sparse_node_children = sparse_node_size * sparse_node_size * sparse_node_size;
+
+typedef struct SparseCoordinates {
+	int i, j, k;
+	bool operator==(const SparseCoordinates& other) const { return i == other.i && j == other.j && k == other.k; }
+} SparseCoordinates;
+typedef struct SparseCoordinatesHash {
+	size_t operator()(const SparseCoordinates& coordinates) const {
+		return (size_t(uint32_t(coordinates.i)) * 73856093u) ^ (size_t(uint32_t(coordinates.j)) * 19349663u) ^ (size_t(uint32_t(coordinates.k)) * 83492791u);
+	}
+} SparseCoordinatesHash;
+
+typedef struct SparseNode {
+	// Brick index into the brick pool of every child, or -1 for a tile
+	int32_t children[sparse_node_children];
+	float tiles[sparse_node_children];
+} SparseNode;
+
+typedef struct SparseField {
+	float background = 0;
+	// Thresholds the stored bricks hold every crossing for
+	float min_threshold = 0;
+	float max_threshold = 0;
+	std::unordered_map<SparseCoordinates, SparseNode, SparseCoordinatesHash> nodes;
+	// Nodes made only of tiles on the same side, stored as a single value
+	std::unordered_map<SparseCoordinates, float, SparseCoordinatesHash> root_tiles;
+	// sparse_brick_points values per brick
+	std::vector<float> bricks;
+	// Brick coordinates of every brick of the pool
+	std::vector<SparseCoordinates> brick_coordinates;
+} SparseField;
+
+inline int sparse_point_index(int i, int j, int k) {
+	int mask = sparse_brick_size - 1;
+	return (((i & mask) << sparse_brick_log2) + (j & mask)) * sparse_brick_size + (k & mask);
+}
+inline int sparse_child_index(int bi, int bj, int bk) {
+	int mask = sparse_node_size - 1;
+	return (((bi & mask) << sparse_node_log2) + (bj & mask)) * sparse_node_size + (bk & mask);
+}
+// Arithmetic shifts so negative coordinates land in the right brick and node
+inline SparseCoordinates sparse_brick_of(int i, int j, int k) {
+	return { i >> sparse_brick_log2, j >> sparse_brick_log2, k >> sparse_brick_log2 };
+}
+inline SparseCoordinates sparse_node_of_brick(SparseCoordinates brick) {
+	return { brick.i >> sparse_node_log2, brick.j >> sparse_node_log2, brick.k >> sparse_node_log2 };
+}
+
+// Random access with the last node and brick cached, neighbouring reads skip the hash lookup
+// An accessor must not outlive changes to the field
+typedef struct SparseFieldAccessor {
+	const SparseField* field;
+	SparseCoordinates cached_brick;
+	const float* cached_values;
+	float cached_tile;
+	SparseFieldAccessor(const SparseField& sparse_field) : field(&sparse_field), cached_brick{ INT32_MIN, 0, 0 }, cached_values(nullptr), cached_tile(0) {}
+	float value(int i, int j, int k) {
+		SparseCoordinates brick = sparse_brick_of(i, j, k);
+		if (!(brick == cached_brick)) load(brick);
+		return cached_values ? cached_values[sparse_point_index(i, j, k)] : cached_tile;
+	}
+	void load(SparseCoordinates brick);
+} SparseFieldAccessor;
+
+// Stores a dense resolution^3 grid sparsely for thresholds within band of threshold
+// Bricks whose points, and the points right around them, all stay out of [threshold - band, threshold + band]
+// become tiles, so every edge crossed at those thresholds still has both ends in stored bricks
+void build_sparse_field(const float* grid, int resolution, float threshold, float band, SparseField& field);
+
+// Calls visit for every brick with its brick coordinates and its values, in pool order
+void for_each_sparse_brick(const SparseField& field, const std::function<void(SparseCoordinates, const float*)>& visit);
+
+size_t sparse_field_memory(const SparseField& field);
+
+// Marching cubes over the points [0, resolution)^3 of a sparse field, walking its bricks directly
+// Gives the same triangles as the dense extraction of the grid the field was built from, numbered brick by brick
+// Thresholds out of the band of the field give an empty mesh, their crossings may lie in tiles
+void extract_marching_cubes_sparse(const SparseField& field, const MarchingCubesParameters& parameters, MarchingCubesMesh& mesh);
@@ -0,0 +1,38 @@
+#pragma once
+
+// Common entry point of the dense grid extraction engines, picking the engine of the parameters and its kernel
+// specialized for their settings. Every engine writes its vertices through the same vertex formats
+
+#include "MarchingCubesKernel.h"
+#include "SurfaceNets.h"
+#include "DualContouring.h"
+#include "FlyingEdges.h"
+
+template <typename VertexFormat>
+void extract_surface_kernel(const float* grid, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh, const MinMaxPyramid* pyramid = nullptr) {
+	switch (parameters.engine) {
+	case engine_surface_nets:
+		if (parameters.interpolation) generate_surface_nets_kernel<float, LinearInterpolation>(grid, parameters, format, mesh);
+		else generate_surface_nets_kernel<float, MidpointPlacement>(grid, parameters, format, mesh);
+		break;
+	case engine_dual_contouring:
+		if (parameters.interpolation) generate_dual_contouring_kernel<float, LinearInterpolation>(grid, parameters, format, mesh);
+		else generate_dual_contouring_kernel<float, MidpointPlacement>(grid, parameters, format, mesh);
+		break;
+	case engine_flying_edges:
+		if (parameters.interpolation) generate_flying_edges_kernel<float, LinearInterpolation>(grid, parameters, format, mesh);
+		else generate_flying_edges_kernel<float, MidpointPlacement>(grid, parameters, format, mesh);
+		break;
+	default:
+		if (parameters.interpolation) {
+			if (parameters.indexed) generate_marching_cubes_kernel<float, LinearInterpolation, SmoothNormals>(grid, parameters, format, mesh, pyramid);
+			else generate_marching_cubes_kernel<float, LinearInterpolation, FaceNormals>(grid, parameters, format, mesh, pyramid);
+		}
+		else {
+			if (parameters.indexed) generate_marching_cubes_kernel<float, MidpointPlacement, SmoothNormals>(grid, parameters, format, mesh, pyramid);
+			else generate_marching_cubes_kernel<float, MidpointPlacement, FaceNormals>(grid, parameters, format, mesh, pyramid);
+		}
+		break;
+	}
+}
@@ -0,0 +1,86 @@
+#include "SurfaceNets.h"
+
+void write_dual_quads(MarchingCubesWorkspace& workspace, int resolution, std::vector<uint32_t>& indices) {
+	int cells = resolution - 1;
+	int words = classification_words(resolution);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	const uint64_t* cell_bits = workspace.cell_bits.data();
+	const Vector3* positions = workspace.positions.data();
+	int slab_count = int(workspace.slabs.size());
+
+	// The vertex ids of the two layers of cells around a point layer are spread out into slices first
+	// Cells around an edge are listed counterclockwise about its axis, and reversed when the edge starts above
+	// the threshold so the quad faces the points above it
+	parallel_for(slab_count, [&](int s) {
+		const MarchingCubesSlab& slab = workspace.slabs[s];
+		uint32_t* triangle_indices = indices.data() + slab.index_offset;
+		std::vector<uint32_t>* id_slices = marching_cubes_edge_slices();
+		id_slices[0].resize(size_t(cells) * cells);
+		id_slices[1].resize(size_t(cells) * cells);
+		auto fill_slice = [&](int i, uint32_t* slice) {
+			for (int j = 0; j < cells; j++) {
+				size_t row = size_t(cells) * i + j;
+				uint32_t id = workspace.row_vertex_offsets[row];
+				for (int w = 0; w < words; w++) {
+					for (uint64_t active = cell_bits[row * words + w]; active; active &= active - 1) {
+						slice[size_t(cells) * j + w * 64 + lowest_bit(active)] = id++;
+					}
+				}
+			}
+		};
+		auto add_quad = [&](uint32_t v0, uint32_t v1, uint32_t v2, uint32_t v3, bool below) {
+			if (!below) std::swap(v1, v3);
+			Vector3 d02 = positions[v2] - positions[v0];
+			Vector3 d13 = positions[v3] - positions[v1];
+			if (dot(d02, d02) <= dot(d13, d13)) {
+				uint32_t quad[6] = { v0, v1, v2, v0, v2, v3 };
+				triangle_indices = std::copy(quad, quad + 6, triangle_indices);
+			}
+			else {
+				uint32_t quad[6] = { v1, v2, v3, v1, v3, v0 };
+				triangle_indices = std::copy(quad, quad + 6, triangle_indices);
+			}
+		};
+		int last_point_layer = s == slab_count - 1 ? resolution : slab.last_layer;
+		int current = 0;
+		if (slab.first_layer > 0) fill_slice(slab.first_layer - 1, id_slices[1].data());
+		for (int i = slab.first_layer; i < last_point_layer; i++) {
+			// Cell layers i - 1 and i, the top point layer only has the one below it
+			if (i < cells) fill_slice(i, id_slices[current].data());
+			const uint32_t* lower = id_slices[1 - current].data();
+			const uint32_t* upper = id_slices[current].data();
+			current = 1 - current;
+			bool inner_i = i > 0 && i < cells;
+			for (int j = 0; j < resolution; j++) {
+				const uint64_t* row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* next_row = j + 1 < resolution ? row + words : nullptr;
+				const uint64_t* upper_row = i + 1 < resolution ? row + size_t(resolution) * words : nullptr;
+				bool inner_j = j > 0 && j < cells;
+				// Rows j - 1 and j of both layers of cells, when they exist
+				const uint32_t* lower0 = j > 0 ? lower + size_t(cells) * (j - 1) : nullptr;
+				const uint32_t* upper0 = j > 0 ? upper + size_t(cells) * (j - 1) : nullptr;
+				const uint32_t* lower1 = j < cells ? lower + size_t(cells) * j : nullptr;
+				const uint32_t* upper1 = j < cells ? upper + size_t(cells) * j : nullptr;
+				for (int w = 0; w < words; w++) {
+					uint64_t x_crossings, z_crossings, y_crossings;
+					row_crossings(row, next_row, upper_row, w, words, resolution, x_crossings, z_crossings, y_crossings);
+					uint64_t inner_k = row_bits_from(w, 1) & ~row_bits_from(w, cells);
+					if (!inner_i || !inner_j) x_crossings = 0;
+					if (!inner_i) z_crossings = 0;
+					if (!inner_j) y_crossings = 0;
+					z_crossings &= inner_k;
+					y_crossings &= inner_k;
+					for (uint64_t crossings = x_crossings | z_crossings | y_crossings; crossings; crossings &= crossings - 1) {
+						int bit = lowest_bit(crossings);
+						int k = w * 64 + bit;
+						bool below = (row[w] >> bit) & 1;
+						// Along x the cells turn from y to z, along z from x to y and along y from z to x
+						if ((x_crossings >> bit) & 1) add_quad(lower0[k], upper0[k], upper1[k], lower1[k], below);
+						if ((z_crossings >> bit) & 1) add_quad(lower1[k - 1], lower1[k], upper1[k], upper1[k - 1], below);
+						if ((y_crossings >> bit) & 1) add_quad(upper0[k - 1], upper1[k - 1], upper1[k], upper0[k], below);
+					}
+				}
+			}
+		}
+	});
+}
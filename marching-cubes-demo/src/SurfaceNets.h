@@ -0,0 +1,202 @@
+#pragma once
+
+// Naive Surface Nets over the same grid layout as marching cubes
+// Every cell the surface goes through gets one vertex, the mean of the crossings of its edges, and every crossed
+// edge away from the faces of the grid gets a quad joining the vertices of the four cells around it, split into
+// two triangles along its shorter diagonal. Triangles are wound like triTable, their normals pointing from the
+// points below the threshold towards the ones above it
+// Vertices are numbered in grid order by the row of cells they belong to, so the output does not depend on the
+// slab split, and the mesh is written by the same code as the marching cubes kernel
+// The cells and the quads are shared with the other dual engines, which only place their vertices differently
+
+#include "MarchingCubesKernel.h"
+
+#include <algorithm>
+
+// Bits of point k and above of a row word w, the ones past the last point left clear
+inline uint64_t row_bits_from(int w, int k) {
+	if (k <= w * 64) return ~uint64_t(0);
+	if (k >= w * 64 + 64) return 0;
+	return ~uint64_t(0) << (k - w * 64);
+}
+
+// Corners of a cell are numbered di << 2 | dj << 1 | dk, the corner at the other end of an edge along axis 0 (k),
+// 1 (j) or 2 (i) is this far from the corner it starts from
+inline const int* surface_nets_corners() {
+	static const int offsets[3] = { 1, 2, 4 };
+	return offsets;
+}
+
+// Splits the cell layers into slabs, classifies the grid points and marks the active cells, then numbers the
+// vertices of the cells by row and gives every slab its range of the index buffer. Returns the triangle count
+// Every slab owns the quads of the crossed edges starting at its point layers, the last slab also the top one
+// Edges on the faces of the grid miss some of their four cells and get no quad
+template <typename Scalar>
+size_t find_dual_cells(const Scalar* grid, const MarchingCubesParameters& parameters, MarchingCubesWorkspace& workspace) {
+	int resolution = parameters.resolution;
+	float threshold = parameters.threshold;
+	std::vector<MarchingCubesSlab>& slabs = workspace.slabs;
+	int cells = resolution - 1;
+	int slab_count = std::min(cells, get_thread_count() * 4);
+	slabs.resize(slab_count);
+	for (int s = 0; s < slab_count; s++) {
+		slabs[s].first_layer = cells * s / slab_count;
+		slabs[s].last_layer = cells * (s + 1) / slab_count;
+	}
+
+	// Classify every grid point against the threshold, a whole row at a time
+	int words = classification_words(resolution);
+	workspace.point_bits.resize(size_t(resolution) * resolution * words);
+	const uint64_t* point_bits = workspace.point_bits.data();
+	parallel_for(slab_count, [&](int s) {
+		int last_point_layer = s == slab_count - 1 ? resolution : slabs[s].last_layer;
+		for (int i = slabs[s].first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				size_t row = size_t(resolution) * i + j;
+				classify_points(grid + row * resolution, resolution, threshold, &workspace.point_bits[row * words]);
+			}
+		}
+	});
+
+	// Every slab marks and counts the active cells of its cell layers, then counts its quads
+	workspace.cell_bits.resize(size_t(cells) * cells * words);
+	workspace.row_vertex_counts.resize(size_t(cells) * cells);
+	workspace.row_vertex_offsets.resize(size_t(cells) * cells);
+	uint64_t* cell_bits = workspace.cell_bits.data();
+	parallel_for(slab_count, [&](int s) {
+		MarchingCubesSlab& slab = slabs[s];
+		for (int i = slab.first_layer; i < slab.last_layer; i++) {
+			for (int j = 0; j < cells; j++) {
+				size_t row = size_t(cells) * i + j;
+				const uint64_t* point_row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* upper_row = point_row + size_t(resolution) * words;
+				classify_active_cells(point_row, point_row + words, upper_row, upper_row + words, cells, cell_bits + row * words);
+				uint32_t count = 0;
+				for (int w = 0; w < words; w++) count += bit_count(cell_bits[row * words + w]);
+				workspace.row_vertex_counts[row] = count;
+			}
+		}
+		int last_point_layer = s == slab_count - 1 ? resolution : slab.last_layer;
+		size_t quad_count = 0;
+		for (int i = slab.first_layer; i < last_point_layer; i++) {
+			for (int j = 0; j < resolution; j++) {
+				const uint64_t* row = point_bits + (size_t(resolution) * i + j) * words;
+				const uint64_t* next_row = j + 1 < resolution ? row + words : nullptr;
+				const uint64_t* upper_row = i + 1 < resolution ? row + size_t(resolution) * words : nullptr;
+				bool inner_i = i > 0 && i < cells;
+				bool inner_j = j > 0 && j < cells;
+				for (int w = 0; w < words; w++) {
+					uint64_t x_crossings, z_crossings, y_crossings;
+					row_crossings(row, next_row, upper_row, w, words, resolution, x_crossings, z_crossings, y_crossings);
+					uint64_t inner_k = row_bits_from(w, 1) & ~row_bits_from(w, cells);
+					if (inner_i && inner_j) quad_count += bit_count(x_crossings);
+					if (inner_i) quad_count += bit_count(z_crossings & inner_k);
+					if (inner_j) quad_count += bit_count(y_crossings & inner_k);
+				}
+			}
+		}
+		slab.triangle_count = quad_count * 2;
+	});
+
+	// Prefix sums give every row of cells its first vertex id and every slab its range of the index buffer
+	uint32_t vertex_count = 0;
+	for (size_t row = 0; row < workspace.row_vertex_counts.size(); row++) {
+		workspace.row_vertex_offsets[row] = vertex_count;
+		vertex_count += workspace.row_vertex_counts[row];
+	}
+	size_t triangle_count = 0;
+	for (MarchingCubesSlab& slab : slabs) {
+		slab.index_offset = triangle_count * 3;
+		triangle_count += slab.triangle_count;
+	}
+	workspace.positions.resize(vertex_count);
+	if (parameters.gradient_normals) workspace.normals.resize(vertex_count);
+	return triangle_count;
+}
+
+// Calls cell(i, j, k, cube_index, id) for every active cell of the cell layers of slab s, in vertex order
+template <typename Function>
+void for_each_dual_cell(const MarchingCubesWorkspace& workspace, int resolution, int s, Function cell) {
+	int cells = resolution - 1;
+	int words = classification_words(resolution);
+	const MarchingCubesSlab& slab = workspace.slabs[s];
+	for (int i = slab.first_layer; i < slab.last_layer; i++) {
+		for (int j = 0; j < cells; j++) {
+			size_t row = size_t(cells) * i + j;
+			const uint64_t* point_row = workspace.point_bits.data() + (size_t(resolution) * i + j) * words;
+			const uint64_t* upper_row = point_row + size_t(resolution) * words;
+			uint32_t id = workspace.row_vertex_offsets[row];
+			for (int w = 0; w < words; w++) {
+				for (uint64_t active = workspace.cell_bits[row * words + w]; active; active &= active - 1) {
+					int k = w * 64 + lowest_bit(active);
+					cell(i, j, k, cell_cube_index(point_row, point_row + words, upper_row, upper_row + words, k), id++);
+				}
+			}
+		}
+	}
+}
+
+// Writes the quads of every slab into its range of indices once the vertex positions are in the workspace
+void write_dual_quads(MarchingCubesWorkspace& workspace, int resolution, std::vector<uint32_t>& indices);
+
+template <typename Scalar, typename Placement, typename VertexFormat>
+void generate_surface_nets_kernel(const Scalar* grid, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh) {
+	int resolution = parameters.resolution;
+	bool gradient = parameters.gradient_normals;
+	if (resolution < 2) {
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return;
+	}
+	MarchingCubesWorkspace& workspace = marching_cubes_workspace();
+	size_t triangle_count = find_dual_cells(grid, parameters, workspace);
+	std::vector<uint32_t>& indices = parameters.indexed ? mesh.indices : workspace.indices;
+	indices.resize(triangle_count * 3);
+
+	// The vertex of every active cell at the mean of the crossings of its edges, from the eight values of its
+	// corners read once
+	// Gradient normals interpolate the gradients of the eight corners of the cell at the vertex
+	float half_size = parameters.cube_size / 2.0f;
+	float last = float(resolution - 1);
+	const int* corner_offsets = surface_nets_corners();
+	size_t offsets[8];
+	for (int corner = 0; corner < 8; corner++) {
+		offsets[corner] = (size_t(resolution) * (corner >> 2) + ((corner >> 1) & 1)) * resolution + (corner & 1);
+	}
+	parallel_for(int(workspace.slabs.size()), [&](int s) {
+		for_each_dual_cell(workspace, resolution, s, [&](int i, int j, int k, int cube_index, uint32_t id) {
+			const Scalar* cell = grid + (size_t(resolution) * i + j) * resolution + k;
+			float values[8];
+			for (int corner = 0; corner < 8; corner++) values[corner] = float(cell[offsets[corner]]);
+			// Crossings in cell coordinates, (k, i, j) from the corner of the cell
+			Vector3 sum;
+			int crossing_count = 0;
+			for (int edges = edgeTable[cube_index]; edges; edges &= edges - 1) {
+				const int* edge = cube_edges[lowest_bit(uint64_t(edges))];
+				int corner = edge[0] << 2 | edge[1] << 1 | edge[2];
+				float fraction = Placement::fraction(values[corner], values[corner + corner_offsets[edge[3]]], parameters);
+				sum = sum + Vector3(float(edge[2]) + (edge[3] == 0 ? fraction : 0.0f),
+					float(edge[0]) + (edge[3] == 2 ? fraction : 0.0f),
+					float(edge[1]) + (edge[3] == 1 ? fraction : 0.0f));
+				crossing_count++;
+			}
+			Vector3 local = sum / float(crossing_count);
+			workspace.positions[id] = Vector3(map(float(k) + local.x, 0.0f, last, -half_size, half_size),
+				map(float(i) + local.y, 0.0f, last, -half_size, half_size),
+				map(float(j) + local.z, 0.0f, last, -half_size, half_size));
+			if (gradient) {
+				Vector3 normal;
+				for (int corner = 0; corner < 8; corner++) {
+					int di = corner >> 2, dj = (corner >> 1) & 1, dk = corner & 1;
+					float weight = (dk ? local.x : 1.0f - local.x) * (di ? local.y : 1.0f - local.y) * (dj ? local.z : 1.0f - local.z);
+					normal = normal + weight * point_gradient(grid, resolution, i + di, j + dj, k + dk);
+				}
+				workspace.normals[id] = normalize(normal);
+			}
+		});
+	});
+
+	write_dual_quads(workspace, resolution, indices);
+	write_marching_cubes_mesh(workspace, indices, parameters.indexed, gradient, format, mesh);
+}
@@ -0,0 +1,234 @@
+#include "Transvoxel.h"
+
+#include <algorithm>
+
+// Points of a transition cell, 0 to 8 the fine samples u + 3 * v and 9 to 12 the coarse corners (0, 0), (2, 0),
+// (0, 2) and (2, 2), which take the samples of the fine corners
+static int point_sample(int point) {
+	static const int corner_samples[4] = { 0, 2, 6, 8 };
+	return point < 9 ? point : corner_samples[point - 9];
+}
+static Vector3 point_position(int point) {
+	if (point < 9) return Vector3(float(point % 3), float(point / 3), 0.0f);
+	int corner = point - 9;
+	return Vector3(float((corner & 1) * 2), float((corner >> 1) * 2), 1.0f);
+}
+static int u_edge(int u, int v) {
+	return 2 * v + u;
+}
+static int v_edge(int u, int v) {
+	return 6 + 2 * u + v;
+}
+
+// Points at both ends of every vertex edge
+typedef struct TransitionEdges {
+	int points[transition_vertices][2];
+	TransitionEdges() {
+		for (int v = 0; v < 3; v++) {
+			for (int u = 0; u < 2; u++) {
+				points[u_edge(u, v)][0] = u + 3 * v;
+				points[u_edge(u, v)][1] = u + 1 + 3 * v;
+			}
+		}
+		for (int u = 0; u < 3; u++) {
+			for (int v = 0; v < 2; v++) {
+				points[v_edge(u, v)][0] = u + 3 * v;
+				points[v_edge(u, v)][1] = u + 3 * (v + 1);
+			}
+		}
+		const int coarse[4][2] = { { 9, 10 }, { 11, 12 }, { 9, 11 }, { 10, 12 } };
+		for (int e = 0; e < 4; e++) {
+			points[12 + e][0] = coarse[e][0];
+			points[12 + e][1] = coarse[e][1];
+		}
+	}
+} TransitionEdges;
+static const TransitionEdges& transition_edges() {
+	static const TransitionEdges edges;
+	return edges;
+}
+
+// Faces of a transition cell as their points in order around them, the vertex edge from every point to the
+// next one, -1 for the sides between a fine corner and its coarse copy, which never cross, and their outward normal
+typedef struct TransitionCellFace {
+	int count;
+	int points[5];
+	int sides[5];
+	float normal[3];
+} TransitionCellFace;
+static const TransitionCellFace transition_cell_faces[9] = {
+	{ 4, { 0, 1, 4, 3 }, { u_edge(0, 0), v_edge(1, 0), u_edge(0, 1), v_edge(0, 0) }, { 0, 0, -1 } },
+	{ 4, { 1, 2, 5, 4 }, { u_edge(1, 0), v_edge(2, 0), u_edge(1, 1), v_edge(1, 0) }, { 0, 0, -1 } },
+	{ 4, { 3, 4, 7, 6 }, { u_edge(0, 1), v_edge(1, 1), u_edge(0, 2), v_edge(0, 1) }, { 0, 0, -1 } },
+	{ 4, { 4, 5, 8, 7 }, { u_edge(1, 1), v_edge(2, 1), u_edge(1, 2), v_edge(1, 1) }, { 0, 0, -1 } },
+	{ 4, { 9, 10, 12, 11 }, { 12, 15, 13, 14 }, { 0, 0, 1 } },
+	{ 5, { 0, 1, 2, 10, 9 }, { u_edge(0, 0), u_edge(1, 0), -1, 12, -1 }, { 0, -1, 0 } },
+	{ 5, { 6, 7, 8, 12, 11 }, { u_edge(0, 2), u_edge(1, 2), -1, 13, -1 }, { 0, 1, 0 } },
+	{ 5, { 0, 3, 6, 11, 9 }, { v_edge(0, 0), v_edge(0, 1), -1, 14, -1 }, { -1, 0, 0 } },
+	{ 5, { 2, 5, 8, 12, 10 }, { v_edge(2, 0), v_edge(2, 1), -1, 15, -1 }, { 1, 0, 0 } }
+};
+
+TransitionCellTable::TransitionCellTable() {
+	const TransitionEdges& edges = transition_edges();
+	for (int cell_case = 0; cell_case < 512; cell_case++) {
+		auto below = [&](int point) { return (cell_case >> point_sample(point)) & 1; };
+		auto crossed = [&](int edge) { return edge >= 0 && below(edges.points[edge][0]) != below(edges.points[edge][1]); };
+
+		// The surface meets every face in segments between its crossings, which link the crossings into loops
+		// Faces with four crossings cut off their corners below the threshold, like triTable
+		// Segments run along g x n, g going from the points below the threshold to the ones above across the
+		// segment and n the outward normal of the face, so the loops wind around the normal of the surface
+		auto crossing_position = [&](int edge) {
+			return 0.5f * (point_position(edges.points[edge][0]) + point_position(edges.points[edge][1]));
+		};
+		int next[transition_vertices];
+		std::fill(next, next + transition_vertices, -1);
+		for (const TransitionCellFace& face : transition_cell_faces) {
+			// Crossed sides, each with the corner after it
+			int crossings[4];
+			int corners[4];
+			int crossing_count = 0;
+			for (int s = 0; s < face.count; s++) {
+				if (!crossed(face.sides[s])) continue;
+				crossings[crossing_count] = face.sides[s];
+				corners[crossing_count++] = face.points[(s + 1) % face.count];
+			}
+			int pairs[2][2];
+			int pair_count = 0;
+			if (crossing_count == 2) {
+				pairs[pair_count][0] = 0;
+				pairs[pair_count++][1] = 1;
+			}
+			else if (crossing_count == 4) {
+				int first = below(corners[0]) ? 0 : 1;
+				pairs[pair_count][0] = first;
+				pairs[pair_count++][1] = first + 1;
+				pairs[pair_count][0] = first + 2;
+				pairs[pair_count++][1] = (first + 3) % 4;
+			}
+			Vector3 normal(face.normal[0], face.normal[1], face.normal[2]);
+			Vector3 centre;
+			for (int s = 0; s < face.count; s++) {
+				centre = centre + point_position(face.points[s]) / float(face.count);
+			}
+			for (int p = 0; p < pair_count; p++) {
+				// The corner after the first crossing is on the side of the segment the face goes around to
+				// reach the second one. It is moved out of the face a little, as the segments between the
+				// crossings on both sides of a fine sample in the middle of a side run through it
+				int a = crossings[pairs[p][0]];
+				int b = crossings[pairs[p][1]];
+				Vector3 A = crossing_position(a);
+				Vector3 B = crossing_position(b);
+				Vector3 corner = point_position(corners[pairs[p][0]]);
+				corner = corner + 0.125f * (corner - centre);
+				Vector3 g = 0.5f * (A + B) - corner;
+				if (!below(corners[pairs[p][0]])) g = Vector3() - g;
+				if (dot(B - A, cross(g, normal)) < 0) std::swap(a, b);
+				next[a] = b;
+			}
+		}
+
+		// Walk every loop and clip its ears, shortest diagonal first
+		int triangle_count = 0;
+		bool visited[transition_vertices] = {};
+		for (int start = 0; start < transition_vertices; start++) {
+			if (visited[start] || next[start] < 0) continue;
+			std::vector<int> loop;
+			for (int current = start; !visited[current]; current = next[current]) {
+				visited[current] = true;
+				loop.push_back(current);
+			}
+			std::vector<Vector3> positions(loop.size());
+			for (size_t n = 0; n < loop.size(); n++) {
+				positions[n] = crossing_position(loop[n]);
+			}
+			while (loop.size() >= 3) {
+				size_t ear = 0;
+				float shortest = 0;
+				for (size_t n = 0; n < loop.size(); n++) {
+					Vector3 diagonal = positions[(n + 1) % loop.size()] - positions[(n + loop.size() - 1) % loop.size()];
+					float length = dot(diagonal, diagonal);
+					if (n == 0 || length < shortest) {
+						ear = n;
+						shortest = length;
+					}
+				}
+				int8_t* triangle = triangles[cell_case] + triangle_count++ * 3;
+				triangle[0] = int8_t(loop[(ear + loop.size() - 1) % loop.size()]);
+				triangle[1] = int8_t(loop[ear]);
+				triangle[2] = int8_t(loop[(ear + 1) % loop.size()]);
+				loop.erase(loop.begin() + ear);
+				positions.erase(positions.begin() + ear);
+			}
+		}
+		triangle_counts[cell_case] = triangle_count;
+	}
+}
+
+const TransitionCellTable& transition_cell_table() {
+	static const TransitionCellTable table;
+	return table;
+}
+
+// Slot of vertex edge of cell (cu, cv) among the edges of a face of cells cells, the same for every cell around the
+// edge: the fine edges along u, then along v, then the coarse edges along u, then along v
+static size_t face_edge_slot(int cells, int cu, int cv, int edge) {
+	size_t fine_edges = size_t(2 * cells) * (2 * cells + 1);
+	size_t coarse_edges = size_t(cells) * (cells + 1);
+	if (edge < 6) return size_t(2 * cv + edge / 2) * (2 * cells) + 2 * cu + edge % 2;
+	if (edge < 12) return fine_edges + size_t(2 * cu + (edge - 6) / 2) * (2 * cells) + 2 * cv + (edge - 6) % 2;
+	if (edge < 14) return 2 * fine_edges + size_t(cv + edge - 12) * cells + cu;
+	return 2 * fine_edges + coarse_edges + size_t(cu + edge - 14) * cells + cv;
+}
+
+void extract_transition_face(const TransitionFace& face, const MarchingCubesParameters& parameters, const std::function<Vector3(Vector3)>& normal,
+	MarchingCubesMesh& mesh) {
+	const TransitionCellTable& table = transition_cell_table();
+	const TransitionEdges& edges = transition_edges();
+	int samples = 2 * face.cells + 1;
+	// Vertex of every edge of the face, so the cells on both sides of an edge share its crossing
+	static thread_local std::vector<uint32_t> edge_vertices;
+	edge_vertices.assign(2 * size_t(2 * face.cells) * samples + 2 * size_t(face.cells) * (face.cells + 1), UINT32_MAX);
+	for (int cv = 0; cv < face.cells; cv++) {
+		for (int cu = 0; cu < face.cells; cu++) {
+			// Fine samples of the cell, u + 3 * v from fine sample (2 * cu, 2 * cv)
+			float values[9];
+			int cell_case = 0;
+			for (int point = 0; point < 9; point++) {
+				values[point] = face.values[samples * (2 * cv + point / 3) + 2 * cu + point % 3];
+				cell_case |= int(values[point] < parameters.threshold) << point;
+			}
+			int triangle_count = table.triangle_counts[cell_case];
+			if (!triangle_count) continue;
+
+			// Crossings of the cell, placed along their edge like the marching cubes vertices
+			const int8_t* triangles = table.triangles[cell_case];
+			for (int t = 0; t < triangle_count; t++) {
+				int order[3] = { 0, 1, 2 };
+				if (face.mirrored) std::swap(order[1], order[2]);
+				for (int corner : order) {
+					int edge = triangles[t * 3 + corner];
+					uint32_t& vertex_id = edge_vertices[face_edge_slot(face.cells, cu, cv, edge)];
+					if (vertex_id == UINT32_MAX) {
+						int p0 = edges.points[edge][0];
+						int p1 = edges.points[edge][1];
+						float V0 = values[point_sample(p0)];
+						float V1 = values[point_sample(p1)];
+						float fraction = parameters.interpolation ? (parameters.threshold - V0) / (V1 - V0) : 0.5f;
+						Vector3 P0 = point_position(p0);
+						Vector3 P1 = point_position(p1);
+						Vector3 P = P0 + fraction * (P1 - P0);
+						float u = float(2 * cu) + P.x;
+						float v = float(2 * cv) + P.y;
+						MeshVertex vertex;
+						vertex.position = edge < 12 ? face.fine_position(u, v) : face.coarse_position(u, v);
+						vertex.normal = normal(vertex.position);
+						vertex_id = uint32_t(mesh.vertices.size());
+						mesh.vertices.push_back(vertex);
+					}
+					mesh.indices.push_back(vertex_id);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Transvoxel transition cells, stitching a face of a chunk meshed at some resolution to a neighbour meshed at
+// twice that resolution without cracks
+// The coarse chunk shrinks its cells next to the face away from it, and the gap is filled by a layer of
+// transition cells. Each one has the 3x3 samples of the fine neighbour on its outer face, so it meets the fine
+// mesh exactly, and the 2x2 coarse samples on its inner face, so it meets the shrunk coarse cells exactly
+// The triangulations of the 512 cases are derived from the face rule of triTable, which cuts off the corners
+// below the threshold on ambiguous faces, so they agree with the marching cubes cells on every shared face
+
+#include "MarchingCubes.h"
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// Vertices of a transition cell are the crossings of its edges
+//  - 0 to 5, the edges of the fine face along u, 2 * v + u from sample (u, v)
+//  - 6 to 11, the edges of the fine face along v, 6 + 2 * u + v from sample (u, v)
+//  - 12 to 15, the edges of the coarse face, at v = 0, v = 2, u = 0 and u = 2
+// Cases have bit 3 * v + u set when fine sample (u, v) is below the threshold
+const int transition_vertices = 16;
+const int transition_max_triangles = 14;
+
+typedef struct TransitionCellTable {
+	int triangle_counts[512];
+	// Vertices of every triangle, wound like triTable in the (u, v, depth) frame, depth going into the coarse chunk
+	int8_t triangles[512][transition_max_triangles * 3];
+	TransitionCellTable();
+} TransitionCellTable;
+const TransitionCellTable& transition_cell_table();
+
+// Face of a coarse chunk next to a fine neighbour, cells coarse cells wide
+typedef struct TransitionFace {
+	int cells;
+	// (2 * cells + 1)^2 fine samples of the face, sample (u, v) at values[(2 * cells + 1) * v + u]
+	const float* values;
+	// Position of fine sample (u, v), in fine cells, and of the same point moved onto the inner face of the
+	// transition cells, where the shrunk coarse cells start
+	std::function<Vector3(float u, float v)> fine_position;
+	std::function<Vector3(float u, float v)> coarse_position;
+	// The (u, v, depth) frame is mirrored in the chunk, so the triangles are wound the other way
+	bool mirrored;
+} TransitionFace;
+
+// Appends the transition cells of a face to mesh, its vertices with the given normal function
+// Every crossing is added once and shared by the transition cells on both sides of its edge
+void extract_transition_face(const TransitionFace& face, const MarchingCubesParameters& parameters, const std::function<Vector3(Vector3)>& normal,
+	MarchingCubesMesh& mesh);
@@ -0,0 +1,117 @@
+#include "VertexCache.h"
+
+const uint32_t no_vertex = UINT32_MAX;
+
+VertexCacheWorkspace& vertex_cache_workspace() {
+	static thread_local VertexCacheWorkspace workspace;
+	return workspace;
+}
+
+// A vertex is in the FIFO cache while fewer than cache_size vertices entered it after, cache_times holds the time
+// it entered and time is the time of the next one to enter
+VertexCacheMetrics measure_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size) {
+	VertexCacheMetrics metrics;
+	if (!index_count || !vertex_count) return metrics;
+	std::vector<uint32_t>& cache_times = vertex_cache_workspace().cache_times;
+	cache_times.assign(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < index_count; i++) {
+		uint32_t v = indices[i];
+		if (time - cache_times[v] <= uint32_t(cache_size)) continue;
+		cache_times[v] = time++;
+		misses++;
+	}
+	metrics.acmr = double(misses) / double(index_count / 3);
+	metrics.atvr = double(misses) / double(vertex_count);
+	return metrics;
+}
+
+void optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size) {
+	size_t triangle_count = index_count / 3;
+	if (!triangle_count) return;
+	VertexCacheWorkspace& workspace = vertex_cache_workspace();
+	std::vector<uint32_t>& offsets = workspace.triangle_offsets;
+	std::vector<uint32_t>& vertex_triangles = workspace.vertex_triangles;
+	std::vector<uint32_t>& live_triangles = workspace.live_triangles;
+	std::vector<uint32_t>& cache_times = workspace.cache_times;
+	std::vector<uint8_t>& emitted = workspace.emitted;
+	std::vector<uint32_t>& dead_ends = workspace.dead_ends;
+	std::vector<uint32_t>& candidates = workspace.candidates;
+	std::vector<uint32_t>& output = workspace.indices;
+
+	// Triangles around every vertex, live_triangles counts the ones not emitted yet
+	offsets.assign(vertex_count + 1, 0);
+	for (size_t i = 0; i < index_count; i++) offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+	live_triangles.assign(vertex_count, 0);
+	vertex_triangles.resize(index_count);
+	for (size_t i = 0; i < index_count; i++) {
+		uint32_t v = indices[i];
+		vertex_triangles[offsets[v] + live_triangles[v]++] = uint32_t(i / 3);
+	}
+	cache_times.assign(vertex_count, 0);
+	emitted.assign(triangle_count, 0);
+	dead_ends.clear();
+	output.resize(index_count);
+
+	uint32_t time = cache_size + 1;
+	size_t written = 0;
+	size_t next_vertex = 0;
+	uint32_t fan = indices[0];
+	while (fan != no_vertex) {
+		// Emit the triangles left around the fan vertex
+		candidates.clear();
+		for (uint32_t r = offsets[fan]; r < offsets[fan + 1]; r++) {
+			uint32_t t = vertex_triangles[r];
+			if (emitted[t]) continue;
+			emitted[t] = 1;
+			for (int c = 0; c < 3; c++) {
+				uint32_t v = indices[t * 3 + c];
+				output[written++] = v;
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				live_triangles[v]--;
+				if (time - cache_times[v] > uint32_t(cache_size)) cache_times[v] = time++;
+			}
+		}
+
+		// The next fan is the candidate that entered the cache first among the ones whose triangles left still
+		// fit before it leaves, any candidate with triangles left otherwise
+		fan = no_vertex;
+		int64_t best_priority = -1;
+		for (uint32_t v : candidates) {
+			if (!live_triangles[v]) continue;
+			int64_t priority = 0;
+			int64_t age = int64_t(time) - cache_times[v];
+			if (age + 2 * int64_t(live_triangles[v]) <= cache_size) priority = age;
+			if (priority > best_priority) {
+				best_priority = priority;
+				fan = v;
+			}
+		}
+		// Dead end, back to the most recent vertex with triangles left, then to the first one in vertex order
+		while (fan == no_vertex && !dead_ends.empty()) {
+			uint32_t v = dead_ends.back();
+			dead_ends.pop_back();
+			if (live_triangles[v]) fan = v;
+		}
+		for (; fan == no_vertex && next_vertex < vertex_count; next_vertex++) {
+			if (live_triangles[next_vertex]) fan = uint32_t(next_vertex);
+		}
+	}
+	std::copy(output.begin(), output.begin() + written, indices);
+}
+
+void vertex_fetch_remap(uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint32_t>& remap) {
+	remap.assign(vertex_count, no_vertex);
+	uint32_t next = 0;
+	for (size_t i = 0; i < index_count; i++) {
+		uint32_t& v = indices[i];
+		if (remap[v] == no_vertex) remap[v] = next++;
+		v = remap[v];
+	}
+	for (size_t v = 0; v < vertex_count; v++) {
+		if (remap[v] == no_vertex) remap[v] = next++;
+	}
+}
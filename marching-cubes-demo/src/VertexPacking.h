@@ -0,0 +1,101 @@
+#pragma once
+
+// Packed vertex layout for the GPU, 12 bytes per vertex
+//  - Position: 16 bit unsigned normalized coordinates inside the [-cube_size/2, cube_size/2] bounds of the grid
+//  - Normal: octahedral encoding in two 16 bit signed normalized values
+// Color is not stored per vertex, it is a per draw constant
+
+#include "MarchingCubes.h"
+
+#include <cstdint>
+#include <cmath>
+
+typedef struct PackedVertex {
+	// xyz, w is padding so the position matches DXGI_FORMAT_R16G16B16A16_UNORM
+	uint16_t position[4];
+	// Octahedral coordinates as DXGI_FORMAT_R16G16_SNORM
+	int16_t normal[2];
+} PackedVertex;
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must stay 12 bytes");
+
+// Largest position error per axis after a round trip, half a quantization step plus float rounding
+inline float packed_position_error(float cube_size) {
+	return cube_size * (0.5f / 65535.0f + 1e-6f);
+}
+// Largest angle in radians between a unit normal and its decoded round trip
+// Half a quantization step on both octahedral coordinates, stretched up to about 3 times where the octahedron is most distorted
+const float packed_normal_error = 3.0f / 32767.0f;
+
+inline uint16_t encode_unorm16(float value) {
+	value = value < 0 ? 0 : value > 1 ? 1 : value;
+	return uint16_t(value * 65535.0f + 0.5f);
+}
+inline float decode_unorm16(uint16_t value) {
+	return value / 65535.0f;
+}
+inline int16_t encode_snorm16(float value) {
+	value = value < -1 ? -1 : value > 1 ? 1 : value;
+	return int16_t(lroundf(value * 32767.0f));
+}
+inline float decode_snorm16(int16_t value) {
+	float decoded = value / 32767.0f;
+	return decoded < -1 ? -1 : decoded;
+}
+
+inline void encode_packed_position(Vector3 position, float cube_size, uint16_t* packed) {
+	float half_size = cube_size / 2.0f;
+	packed[0] = encode_unorm16((position.x + half_size) / cube_size);
+	packed[1] = encode_unorm16((position.y + half_size) / cube_size);
+	packed[2] = encode_unorm16((position.z + half_size) / cube_size);
+	packed[3] = 0;
+}
+inline Vector3 decode_packed_position(const uint16_t* packed, float cube_size) {
+	float half_size = cube_size / 2.0f;
+	return Vector3(decode_unorm16(packed[0]) * cube_size - half_size,
+		decode_unorm16(packed[1]) * cube_size - half_size,
+		decode_unorm16(packed[2]) * cube_size - half_size);
+}
+
+// Projects the normal on the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+// Zero normals encode as (0, 0), which decodes to +z
+inline void encode_octahedral_normal(Vector3 normal, int16_t* packed) {
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	float u = length > 0 ? normal.x / length : 0;
+	float v = length > 0 ? normal.y / length : 0;
+	if (normal.z < 0) {
+		float folded_u = (1 - fabsf(v)) * (u >= 0 ? 1 : -1);
+		float folded_v = (1 - fabsf(u)) * (v >= 0 ? 1 : -1);
+		u = folded_u;
+		v = folded_v;
+	}
+	packed[0] = encode_snorm16(u);
+	packed[1] = encode_snorm16(v);
+}
+// Same decoding as PackedVertexShader.hlsl
+inline Vector3 decode_octahedral_normal(const int16_t* packed) {
+	float u = decode_snorm16(packed[0]);
+	float v = decode_snorm16(packed[1]);
+	Vector3 normal(u, v, 1 - fabsf(u) - fabsf(v));
+	if (normal.z < 0) {
+		normal.x = (1 - fabsf(v)) * (u >= 0 ? 1 : -1);
+		normal.y = (1 - fabsf(u)) * (v >= 0 ? 1 : -1);
+	}
+	return normalize(normal);
+}
+
+// Vertex format for the extraction kernel writing PackedVertex
+typedef struct PackedVertexFormat {
+	typedef PackedVertex VertexType;
+	float cube_size;
+	void write(PackedVertex& vertex, Vector3 position, Vector3 normal) const {
+		encode_packed_position(position, cube_size, vertex.position);
+		encode_octahedral_normal(normal, vertex.normal);
+	}
+} PackedVertexFormat;
+
+inline MeshVertex decode_packed_vertex(const PackedVertex& vertex, float cube_size) {
+	MeshVertex decoded;
+	decoded.position = decode_packed_position(vertex.position, cube_size);
+	decoded.normal = decode_octahedral_normal(vertex.normal);
+	return decoded;
+}
@@ -0,0 +1,448 @@
+#include "VolumeFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void unmap_view(MappedVolume& volume) {
+	if (!volume.view) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(volume.view);
+#else
+	munmap(volume.view, volume.view_size);
+#endif
+	volume.view = nullptr;
+	volume.view_size = 0;
+}
+
+static size_t mapping_granularity() {
+#if defined(_WIN32)
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	return system_info.dwAllocationGranularity;
+#else
+	return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Opens the data file of the volume and checks it holds every sample of its description
+static bool open_data_file(MappedVolume& volume) {
+	const VolumeDescription& description = volume.description;
+	if (description.size_x < 1 || description.size_y < 1 || description.size_z < 1) {
+		volume.error = "Volume sizes must be positive";
+		return false;
+	}
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(volume.data_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		volume.error = "Cannot open " + volume.data_path;
+		return false;
+	}
+	volume.file = intptr_t(file);
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	volume.file_size = uint64_t(file_size.QuadPart);
+	FILETIME write_time;
+	if (GetFileTime(file, nullptr, nullptr, &write_time)) volume.modified_time = uint64_t(write_time.dwHighDateTime) << 32 | write_time.dwLowDateTime;
+#else
+	int file = open(volume.data_path.c_str(), O_RDONLY);
+	if (file < 0) {
+		volume.error = "Cannot open " + volume.data_path;
+		return false;
+	}
+	volume.file = file;
+	struct stat file_status;
+	fstat(file, &file_status);
+	volume.file_size = uint64_t(file_status.st_size);
+	// Nanoseconds, so a file rewritten within a second still reads as changed
+#if defined(__APPLE__)
+	volume.modified_time = uint64_t(file_status.st_mtimespec.tv_sec) * 1000000000ull + uint64_t(file_status.st_mtimespec.tv_nsec);
+#else
+	volume.modified_time = uint64_t(file_status.st_mtim.tv_sec) * 1000000000ull + uint64_t(file_status.st_mtim.tv_nsec);
+#endif
+#endif
+	uint64_t data_size = uint64_t(volume_slice_bytes(description)) * description.size_z;
+	if (volume.file_size < description.data_offset + data_size) {
+		volume.error = "File is smaller than the samples of the volume";
+		close_volume(volume);
+		return false;
+	}
+#if defined(_WIN32)
+	volume.mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!volume.mapping) {
+		volume.error = "Cannot map " + volume.data_path;
+		close_volume(volume);
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool open_raw_volume(const char* path, const VolumeDescription& description, MappedVolume& volume) {
+	close_volume(volume);
+	volume.description = description;
+	volume.data_path = path;
+	volume.error.clear();
+	return open_data_file(volume);
+}
+
+static std::string trim(const std::string& text) {
+	size_t first = text.find_first_not_of(" \t\r");
+	size_t last = text.find_last_not_of(" \t\r");
+	return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+bool open_nrrd_volume(const char* path, MappedVolume& volume) {
+	close_volume(volume);
+	volume.error.clear();
+	std::ifstream header(path, std::ios::binary);
+	std::string line;
+	if (!header || !std::getline(header, line) || line.compare(0, 4, "NRRD") != 0) {
+		volume.error = std::string("Not a NRRD file: ") + path;
+		return false;
+	}
+	VolumeDescription description;
+	std::string data_file;
+	int dimension = 0;
+	while (std::getline(header, line)) {
+		line = trim(line);
+		if (line.empty()) break;
+		if (line[0] == '#') continue;
+		// Key/value pairs use ":=" and are skipped, fields use ": "
+		size_t separator = line.find(':');
+		if (separator == std::string::npos || (separator + 1 < line.size() && line[separator + 1] == '=')) continue;
+		std::string field = trim(line.substr(0, separator));
+		std::string value = trim(line.substr(separator + 1));
+		std::transform(field.begin(), field.end(), field.begin(), [](char c) { return char(tolower(c)); });
+		if (field == "type") {
+			if (value == "uchar" || value == "unsigned char" || value == "uint8" || value == "uint8_t") description.sample_type = volume_uint8;
+			else if (value == "ushort" || value == "unsigned short" || value == "unsigned short int" || value == "uint16" || value == "uint16_t") description.sample_type = volume_uint16;
+			else if (value == "float") description.sample_type = volume_float32;
+			else {
+				volume.error = "Unsupported NRRD type " + value;
+				return false;
+			}
+		}
+		else if (field == "dimension") dimension = atoi(value.c_str());
+		else if (field == "sizes") std::istringstream(value) >> description.size_x >> description.size_y >> description.size_z;
+		else if (field == "endian") description.big_endian = value == "big";
+		else if (field == "encoding" && value != "raw") {
+			volume.error = "Unsupported NRRD encoding " + value;
+			return false;
+		}
+		else if (field == "data file" || field == "datafile") data_file = value;
+		else if (field == "byte skip" || field == "byteskip") description.data_offset = uint64_t(std::max(atoll(value.c_str()), 0LL));
+	}
+	if (dimension != 3) {
+		volume.error = "Only 3 dimensional NRRD volumes are supported";
+		return false;
+	}
+	if (data_file.empty()) {
+		// Attached data starts right after the blank line ending the header
+		volume.data_path = path;
+		description.data_offset = uint64_t(header.tellg());
+	}
+	else {
+		// Detached data files are relative to the header
+		std::string directory = path;
+		size_t slash = directory.find_last_of("/\\");
+		bool absolute = data_file[0] == '/' || data_file[0] == '\\' || (data_file.size() > 1 && data_file[1] == ':');
+		volume.data_path = absolute || slash == std::string::npos ? data_file : directory.substr(0, slash + 1) + data_file;
+	}
+	volume.description = description;
+	return open_data_file(volume);
+}
+
+bool open_volume(const char* path, const VolumeDescription& description, MappedVolume& volume) {
+	std::string name = path;
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) { return char(tolower(c)); });
+	bool nrrd = (name.size() > 5 && name.compare(name.size() - 5, 5, ".nrrd") == 0) || (name.size() > 5 && name.compare(name.size() - 5, 5, ".nhdr") == 0);
+	return nrrd ? open_nrrd_volume(path, volume) : open_raw_volume(path, description, volume);
+}
+
+void close_volume(MappedVolume& volume) {
+	unmap_view(volume);
+#if defined(_WIN32)
+	if (volume.mapping) CloseHandle(volume.mapping);
+	if (volume.file != -1) CloseHandle(HANDLE(volume.file));
+#else
+	if (volume.file != -1) close(int(volume.file));
+#endif
+	volume.mapping = nullptr;
+	volume.file = -1;
+	volume.file_size = 0;
+	volume.modified_time = 0;
+}
+
+const uint8_t* map_volume_slices(MappedVolume& volume, int first, int count) {
+	unmap_view(volume);
+	if (volume.file == -1 || count < 1) return nullptr;
+	size_t granularity = mapping_granularity();
+	uint64_t offset = volume.description.data_offset + uint64_t(volume_slice_bytes(volume.description)) * first;
+	volume.view_offset = offset - offset % granularity;
+	size_t size = size_t(offset - volume.view_offset) + volume_slice_bytes(volume.description) * count;
+#if defined(_WIN32)
+	void* view = MapViewOfFile(volume.mapping, FILE_MAP_READ, DWORD(volume.view_offset >> 32), DWORD(volume.view_offset & 0xFFFFFFFF), size);
+	if (!view) return nullptr;
+#else
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, int(volume.file), off_t(volume.view_offset));
+	if (view == MAP_FAILED) return nullptr;
+	madvise(view, size, MADV_SEQUENTIAL);
+#endif
+	volume.view = static_cast<uint8_t*>(view);
+	volume.view_size = size;
+	volume.peak_view_size = std::max(volume.peak_view_size, size);
+	return volume.view + (offset - volume.view_offset);
+}
+
+static bool machine_big_endian() {
+	uint16_t one = 1;
+	uint8_t first_byte;
+	memcpy(&first_byte, &one, 1);
+	return first_byte == 0;
+}
+
+void convert_volume_slice(const VolumeDescription& description, const uint8_t* samples, float* values) {
+	size_t count = size_t(description.size_x) * description.size_y;
+	bool swap = description.big_endian != machine_big_endian();
+	if (description.sample_type == volume_uint8) {
+		for (size_t s = 0; s < count; s++) values[s] = samples[s] / 255.0f;
+	}
+	else if (description.sample_type == volume_uint16) {
+		for (size_t s = 0; s < count; s++) {
+			uint16_t sample;
+			memcpy(&sample, samples + s * 2, 2);
+			if (swap) sample = uint16_t(sample << 8 | sample >> 8);
+			values[s] = sample / 65535.0f;
+		}
+	}
+	else {
+		for (size_t s = 0; s < count; s++) {
+			uint32_t sample;
+			memcpy(&sample, samples + s * 4, 4);
+			if (swap) sample = (sample << 24) | ((sample << 8) & 0x00FF0000u) | ((sample >> 8) & 0x0000FF00u) | (sample >> 24);
+			memcpy(&values[s], &sample, 4);
+		}
+	}
+}
+
+void stream_marching_cubes_slices(int size_x, int size_y, int size_z, const SliceLoader& load_values, const MarchingCubesParameters& parameters,
+	const MeshStream& stream, VolumeExtractionStats& stats) {
+	auto start = std::chrono::high_resolution_clock::now();
+	if (size_x < 2 || size_y < 2 || size_z < 2) return;
+
+	// The largest axis spans the cube, the others are centered in it
+	int size_max = std::max(size_x, std::max(size_y, size_z));
+	float half_size = parameters.cube_size / 2.0f;
+	float spacing = parameters.cube_size / (size_max - 1);
+	auto coordinate = [&](int n, int size) {
+		return map(float(n), 0.0f, float(size_max - 1), -half_size, half_size) + (size_max - size) * spacing / 2.0f;
+	};
+	auto position = [&](int i, int j, int k) { return Vector3(coordinate(k, size_x), coordinate(i, size_z), coordinate(j, size_y)); };
+
+	// Two float slices, three layers of classification bits and two slices of edge ids, each used round robin
+	int words = classification_words(size_x);
+	size_t slice_points = size_t(size_x) * size_y;
+	size_t row_stride = size_t(size_x) * 3;
+	std::vector<float> values[2];
+	std::vector<uint64_t> bits[3];
+	std::vector<uint32_t> edge_ids[2];
+	for (int s = 0; s < 2; s++) {
+		values[s].resize(slice_points);
+		edge_ids[s].resize(row_stride * size_y);
+	}
+	for (int s = 0; s < 3; s++) bits[s].resize(size_t(size_y) * words);
+	std::vector<uint64_t> active_bits(words);
+	size_t slice_buffers = 2 * slice_points * sizeof(float) + 3 * bits[0].size() * sizeof(uint64_t) + 2 * edge_ids[0].size() * sizeof(uint32_t);
+
+	// Vertices from window_first on, the ones of the layers whose normals are not final yet, with the triangles
+	// of the cell layer just triangulated and of the one before, held back until all their vertices are written
+	uint32_t window_first = 0;
+	std::vector<Vector3> positions, normals;
+	std::vector<uint32_t> layer_indices, pending_indices;
+	// Vertices and face normals of the triangles of a cell layer for unindexed meshes
+	std::vector<Vector3> triangle_positions, triangle_normals;
+	auto track_buffers = [&]() {
+		size_t window = (positions.capacity() + normals.capacity() + triangle_positions.capacity() + triangle_normals.capacity()) * sizeof(Vector3) +
+			(layer_indices.capacity() + pending_indices.capacity()) * sizeof(uint32_t);
+		stats.peak_buffers = std::max(stats.peak_buffers, slice_buffers + window);
+	};
+
+	auto load_slice = [&](int z) {
+		float* slice = values[z & 1].data();
+		if (!load_values(z, slice)) return false;
+		for (int j = 0; j < size_y; j++) {
+			classify_points(slice + size_t(size_x) * j, size_x, parameters.threshold, &bits[z % 3][size_t(words) * j]);
+		}
+		return true;
+	};
+
+	// Numbers the crossed edges starting at the points of layer z in grid order and places their vertices
+	uint32_t vertex_count = 0;
+	std::vector<uint32_t> layer_first(size_z + 1);
+	auto number_layer = [&](int z) {
+		layer_first[z] = vertex_count;
+		const float* slice = values[z & 1].data();
+		const float* upper_slice = values[(z + 1) & 1].data();
+		uint32_t* slice_ids = edge_ids[z & 1].data();
+		for (int j = 0; j < size_y; j++) {
+			const uint64_t* row = &bits[z % 3][size_t(words) * j];
+			const uint64_t* next_row = j + 1 < size_y ? row + words : nullptr;
+			const uint64_t* upper_row = z + 1 < size_z ? &bits[(z + 1) % 3][size_t(words) * j] : nullptr;
+			uint32_t* row_ids = slice_ids + row_stride * j;
+			const float* row_values = slice + size_t(size_x) * j;
+			for (int w = 0; w < words; w++) {
+				uint64_t x_crossings, z_crossings, y_crossings;
+				row_crossings(row, next_row, upper_row, w, words, size_x, x_crossings, z_crossings, y_crossings);
+				for (uint64_t crossings = x_crossings | z_crossings | y_crossings; crossings; crossings &= crossings - 1) {
+					int bit = lowest_bit(crossings);
+					int k = w * 64 + bit;
+					Vector3 P0 = position(z, j, k);
+					if ((x_crossings >> bit) & 1) {
+						row_ids[k * 3] = vertex_count++;
+						positions.push_back(RuntimeInterpolation::place(P0, position(z, j, k + 1), row_values[k], row_values[k + 1], parameters));
+					}
+					if ((z_crossings >> bit) & 1) {
+						row_ids[k * 3 + 1] = vertex_count++;
+						positions.push_back(RuntimeInterpolation::place(P0, position(z, j + 1, k), row_values[k], row_values[k + size_x], parameters));
+					}
+					if ((y_crossings >> bit) & 1) {
+						row_ids[k * 3 + 2] = vertex_count++;
+						positions.push_back(RuntimeInterpolation::place(P0, position(z + 1, j, k), row_values[k], upper_slice[size_t(size_x) * j + k], parameters));
+					}
+				}
+			}
+		}
+		normals.resize(positions.size());
+	};
+
+	// Triangulates the cells between layers i and i + 1 from the edge ids of both layers
+	auto triangulate_layer = [&](int i) {
+		layer_indices.clear();
+		const uint32_t* const slices[2] = { edge_ids[i & 1].data(), edge_ids[(i + 1) & 1].data() };
+		for (int j = 0; j + 1 < size_y; j++) {
+			const uint64_t* row = &bits[i % 3][size_t(words) * j];
+			const uint64_t* upper_row = &bits[(i + 1) % 3][size_t(words) * j];
+			classify_active_cells(row, row + words, upper_row, upper_row + words, size_x - 1, active_bits.data());
+			for (int w = 0; w < words; w++) {
+				for (uint64_t active = active_bits[w]; active; active &= active - 1) {
+					int k = w * 64 + lowest_bit(active);
+					int cube_index = cell_cube_index(row, row + words, upper_row, upper_row + words, k);
+					uint32_t cube_vertices[12];
+					gather_cube_vertices(slices, row_stride * j + size_t(k) * 3, row_stride, cube_vertices, std::make_index_sequence<12>());
+					for (int m = 0; triTable[cube_index][m] != -1; m++) {
+						layer_indices.push_back(cube_vertices[triTable[cube_index][m]]);
+					}
+				}
+			}
+		}
+		stats.triangles += layer_indices.size() / 3;
+	};
+
+	// Smooth normals sum the triangles around every vertex in triangle order, like the in memory extraction, and
+	// are final once the cells on both sides of its layer are triangulated
+	auto accumulate_normals = [&]() {
+		for (size_t t = 0; t < layer_indices.size(); t += 3) {
+			uint32_t v1 = layer_indices[t] - window_first;
+			uint32_t v2 = layer_indices[t + 1] - window_first;
+			uint32_t v3 = layer_indices[t + 2] - window_first;
+			Vector3 normal = cross(positions[v2] - positions[v1], positions[v3] - positions[v1]);
+			normals[v1] = normals[v1] + normal;
+			normals[v2] = normals[v2] + normal;
+			normals[v3] = normals[v3] + normal;
+		}
+	};
+	auto flush_vertices = [&](uint32_t last) {
+		size_t count = last - window_first;
+		if (parameters.indexed && count) {
+			for (size_t v = 0; v < count; v++) normals[v] = normalize(normals[v]);
+			stream.write_vertices(positions.data(), normals.data(), count);
+		}
+		positions.erase(positions.begin(), positions.begin() + count);
+		normals.erase(normals.begin(), normals.begin() + count);
+		window_first = last;
+	};
+	auto flush_triangles = [&]() {
+		if (!pending_indices.empty()) stream.write_indices(pending_indices.data(), pending_indices.size());
+		std::swap(pending_indices, layer_indices);
+	};
+	// Unindexed meshes expand every triangle into its own three vertices with the face normal right away
+	auto write_triangle_vertices = [&]() {
+		triangle_positions.clear();
+		triangle_normals.clear();
+		for (size_t t = 0; t < layer_indices.size(); t += 3) {
+			Vector3 p1 = positions[layer_indices[t] - window_first];
+			Vector3 p2 = positions[layer_indices[t + 1] - window_first];
+			Vector3 p3 = positions[layer_indices[t + 2] - window_first];
+			Vector3 normal = normalize(cross(p2 - p1, p3 - p1));
+			triangle_positions.insert(triangle_positions.end(), { p1, p2, p3 });
+			triangle_normals.insert(triangle_normals.end(), { normal, normal, normal });
+		}
+		if (!triangle_positions.empty()) stream.write_vertices(triangle_positions.data(), triangle_normals.data(), triangle_positions.size());
+	};
+
+	// Layer z is numbered once layer z + 1 is classified, then the cells below it can find all their edges, and
+	// the vertices of layer z - 1 are final
+	if (load_slice(0) && load_slice(1)) {
+		for (int z = 0; z < size_z; z++) {
+			number_layer(z);
+			if (z > 0) {
+				triangulate_layer(z - 1);
+				if (parameters.indexed) {
+					accumulate_normals();
+					track_buffers();
+					flush_vertices(layer_first[z]);
+					flush_triangles();
+				}
+				else {
+					write_triangle_vertices();
+					track_buffers();
+					flush_vertices(layer_first[z]);
+				}
+			}
+			if (z + 2 < size_z && !load_slice(z + 2)) break;
+		}
+		if (parameters.indexed) {
+			flush_vertices(vertex_count);
+			flush_triangles();
+		}
+	}
+	stats.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void stream_marching_cubes_volume(MappedVolume& volume, const MarchingCubesParameters& parameters, const MeshStream& stream,
+	VolumeExtractionStats& stats) {
+	const VolumeDescription& description = volume.description;
+	stats = VolumeExtractionStats();
+	volume.peak_view_size = 0;
+	if (volume.file == -1) return;
+	stream_marching_cubes_slices(description.size_x, description.size_y, description.size_z, [&](int z, float* values) {
+		const uint8_t* samples = map_volume_slices(volume, z, 1);
+		if (!samples) {
+			volume.error = "Cannot map slice " + std::to_string(z);
+			return false;
+		}
+		convert_volume_slice(description, samples, values);
+		stats.bytes_read += volume_slice_bytes(description);
+		return true;
+	}, parameters, stream, stats);
+	unmap_view(volume);
+	stats.peak_mapped = volume.peak_view_size;
+}
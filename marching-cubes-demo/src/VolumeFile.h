@@ -0,0 +1,111 @@
+#pragma once
+
+// Raw and NRRD volume files, memory mapped and read one slice at a time
+// A volume is size_x * size_y * size_z samples with x the fastest axis, slices are the xy planes along z
+// Only the slices being read are mapped, so resident memory stays at a couple of slices whatever the file size
+// Samples map to the grid as k = x, j = y and i = z, so slices stack along the y axis of the mesh like grid layers
+
+#include "MarchingCubes.h"
+#include "MarchingCubesKernel.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+enum VolumeSampleType {
+	volume_uint8,
+	volume_uint16,
+	volume_float32
+};
+
+typedef struct VolumeDescription {
+	int size_x = 0;
+	int size_y = 0;
+	int size_z = 0;
+	VolumeSampleType sample_type = volume_uint8;
+	bool big_endian = false;
+	// Bytes before the first sample
+	uint64_t data_offset = 0;
+} VolumeDescription;
+
+typedef struct MappedVolume {
+	VolumeDescription description;
+	// File holding the samples, the header itself for raw files and attached NRRD data
+	std::string data_path;
+	uint64_t file_size = 0;
+	// Last write time of the data file in platform units, for keys that should change when the file does
+	uint64_t modified_time = 0;
+	// Platform file and mapping handles
+	intptr_t file = -1;
+	void* mapping = nullptr;
+	// Mapped window and the file offset it starts at, rounded down to the mapping granularity
+	uint8_t* view = nullptr;
+	uint64_t view_offset = 0;
+	size_t view_size = 0;
+	size_t peak_view_size = 0;
+	std::string error;
+} MappedVolume;
+
+typedef struct VolumeExtractionStats {
+	double time = 0;
+	uint64_t bytes_read = 0;
+	// Largest mapped window, and largest sum of the float slices, classification bits, edge ids and the vertices
+	// and triangles waiting for their normals kept while streaming
+	size_t peak_mapped = 0;
+	size_t peak_buffers = 0;
+	size_t triangles = 0;
+} VolumeExtractionStats;
+
+inline size_t volume_sample_size(VolumeSampleType sample_type) {
+	return sample_type == volume_uint8 ? 1 : sample_type == volume_uint16 ? 2 : 4;
+}
+inline size_t volume_slice_bytes(const VolumeDescription& description) {
+	return size_t(description.size_x) * description.size_y * volume_sample_size(description.sample_type);
+}
+
+// Open a volume and check the file holds all its samples, returning false with the reason in error otherwise
+bool open_raw_volume(const char* path, const VolumeDescription& description, MappedVolume& volume);
+// Reads the description from a NRRD header with raw encoding, the data attached or in a detached data file
+bool open_nrrd_volume(const char* path, MappedVolume& volume);
+// Opens .nrrd and .nhdr files as NRRD and anything else as raw with the given description
+bool open_volume(const char* path, const VolumeDescription& description, MappedVolume& volume);
+void close_volume(MappedVolume& volume);
+
+// Maps count slices starting at first, replacing the previous window, and returns the first sample of slice first
+// or nullptr when they cannot be mapped. A count of 0 only unmaps the previous window
+const uint8_t* map_volume_slices(MappedVolume& volume, int first, int count);
+// Converts a slice of samples to floats, integers normalized to [0, 1], swapping bytes when the file order
+// differs from the machine order
+void convert_volume_slice(const VolumeDescription& description, const uint8_t* samples, float* values);
+
+// Fills values with the size_x * size_y points of slice z, returning false to stop the extraction there
+typedef std::function<bool(int z, float* values)> SliceLoader;
+
+// Marching cubes over size_x * size_y * size_z points in a single pass along z, every slice loaded once in order,
+// with two float slices, three layers of classification bits and two slices of edge ids in memory. The largest
+// axis spans cube_size
+// The mesh goes to the stream layer by layer, so only the vertices of the two layers around the cells being
+// triangulated are ever held. Vertices and triangles are numbered like the grid kernel numbers them, so a cube of
+// points gives the same mesh as the grid extraction
+void stream_marching_cubes_slices(int size_x, int size_y, int size_z, const SliceLoader& load_values, const MarchingCubesParameters& parameters,
+	const MeshStream& stream, VolumeExtractionStats& stats);
+// Streams the whole volume, mapping one slice at a time
+void stream_marching_cubes_volume(MappedVolume& volume, const MarchingCubesParameters& parameters, const MeshStream& stream,
+	VolumeExtractionStats& stats);
+
+template <typename VertexFormat>
+void extract_marching_cubes_volume(MappedVolume& volume, const MarchingCubesParameters& parameters, const VertexFormat& format,
+	IndexedMesh<typename VertexFormat::VertexType>& mesh, VolumeExtractionStats& stats) {
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	MeshStream stream;
+	stream.write_vertices = [&](const Vector3* positions, const Vector3* normals, size_t count) {
+		size_t first = mesh.vertices.size();
+		mesh.vertices.resize(first + count);
+		for (size_t v = 0; v < count; v++) format.write(mesh.vertices[first + v], positions[v], normals[v]);
+	};
+	stream.write_indices = [&](const uint32_t* indices, size_t count) { mesh.indices.insert(mesh.indices.end(), indices, indices + count); };
+	stream_marching_cubes_volume(volume, parameters, stream, stats);
+}
@@ -1,3 +1,4 @@
+#define NOMINMAX
 #include <Windows.h>
 #include <Windowsx.h>
 
@@ -8,14 +9,36 @@
 #include <directxcolors.h>
 
 #include <vector>
-#include <random>
 #include <functional>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
 
 #include "imgui.h"
 #include "imgui_impl_win32.h"
 #include "imgui_impl_dx11.h"
 
-#include "MarchingCubesTables.h"
+#include "MarchingCubes.h"
+#include "MarchingCubesKernel.h"
+#include "SurfaceExtraction.h"
+#include "Parallel.h"
+#include "VertexPacking.h"
+#include "MinMaxPyramid.h"
+#include "ChunkedWorld.h"
+#include "SparseField.h"
+#include "CompressedField.h"
+#include "VolumeFile.h"
+#include "OutOfCore.h"
+#include "MeshWriter.h"
+#include "MeshCache.h"
+#include "Noise.h"
+#include "Decimation.h"
+#include "VertexCache.h"
+#include "Meshlets.h"
 
 namespace Colors {
 	XMGLOBALCONST DirectX::XMFLOAT4 White = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -29,27 +52,28 @@ namespace Colors {
 	XMGLOBALCONST DirectX::XMFLOAT4 Grey = { 0.5f, 0.5f, 0.5f, 1.0f };
 }
 
-typedef struct Vector3 {
-	float x, y, z;
-	Vector3() : x(0), y(0), z(0) {}
-	Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
-	inline Vector3 operator+(Vector3 other) { return Vector3(x + other.x, y + other.y, z + other.z); }
-	inline Vector3 operator-(Vector3 other) { return Vector3(x - other.x, y - other.y, z - other.z); }
-	inline Vector3 operator+(float other) { return Vector3(x + other, y + other, z + other); }
-	inline Vector3 operator-(float other) { return Vector3(x - other, y - other, z - other); }
-	inline Vector3 operator/(float other) { return Vector3(x / other, y / other, z / other); }
-} Vector3;
-inline Vector3 operator*(float other, Vector3 v) { return Vector3(v.x * other, v.y * other, v.z * other); }
-
 typedef struct Vertex {
 	DirectX::XMFLOAT3 position;
 	DirectX::XMFLOAT4 color;
 	DirectX::XMFLOAT3 normal;
 } Vertex;
 
-float map(float input, float input_start, float input_end, float output_start, float output_end) {
-	return output_start + ((output_end - output_start) / (input_end - input_start)) * (input - input_start);
-}
+// Writes extracted vertices straight into the Direct3D vertex layout, with the mesh color
+typedef struct D3DVertexFormat {
+	typedef Vertex VertexType;
+	DirectX::XMFLOAT4 color;
+	void write(Vertex& vertex, Vector3 position, Vector3 normal) const {
+		vertex.position = DirectX::XMFLOAT3(position.x, position.y, position.z);
+		vertex.color = color;
+		vertex.normal = DirectX::XMFLOAT3(normal.x, normal.y, normal.z);
+	}
+} D3DVertexFormat;
+
+// Per draw constants of packed meshes, bound to the vertex shader after the camera buffers
+typedef struct MeshConstants {
+	DirectX::XMFLOAT4 color;
+	DirectX::XMFLOAT4 cube_size;
+} MeshConstants;
 
 // Window parameters
 int screen_width = 1280;
@@ -60,198 +84,913 @@ ID3D11Device* d3d_device;
 ID3D11DeviceContext* d3d_context;
 
 // Vertex buffer, its buffer description and its subresource data
-Vertex* vertex_buffer_data = nullptr;
-std::vector<Vertex> mesh;
+// The mesh is kept either in the full Vertex layout or in the 12 byte PackedVertex layout
+const void* vertex_buffer_data = nullptr;
+IndexedMesh<Vertex> mesh;
+IndexedMesh<PackedVertex> packed_mesh;
 int vertices_count = 0;
 D3D11_BUFFER_DESC vertex_buffer_desc;
 D3D11_SUBRESOURCE_DATA vertex_subresource_data;
 ID3D11Buffer* vertex_buffer = nullptr;
 UINT stride = sizeof(Vertex);
+UINT mesh_stride = sizeof(Vertex);
 UINT offset = 0;
+ID3D11Buffer* mesh_constants_buffer = nullptr;
 
 // Vertex indices buffer, its buffer description and its subresource data
-UINT* vertex_indices_data = nullptr;
+const UINT* vertex_indices_data = nullptr;
 int indices_count = 0;
 D3D11_BUFFER_DESC vertex_indices_desc;
 D3D11_SUBRESOURCE_DATA vertex_indices_subresource_data;
 ID3D11Buffer* vertex_index_buffer = nullptr;
 
-// Random number generator
-std::mt19937_64 generator;
-std::uniform_real_distribution<float> distribution(0, 1);
-auto random = std::bind(distribution, generator);
-
 // Marching cube parameters
 float threshold = 0.5f;
 int resolution = 4;
 bool interpolation = true;
 float cube_size = 2.0f;
 float mesh_color[3] = {0.75f, 0.75f, 0.75f};
+bool indexed = true;
+bool gradient_normals = false;
+int extraction_engine = engine_marching_cubes;
+// Values of the grid, white noise, or coherent noise in the cube or as a terrain
+// The seed picks the white noise and the noise fields alike, the same seed always gives the same grid
+enum GridField {
+	grid_random,
+	grid_noise,
+	grid_terrain
+};
+int grid_field = grid_random;
+uint64_t grid_seed = 0;
+NoiseParameters noise_parameters;
+double grid_generation_time = 0;
+bool packed_vertices = false;
+int thread_count = 1;
 std::vector<float> grid;
+double extraction_time = 0;
+// Decimation of indexed meshes after extraction, into the MeshVertex mesh before the vertex layout is written
+bool decimate = false;
+DecimationParameters decimation_parameters;
+DecimationStats decimation_stats;
+MarchingCubesMesh decimation_mesh;
+// Triangle and vertex order of indexed meshes optimized for the post-transform vertex cache after extraction
+bool optimize_vertex_order = true;
+VertexCacheMetrics vertex_cache_before;
+VertexCacheMetrics vertex_cache_after;
+double vertex_order_time = 0;
+// Meshlets of indexed meshes, built from the vertex buffer after every extraction
+bool build_mesh_meshlets = false;
+MeshletMesh mesh_meshlets;
+std::vector<Vector3> meshlet_positions;
+double meshlet_build_time = 0;
+
+// Min/max pyramid of the grid, rebuilt with the grid and used to skip blocks on every extraction
+MinMaxPyramid pyramid;
+bool use_pyramid = true;
+double pyramid_build_time = 0;
+double pyramid_skip_ratio = 0;
+
+// Volume file, meshed instead of the random grid while use_volume is set
+// Raw files take their sizes, sample type, byte order and header size from the settings, NRRD files from their header
+MappedVolume volume;
+char volume_path[260] = "";
+int volume_size[3] = { 256, 256, 256 };
+int volume_sample_type = volume_uint8;
+bool volume_big_endian = false;
+int volume_header_bytes = 0;
+bool use_volume = false;
+VolumeExtractionStats volume_stats;
+// Meshes of earlier extractions, found by the hash of the grid or the volume and the settings
+MeshCache mesh_cache;
+bool use_mesh_cache = true;
+float mesh_cache_capacity = 512.0f;
+uint64_t grid_hash = 0;
+uint64_t volume_hash = 0;
+// Misses are written once no widget is held, so dragging a slider only stores the mesh it is released on
+bool mesh_store_pending = false;
+uint64_t pending_cache_key = 0;
+MeshPostPassStats pending_post_pass_stats;
+// Volumes key the cache on the hash of all their samples, read once on its own thread and remembered by the cache
+// under the identity of the file. The cache is skipped for the volume until its hash is ready
+bool volume_hash_ready = false;
+uint64_t volume_identity = 0;
+std::thread volume_hash_thread;
+std::atomic<bool> volume_hash_cancel(false);
+std::atomic<bool> volume_hash_done(false);
+bool volume_hash_complete = false;
+uint64_t volume_hash_result = 0;
+// Out of core extraction of the volume into a mesh file, and the check of the mesh files against the in memory
+// extraction of a small volume
+char mesh_file_path[260] = "volume.mesh";
+OutOfCoreStats out_of_core_stats;
+bool out_of_core_done = false;
+std::string out_of_core_check;
+// Export of the mesh of the current settings, streamed from the extraction of the grid or the volume to the file
+char export_path[260] = "mesh.ply";
+int export_format = mesh_file_ply;
+bool export_done = false;
+double export_time = 0;
+uint64_t export_bytes = 0;
+uint64_t export_triangles = 0;
+std::string export_error;
+
+double elapsed_milliseconds(std::chrono::high_resolution_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
 void generate_marching_cubes_grid() {
-	// Traverse the space with the given resolution storing random values for each point
-	grid.clear();
-	float vertex_delta = cube_size / (resolution - 1);
-	for (int i = 0; i < resolution; i++) {
-		for (int j = 0; j < resolution; j++) {
-			for (int k = 0; k < resolution; k++) {
-				grid.push_back(random());
-			}
+	auto generation_start = std::chrono::high_resolution_clock::now();
+	grid.resize(size_t(resolution) * resolution * resolution);
+	if (grid_field == grid_random) {
+		fill_random_grid(grid_seed, resolution, grid.data());
+	}
+	else {
+		noise_parameters.seed = uint32_t(grid_seed ^ (grid_seed >> 32));
+		fill_noise_grid(noise_parameters, grid_field == grid_terrain ? noise_field_terrain : noise_field_volume, resolution, cube_size, grid.data());
+	}
+	grid_generation_time = elapsed_milliseconds(generation_start);
+	grid_hash = hash_bytes(grid.data(), grid.size() * sizeof(float));
+	auto build_start = std::chrono::high_resolution_clock::now();
+	build_min_max_pyramid(grid.data(), resolution, pyramid);
+	pyramid_build_time = elapsed_milliseconds(build_start);
+}
+// Fraction of the level 0 blocks of a pyramid the extraction skips at a threshold
+double skip_ratio(const MinMaxPyramid& skip_pyramid, float skip_threshold) {
+	if (skip_pyramid.levels.empty()) return 0;
+	double blocks = skip_pyramid.levels[0].blocks;
+	return 1.0 - count_active_blocks(skip_pyramid, skip_threshold) / (blocks * blocks * blocks);
+}
+MarchingCubesParameters get_marching_cubes_parameters() {
+	MarchingCubesParameters parameters;
+	parameters.resolution = resolution;
+	parameters.cube_size = cube_size;
+	parameters.threshold = threshold;
+	parameters.interpolation = interpolation;
+	parameters.indexed = indexed;
+	parameters.gradient_normals = gradient_normals;
+	parameters.engine = extraction_engine;
+	return parameters;
+}
+// Extracts with the engine and the kernel specialized for the current settings, writing the vertex buffer layout directly
+template <typename VertexFormat>
+void extract_marching_cubes_mesh(const MarchingCubesParameters& parameters, const VertexFormat& format, IndexedMesh<typename VertexFormat::VertexType>& output) {
+	if (decimate && parameters.indexed) {
+		if (use_volume) extract_marching_cubes_volume(volume, parameters, MeshVertexFormat(), decimation_mesh, volume_stats);
+		else extract_surface_kernel(grid.data(), parameters, MeshVertexFormat(), decimation_mesh, use_pyramid ? &pyramid : nullptr);
+		decimate_mesh(decimation_mesh, decimation_parameters, decimation_stats);
+		output.vertices.resize(decimation_mesh.vertices.size());
+		for (size_t v = 0; v < decimation_mesh.vertices.size(); v++) {
+			format.write(output.vertices[v], decimation_mesh.vertices[v].position, decimation_mesh.vertices[v].normal);
 		}
+		output.indices = decimation_mesh.indices;
+		return;
+	}
+	if (use_volume) {
+		extract_marching_cubes_volume(volume, parameters, format, output, volume_stats);
+		return;
 	}
+	extract_surface_kernel(grid.data(), parameters, format, output, use_pyramid ? &pyramid : nullptr);
+}
+template <typename VertexType>
+void optimize_mesh_order(IndexedMesh<VertexType>& output) {
+	vertex_cache_before = measure_vertex_cache(output.indices.data(), output.indices.size(), output.vertices.size());
+	auto optimization_start = std::chrono::high_resolution_clock::now();
+	optimize_vertex_cache(output.indices.data(), output.indices.size(), output.vertices.size());
+	optimize_vertex_fetch(output.vertices, output.indices);
+	vertex_order_time = elapsed_milliseconds(optimization_start);
+	vertex_cache_after = measure_vertex_cache(output.indices.data(), output.indices.size(), output.vertices.size());
+}
+// Packed positions are decoded first, full vertices are read in place
+void build_marching_cubes_meshlets() {
+	auto build_start = std::chrono::high_resolution_clock::now();
+	const float* positions = static_cast<const float*>(vertex_buffer_data);
+	size_t position_stride = mesh_stride;
+	if (packed_vertices) {
+		const PackedVertex* packed = static_cast<const PackedVertex*>(vertex_buffer_data);
+		meshlet_positions.resize(vertices_count);
+		for (int v = 0; v < vertices_count; v++) meshlet_positions[v] = decode_packed_vertex(packed[v], cube_size).position;
+		positions = vertices_count ? &meshlet_positions[0].x : nullptr;
+		position_stride = sizeof(Vector3);
+	}
+	build_meshlets(positions, vertices_count, position_stride, vertex_indices_data, indices_count, mesh_meshlets);
+	meshlet_build_time = elapsed_milliseconds(build_start);
+}
+void update_mesh_constants() {
+	MeshConstants constants;
+	constants.color = DirectX::XMFLOAT4(mesh_color[0], mesh_color[1], mesh_color[2], 1);
+	constants.cube_size = DirectX::XMFLOAT4(cube_size, 0, 0, 0);
+	d3d_context->UpdateSubresource(mesh_constants_buffer, 0, nullptr, &constants, 0, 0);
 }
 void generate_marching_cubes_mesh() {
-	mesh.clear();
-	float vertex_delta = cube_size / (resolution - 1);
-	// Traverse again with the marching cubes algorithm
-	for (float i = 0; i < resolution-1; i++) {
-		for (float j = 0; j < resolution-1; j++) {
-			for (float k = 0; k < resolution-1; k++) {
-				// Get configuration index
-				int grid_index = resolution*resolution * i + resolution * j + k;
-				int cube_index = 0;
-				float V0 = grid[grid_index];
-				float V1 = grid[grid_index + 1];
-				float V2 = grid[grid_index + 1 + resolution];
-				float V3 = grid[grid_index + resolution];
-				float V4 = grid[grid_index + resolution * resolution];
-				float V5 = grid[grid_index + resolution * resolution + 1];
-				float V6 = grid[grid_index + resolution * resolution + resolution + 1];
-				float V7 = grid[grid_index + resolution * resolution + resolution];
-				if (V0 < threshold) { cube_index |= 1; }
-				if (V1 < threshold) { cube_index |= 2; }
-				if (V2 < threshold) { cube_index |= 4; }
-				if (V3 < threshold) { cube_index |= 8; }
-				if (V4 < threshold) { cube_index |= 16; }
-				if (V5 < threshold) { cube_index |= 32; }
-				if (V6 < threshold) { cube_index |= 64; }
-				if (V7 < threshold) { cube_index |= 128; }
-				float x = map(k, 0.0f, resolution - 1, -cube_size / 2.0f, cube_size / 2.0f);
-				float y = map(i, 0.0f, resolution - 1, -cube_size / 2.0f, cube_size / 2.0f);
-				float z = map(j, 0.0f, resolution - 1, -cube_size / 2.0f, cube_size / 2.0f);
-				Vector3 P0 = Vector3(x, y, z);
-				Vector3 P1 = Vector3(x + vertex_delta, y, z);
-				Vector3 P2 = Vector3(x + vertex_delta, y, z + vertex_delta);
-				Vector3 P3 = Vector3(x, y, z + vertex_delta);
-				Vector3 P4 = Vector3(x, y + vertex_delta, z);
-				Vector3 P5 = Vector3(x + vertex_delta, y + vertex_delta, z);
-				Vector3 P6 = Vector3(x + vertex_delta, y + vertex_delta, z + vertex_delta);
-				Vector3 P7 = Vector3(x, y + vertex_delta, z + vertex_delta);
-				// Lookup the edge and triangle table with that index
-				Vector3 cube_vertices[12];
-				int edges = edgeTable[cube_index];
-				for (int l = 0; l < 12; l++) {
-					bool is_edge = (edges >> l) & 1;
-					if (is_edge) {
-						switch (l) {
-						case 0: {
-							cube_vertices[l] = !interpolation ? (P0 + P1) / 2.0f : P0 + (threshold - V0) * (P1 - P0) / (V1 - V0);
-							break;
-						}
-						case 1: {
-							cube_vertices[l] = !interpolation ? (P1 + P2) / 2.0f : P1 + (threshold - V1) * (P2 - P1) / (V2 - V1);
-							break;
-						}
-						case 2: {
-							cube_vertices[l] = !interpolation ? (P2 + P3) / 2.0f : P2 + (threshold - V2) * (P3 - P2) / (V3 - V2);
-							break;
-						}
-						case 3: {
-							cube_vertices[l] = !interpolation ? (P3 + P0) / 2.0f : P3 + (threshold - V3) * (P0 - P3) / (V0 - V3);
-							break;
-						}
-						case 4: {
-							cube_vertices[l] = !interpolation ? (P4 + P5) / 2.0f : P4 + (threshold - V4) * (P5 - P4) / (V5 - V4);
-							break;
-						}
-						case 5: {
-							cube_vertices[l] = !interpolation ? (P5 + P6) / 2.0f : P5 + (threshold - V5) * (P6 - P5) / (V6 - V5);
-							break;
-						}
-						case 6: {
-							cube_vertices[l] = !interpolation ? (P6 + P7) / 2.0f : P6 + (threshold - V6) * (P7 - P6) / (V7 - V6);
-							break;
-						}
-						case 7: {
-							cube_vertices[l] = !interpolation ? (P7 + P4) / 2.0f : P7 + (threshold - V7) * (P4 - P7) / (V4 - V7);
-							break;
-						}
-						case 8: {
-							cube_vertices[l] = !interpolation ? (P0 + P4) / 2.0f : P0 + (threshold - V0) * (P4 - P0) / (V4 - V0);
-							break;
-						}
-						case 9: {
-							cube_vertices[l] = !interpolation ? (P1 + P5) / 2.0f : P1 + (threshold - V1) * (P5 - P1) / (V5 - V1);
-							break;
-						}
-						case 10: {
-							cube_vertices[l] = !interpolation ? (P2 + P6) / 2.0f : P2 + (threshold - V2) * (P6 - P2) / (V6 - V2);
-							break;
-						}
-						case 11: {
-							cube_vertices[l] = !interpolation ? (P3 + P7) / 2.0f : P3 + (threshold - V3) * (P7 - P3) / (V7 - V3);
-							break;
-						}
-						default: {
-							break;
-						}
-						}
-					}
-				}
-				// Triangulate calculated vertices
-				// Get the triangle indices from tri table and insert vertices into mesh in that order
-				int m = 0;
-				std::vector<int> tris;
-				while (triTable[cube_index][m] != -1) {
-					int tri1 = triTable[cube_index][m];
-					int tri2 = triTable[cube_index][m+1];
-					int tri3 = triTable[cube_index][m+2];
-					Vertex v1;
-					v1.position.x = cube_vertices[tri1].x;
-					v1.position.y = cube_vertices[tri1].y;
-					v1.position.z = cube_vertices[tri1].z;
-					v1.color = DirectX::XMFLOAT4(mesh_color[0], mesh_color[1], mesh_color[2], 1);
-					Vertex v2;
-					v2.position.x = cube_vertices[tri2].x;
-					v2.position.y = cube_vertices[tri2].y;
-					v2.position.z = cube_vertices[tri2].z;
-					v2.color = DirectX::XMFLOAT4(mesh_color[0], mesh_color[1], mesh_color[2], 1);
-					Vertex v3;
-					v3.position.x = cube_vertices[tri3].x;
-					v3.position.y = cube_vertices[tri3].y;
-					v3.position.z = cube_vertices[tri3].z;
-					v3.color = DirectX::XMFLOAT4(mesh_color[0], mesh_color[1], mesh_color[2], 1);
-					DirectX::XMStoreFloat3(&v1.normal, DirectX::XMVector3Cross(DirectX::XMVectorSet(v2.position.x - v1.position.x,
-						v2.position.y - v1.position.y,
-						v2.position.z - v1.position.z, 0),
-						DirectX::XMVectorSet(v3.position.x - v1.position.x,
-							v3.position.y - v1.position.y,
-							v3.position.z - v1.position.z, 0)));
-					v2.normal = v1.normal;
-					v3.normal = v1.normal;
-					mesh.push_back(v1);
-					mesh.push_back(v2);
-					mesh.push_back(v3);
-					m+=3;
-				}
-			}
-		}
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	auto extraction_start = std::chrono::high_resolution_clock::now();
+	// Packed vertices take the color from the per draw constants, so only full vertices key on it
+	UINT layout_stride = packed_vertices ? sizeof(PackedVertex) : sizeof(Vertex);
+	uint64_t format_hash = packed_vertices ? 0 : hash_bytes(mesh_color, sizeof(mesh_color));
+	MeshPostPasses post_passes;
+	post_passes.decimate = decimate && parameters.indexed;
+	post_passes.decimation = decimation_parameters;
+	post_passes.optimize_vertex_order = optimize_vertex_order && parameters.indexed;
+	uint64_t cache_key = mesh_cache_key(use_volume ? volume_hash : grid_hash, parameters, layout_stride, format_hash, post_passes);
+	bool cache_mesh = use_mesh_cache && (!use_volume || volume_hash_ready);
+	// Hits are copied into the meshes the extraction writes, so they outlive the cache entry like extracted ones
+	MeshPostPassStats cached_stats;
+	bool cached = cache_mesh && (packed_vertices ? load_cached_mesh(mesh_cache, cache_key, packed_mesh, cached_stats) :
+		load_cached_mesh(mesh_cache, cache_key, mesh, cached_stats));
+	if (cached) {
+		decimation_stats = cached_stats.decimation;
+		vertex_cache_before = cached_stats.vertex_cache_before;
+		vertex_cache_after = cached_stats.vertex_cache_after;
+		vertex_order_time = cached_stats.vertex_order_time;
+	}
+	else if (packed_vertices) {
+		PackedVertexFormat format;
+		format.cube_size = cube_size;
+		extract_marching_cubes_mesh(parameters, format, packed_mesh);
+		if (post_passes.optimize_vertex_order) optimize_mesh_order(packed_mesh);
+	}
+	else {
+		D3DVertexFormat format;
+		format.color = DirectX::XMFLOAT4(mesh_color[0], mesh_color[1], mesh_color[2], 1);
+		extract_marching_cubes_mesh(parameters, format, mesh);
+		if (post_passes.optimize_vertex_order) optimize_mesh_order(mesh);
+	}
+	if (packed_vertices) {
+		mesh = IndexedMesh<Vertex>();
+		vertex_buffer_data = packed_mesh.vertices.data();
+		vertices_count = packed_mesh.vertices.size();
+		mesh_stride = sizeof(PackedVertex);
+		vertex_indices_data = packed_mesh.indices.data();
+		indices_count = packed_mesh.indices.size();
+	}
+	else {
+		packed_mesh = IndexedMesh<PackedVertex>();
+		vertex_buffer_data = mesh.vertices.data();
+		vertices_count = mesh.vertices.size();
+		mesh_stride = sizeof(Vertex);
+		vertex_indices_data = mesh.indices.data();
+		indices_count = mesh.indices.size();
 	}
+	extraction_time = elapsed_milliseconds(extraction_start);
+	mesh_store_pending = cache_mesh && !cached;
+	if (mesh_store_pending) {
+		pending_cache_key = cache_key;
+		pending_post_pass_stats.decimation = decimation_stats;
+		pending_post_pass_stats.vertex_cache_before = vertex_cache_before;
+		pending_post_pass_stats.vertex_cache_after = vertex_cache_after;
+		pending_post_pass_stats.vertex_order_time = vertex_order_time;
+	}
+	pyramid_skip_ratio = use_pyramid ? skip_ratio(pyramid, threshold) : 0;
+	if (build_mesh_meshlets && indexed) build_marching_cubes_meshlets();
+	update_mesh_constants();
 
-	vertex_buffer_data = mesh.data();
-	vertices_count = mesh.size();
 	// Create cube vertex buffer
-	vertex_buffer_desc.ByteWidth = vertices_count * sizeof(Vertex);
+	vertex_buffer_desc.ByteWidth = vertices_count * mesh_stride;
 	vertex_buffer_desc.Usage = D3D11_USAGE_IMMUTABLE;
 	vertex_buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vertex_buffer_desc.CPUAccessFlags = 0;
 	vertex_buffer_desc.MiscFlags = 0;
-	vertex_buffer_desc.StructureByteStride = sizeof(Vertex);
+	vertex_buffer_desc.StructureByteStride = mesh_stride;
 	vertex_subresource_data.pSysMem = vertex_buffer_data;
 	// Create hardware vertex buffer
 	if (vertex_buffer) vertex_buffer->Release();
-	d3d_device->CreateBuffer(&vertex_buffer_desc, &vertex_subresource_data, &vertex_buffer);
+	vertex_buffer = nullptr;
+	if (vertices_count > 0) d3d_device->CreateBuffer(&vertex_buffer_desc, &vertex_subresource_data, &vertex_buffer);
+
+	// Create vertex indices buffer description
+	vertex_indices_desc.ByteWidth = indices_count * sizeof(UINT);
+	vertex_indices_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	vertex_indices_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	vertex_indices_desc.CPUAccessFlags = 0;
+	vertex_indices_desc.MiscFlags = 0;
+	vertex_indices_desc.StructureByteStride = sizeof(UINT);
+	vertex_indices_subresource_data.pSysMem = vertex_indices_data;
+	// Create hardware vertex index buffer
+	if (vertex_index_buffer) vertex_index_buffer->Release();
+	vertex_index_buffer = nullptr;
+	if (indices_count > 0) d3d_device->CreateBuffer(&vertex_indices_desc, &vertex_indices_subresource_data, &vertex_index_buffer);
+}
+// Stores the mesh on screen if it missed the cache, the buffers are still the ones it was extracted into
+void store_pending_mesh() {
+	if (!mesh_store_pending) return;
+	mesh_store_pending = false;
+	if (!use_mesh_cache) return;
+	store_cached_mesh(mesh_cache, pending_cache_key, vertex_buffer_data, vertices_count, mesh_stride, vertex_indices_data, indices_count,
+		pending_post_pass_stats);
+}
+// Stops hashing the previous volume, leaving its hash unknown
+void stop_volume_hash() {
+	volume_hash_cancel = true;
+	if (volume_hash_thread.joinable()) volume_hash_thread.join();
+	volume_hash_cancel = false;
+	volume_hash_done = false;
+}
+// Takes the content hash of the loaded volume from the cache, or starts hashing a second mapping of its file
+void start_volume_hash() {
+	stop_volume_hash();
+	volume_hash_ready = false;
+	if (!use_volume) return;
+	volume_identity = volume_file_identity(volume);
+	if (find_volume_hash(mesh_cache, volume_identity, volume_hash)) {
+		volume_hash_ready = true;
+		return;
+	}
+	std::string data_path = volume.data_path;
+	VolumeDescription description = volume.description;
+	volume_hash_thread = std::thread([data_path, description]() {
+		MappedVolume hashed_volume;
+		volume_hash_complete = open_raw_volume(data_path.c_str(), description, hashed_volume) &&
+			volume_content_hash(hashed_volume, volume_hash_result, &volume_hash_cancel);
+		close_volume(hashed_volume);
+		volume_hash_done = true;
+	});
+}
+// Picks up the hash once the thread is done, meshes extracted from then on going through the cache
+void poll_volume_hash() {
+	if (!volume_hash_thread.joinable() || !volume_hash_done) return;
+	volume_hash_thread.join();
+	volume_hash_done = false;
+	if (!volume_hash_complete) return;
+	volume_hash = volume_hash_result;
+	volume_hash_ready = true;
+	store_volume_hash(mesh_cache, volume_identity, volume_hash);
+}
+void load_volume() {
+	VolumeDescription description;
+	description.size_x = volume_size[0];
+	description.size_y = volume_size[1];
+	description.size_z = volume_size[2];
+	description.sample_type = VolumeSampleType(volume_sample_type);
+	description.big_endian = volume_big_endian;
+	description.data_offset = uint64_t(std::max(volume_header_bytes, 0));
+	// The hashing thread maps the file on its own, so it stops before the file is closed or replaced
+	stop_volume_hash();
+	use_volume = open_volume(volume_path, description, volume);
+	start_volume_hash();
+	generate_marching_cubes_mesh();
+}
+void run_out_of_core_extraction() {
+	extract_marching_cubes_out_of_core(volume, get_marching_cubes_parameters(), mesh_file_path, out_of_core_stats);
+	out_of_core_done = true;
+}
+// Exports the mesh on screen, so the file has the engine, normals, decimation and vertex order it was extracted with
+void run_mesh_export() {
+	auto export_start = std::chrono::high_resolution_clock::now();
+	bool packed = mesh_stride == sizeof(PackedVertex);
+	auto vertex_at = [&](uint32_t v) {
+		if (packed) return decode_packed_vertex(packed_mesh.vertices[v], cube_size);
+		const Vertex& vertex = mesh.vertices[v];
+		MeshVertex decoded;
+		decoded.position = Vector3(vertex.position.x, vertex.position.y, vertex.position.z);
+		decoded.normal = Vector3(vertex.normal.x, vertex.normal.y, vertex.normal.z);
+		return decoded;
+	};
+	MeshWriter writer;
+	export_error.clear();
+	write_mesh_file(writer, export_path, MeshFileFormat(export_format), vertices_count, vertex_at, vertex_indices_data, indices_count);
+	export_error = writer.error;
+	export_time = elapsed_milliseconds(export_start);
+	export_bytes = mesh_writer_bytes(writer);
+	export_triangles = writer.triangle_count;
+	export_done = true;
+}
+// Writes a small distance field as a float volume, extracts it out of core and compares the mesh file read back
+// with the in memory extraction of the same grid, which must match exactly
+void run_out_of_core_check() {
+	const int check_resolution = 48;
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = check_resolution;
+	// The streamer keeps the normals of the triangles, so the reference must too
+	parameters.gradient_normals = false;
+	std::vector<float> check_grid(size_t(check_resolution) * check_resolution * check_resolution);
+	float center = (check_resolution - 1) / 2.0f;
+	for (int i = 0; i < check_resolution; i++) {
+		for (int j = 0; j < check_resolution; j++) {
+			for (int k = 0; k < check_resolution; k++) {
+				Vector3 offset = Vector3(float(k), float(i), float(j)) - center;
+				// A wavy sphere so the surface crosses cells in every configuration
+				check_grid[(size_t(check_resolution) * i + j) * check_resolution + k] = sqrtf(dot(offset, offset)) / center + 0.1f * sinf(0.7f * k) * cosf(0.5f * i + 0.3f * j);
+			}
+		}
+	}
+	const char* check_volume_path = "out_of_core_check.raw";
+	const char* check_mesh_path = "out_of_core_check.mesh";
+	std::ofstream check_volume_file(check_volume_path, std::ios::binary | std::ios::trunc);
+	check_volume_file.write(reinterpret_cast<const char*>(check_grid.data()), check_grid.size() * sizeof(float));
+	check_volume_file.close();
+
+	VolumeDescription description;
+	description.size_x = description.size_y = description.size_z = check_resolution;
+	description.sample_type = volume_float32;
+	MappedVolume check_volume;
+	OutOfCoreStats check_stats;
+	MarchingCubesMesh streamed_mesh, reference_mesh;
+	std::string error;
+	if (!open_raw_volume(check_volume_path, description, check_volume)) out_of_core_check = check_volume.error;
+	else if (!extract_marching_cubes_out_of_core(check_volume, parameters, check_mesh_path, check_stats)) out_of_core_check = check_stats.error;
+	else if (!read_mesh_file(check_mesh_path, streamed_mesh, error)) out_of_core_check = error;
+	else {
+		extract_marching_cubes(check_grid, parameters, reference_mesh);
+		bool same_vertices = streamed_mesh.vertices.size() == reference_mesh.vertices.size() &&
+			memcmp(streamed_mesh.vertices.data(), reference_mesh.vertices.data(), reference_mesh.vertices.size() * sizeof(MeshVertex)) == 0;
+		bool same_indices = streamed_mesh.indices == reference_mesh.indices;
+		out_of_core_check = std::string(same_vertices && same_indices ? "Match" : "MISMATCH") + ": " + std::to_string(streamed_mesh.vertices.size()) + " and " +
+			std::to_string(reference_mesh.vertices.size()) + " vertices, " + std::to_string(streamed_mesh.indices.size()) + " and " +
+			std::to_string(reference_mesh.indices.size()) + " indices";
+	}
+	close_volume(check_volume);
+	remove(check_volume_path);
+	remove(check_mesh_path);
+}
+// Benchmarks run on a random benchmark_resolution^3 grid and keep the best of three runs after a warm up
+int benchmark_resolution = 128;
+std::vector<float> generate_benchmark_grid() {
+	std::vector<float> benchmark_grid(size_t(benchmark_resolution) * benchmark_resolution * benchmark_resolution);
+	fill_random_grid(0, benchmark_resolution, benchmark_grid.data());
+	return benchmark_grid;
+}
+// Distance to the center of the grid, so every threshold gives a sphere
+std::vector<float> generate_distance_benchmark_grid() {
+	std::vector<float> benchmark_grid(size_t(benchmark_resolution) * benchmark_resolution * benchmark_resolution);
+	float center = (benchmark_resolution - 1) / 2.0f;
+	for (int i = 0; i < benchmark_resolution; i++) {
+		for (int j = 0; j < benchmark_resolution; j++) {
+			for (int k = 0; k < benchmark_resolution; k++) {
+				Vector3 offset = Vector3(float(k), float(i), float(j)) - center;
+				benchmark_grid[(size_t(benchmark_resolution) * i + j) * benchmark_resolution + k] = sqrtf(dot(offset, offset)) / center;
+			}
+		}
+	}
+	return benchmark_grid;
+}
+double benchmark_extraction(const std::function<void(const std::vector<float>&, const MarchingCubesParameters&, MarchingCubesMesh&)>& extract,
+	const std::vector<float>& benchmark_grid, const MarchingCubesParameters& parameters) {
+	MarchingCubesMesh benchmark_mesh;
+	extract(benchmark_grid, parameters, benchmark_mesh);
+	double best_time = 0;
+	for (int run = 0; run < 3; run++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		extract(benchmark_grid, parameters, benchmark_mesh);
+		double time = elapsed_milliseconds(start);
+		if (run == 0 || time < best_time) best_time = time;
+	}
+	return best_time;
+}
+
+// Scaling benchmark, extraction time for every power of two thread count
+std::vector<std::pair<int, double>> benchmark_results;
+void run_scaling_benchmark() {
+	std::vector<float> benchmark_grid = generate_benchmark_grid();
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	benchmark_results.clear();
+	int max_threads = get_hardware_thread_count();
+	for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+		set_thread_count(threads);
+		benchmark_results.push_back(std::make_pair(threads, benchmark_extraction(extract_marching_cubes, benchmark_grid, parameters)));
+		if (threads == max_threads) break;
+	}
+	set_thread_count(thread_count);
+}
+
+// Kernel benchmark, every specialized kernel against the generic one that checks the settings at runtime
+typedef struct KernelBenchmarkResult {
+	const char* name;
+	double specialized_time;
+	double generic_time;
+} KernelBenchmarkResult;
+std::vector<KernelBenchmarkResult> kernel_benchmark_results;
+void run_kernel_benchmark() {
+	std::vector<float> benchmark_grid = generate_benchmark_grid();
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	const char* names[4] = { "Midpoint, face normals", "Midpoint, smooth normals", "Interpolated, face normals", "Interpolated, smooth normals" };
+	kernel_benchmark_results.clear();
+	for (int variant = 0; variant < 4; variant++) {
+		parameters.interpolation = variant >= 2;
+		parameters.indexed = variant % 2 == 1;
+		KernelBenchmarkResult result;
+		result.name = names[variant];
+		result.specialized_time = benchmark_extraction(extract_marching_cubes, benchmark_grid, parameters);
+		result.generic_time = benchmark_extraction(extract_marching_cubes_generic, benchmark_grid, parameters);
+		kernel_benchmark_results.push_back(result);
+	}
+}
+
+// Pyramid benchmark, extraction of the distance field at several thresholds with and without the min/max pyramid
+typedef struct PyramidBenchmarkResult {
+	float threshold;
+	double full_time;
+	double pyramid_time;
+	double skip_ratio;
+} PyramidBenchmarkResult;
+std::vector<PyramidBenchmarkResult> pyramid_benchmark_results;
+double pyramid_benchmark_build_time = 0;
+size_t pyramid_benchmark_memory = 0;
+void run_pyramid_benchmark() {
+	std::vector<float> benchmark_grid = generate_distance_benchmark_grid();
+	MinMaxPyramid benchmark_pyramid;
+	auto build_start = std::chrono::high_resolution_clock::now();
+	build_min_max_pyramid(benchmark_grid.data(), benchmark_resolution, benchmark_pyramid);
+	pyramid_benchmark_build_time = elapsed_milliseconds(build_start);
+	pyramid_benchmark_memory = min_max_pyramid_memory(benchmark_pyramid);
+
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	pyramid_benchmark_results.clear();
+	for (float benchmark_threshold = 0.1f; benchmark_threshold < 1.0f; benchmark_threshold += 0.2f) {
+		parameters.threshold = benchmark_threshold;
+		PyramidBenchmarkResult result;
+		result.threshold = benchmark_threshold;
+		result.full_time = benchmark_extraction(extract_marching_cubes, benchmark_grid, parameters);
+		result.pyramid_time = benchmark_extraction([&](const std::vector<float>& values, const MarchingCubesParameters& benchmark_parameters, MarchingCubesMesh& benchmark_mesh) {
+			if (benchmark_parameters.interpolation) {
+				if (benchmark_parameters.indexed) generate_marching_cubes_kernel<float, LinearInterpolation, SmoothNormals>(values.data(), benchmark_parameters, MeshVertexFormat(), benchmark_mesh, &benchmark_pyramid);
+				else generate_marching_cubes_kernel<float, LinearInterpolation, FaceNormals>(values.data(), benchmark_parameters, MeshVertexFormat(), benchmark_mesh, &benchmark_pyramid);
+			}
+			else {
+				if (benchmark_parameters.indexed) generate_marching_cubes_kernel<float, MidpointPlacement, SmoothNormals>(values.data(), benchmark_parameters, MeshVertexFormat(), benchmark_mesh, &benchmark_pyramid);
+				else generate_marching_cubes_kernel<float, MidpointPlacement, FaceNormals>(values.data(), benchmark_parameters, MeshVertexFormat(), benchmark_mesh, &benchmark_pyramid);
+			}
+		}, benchmark_grid, parameters);
+		result.skip_ratio = skip_ratio(benchmark_pyramid, benchmark_threshold);
+		pyramid_benchmark_results.push_back(result);
+	}
+}
+
+// Sparse benchmark, the distance field stored in bricks around the current threshold against the dense grid
+typedef struct SparseBenchmarkResult {
+	double build_time;
+	size_t sparse_memory;
+	size_t dense_memory;
+	size_t bricks;
+	size_t nodes;
+	double dense_time;
+	double sparse_time;
+	size_t triangles;
+	size_t sparse_triangles;
+} SparseBenchmarkResult;
+SparseBenchmarkResult sparse_benchmark_result;
+bool sparse_benchmark_done = false;
+float sparse_band = 0.05f;
+void run_sparse_benchmark() {
+	std::vector<float> benchmark_grid = generate_distance_benchmark_grid();
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	SparseField sparse_field;
+	auto build_start = std::chrono::high_resolution_clock::now();
+	build_sparse_field(benchmark_grid.data(), benchmark_resolution, threshold, sparse_band, sparse_field);
+	SparseBenchmarkResult& result = sparse_benchmark_result;
+	result.build_time = elapsed_milliseconds(build_start);
+	result.sparse_memory = sparse_field_memory(sparse_field);
+	result.dense_memory = benchmark_grid.size() * sizeof(float);
+	result.bricks = sparse_field.brick_coordinates.size();
+	result.nodes = sparse_field.nodes.size();
+	MarchingCubesMesh benchmark_mesh;
+	result.dense_time = benchmark_extraction(extract_marching_cubes, benchmark_grid, parameters);
+	extract_marching_cubes(benchmark_grid, parameters, benchmark_mesh);
+	result.triangles = (parameters.indexed ? benchmark_mesh.indices.size() : benchmark_mesh.vertices.size()) / 3;
+	result.sparse_time = benchmark_extraction([&](const std::vector<float>&, const MarchingCubesParameters& benchmark_parameters, MarchingCubesMesh& sparse_mesh) {
+		extract_marching_cubes_sparse(sparse_field, benchmark_parameters, sparse_mesh);
+	}, benchmark_grid, parameters);
+	extract_marching_cubes_sparse(sparse_field, parameters, benchmark_mesh);
+	result.sparse_triangles = (parameters.indexed ? benchmark_mesh.indices.size() : benchmark_mesh.vertices.size()) / 3;
+	sparse_benchmark_done = true;
+}
+
+// Compressed benchmark, the distance field in every compressed mode against the float grid
+// The meshes are checked against the float field, which is sampled at their vertices, so the benchmark interpolates
+typedef struct CompressedBenchmarkResult {
+	const char* name;
+	double build_time;
+	size_t memory;
+	double time;
+	size_t triangles;
+	float max_error;
+	float surface_error;
+} CompressedBenchmarkResult;
+std::vector<CompressedBenchmarkResult> compressed_benchmark_results;
+double compressed_benchmark_dense_time = 0;
+size_t compressed_benchmark_dense_triangles = 0;
+float compressed_benchmark_dense_error = 0;
+// Largest difference between the threshold and the trilinear interpolation of the grid at the vertices of a mesh
+float reference_surface_error(const std::vector<float>& reference_grid, const MarchingCubesParameters& parameters, const MarchingCubesMesh& reference_mesh) {
+	int resolution = parameters.resolution;
+	auto value = [&](int i, int j, int k) { return reference_grid[(size_t(resolution) * i + j) * resolution + k]; };
+	float max_error = 0;
+	for (const MeshVertex& vertex : reference_mesh.vertices) {
+		float x = map(vertex.position.x, -parameters.cube_size / 2.0f, parameters.cube_size / 2.0f, 0.0f, float(resolution - 1));
+		float y = map(vertex.position.y, -parameters.cube_size / 2.0f, parameters.cube_size / 2.0f, 0.0f, float(resolution - 1));
+		float z = map(vertex.position.z, -parameters.cube_size / 2.0f, parameters.cube_size / 2.0f, 0.0f, float(resolution - 1));
+		int k = std::min(std::max(int(x), 0), resolution - 2);
+		int i = std::min(std::max(int(y), 0), resolution - 2);
+		int j = std::min(std::max(int(z), 0), resolution - 2);
+		float u = x - k, v = y - i, w = z - j;
+		float interpolated = 0;
+		for (int corner = 0; corner < 8; corner++) {
+			int di = corner >> 2, dj = (corner >> 1) & 1, dk = corner & 1;
+			interpolated += (di ? v : 1 - v) * (dj ? w : 1 - w) * (dk ? u : 1 - u) * value(i + di, j + dj, k + dk);
+		}
+		max_error = std::max(max_error, fabsf(interpolated - parameters.threshold));
+	}
+	return max_error;
+}
+void run_compressed_benchmark() {
+	std::vector<float> benchmark_grid = generate_distance_benchmark_grid();
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	parameters.interpolation = true;
+	MarchingCubesMesh benchmark_mesh;
+	compressed_benchmark_dense_time = benchmark_extraction(extract_marching_cubes, benchmark_grid, parameters);
+	extract_marching_cubes(benchmark_grid, parameters, benchmark_mesh);
+	compressed_benchmark_dense_triangles = (parameters.indexed ? benchmark_mesh.indices.size() : benchmark_mesh.vertices.size()) / 3;
+	compressed_benchmark_dense_error = reference_surface_error(benchmark_grid, parameters, benchmark_mesh);
+	const char* names[3] = { "8 bit", "12 bit", "Lossless" };
+	compressed_benchmark_results.clear();
+	for (int mode = 0; mode < 3; mode++) {
+		CompressedBenchmarkResult result;
+		result.name = names[mode];
+		CompressedField compressed_field;
+		auto build_start = std::chrono::high_resolution_clock::now();
+		build_compressed_field(benchmark_grid.data(), benchmark_resolution, CompressedFieldMode(mode), compressed_field);
+		result.build_time = elapsed_milliseconds(build_start);
+		result.memory = compressed_field_memory(compressed_field);
+		result.time = benchmark_extraction([&](const std::vector<float>&, const MarchingCubesParameters& benchmark_parameters, MarchingCubesMesh& compressed_mesh) {
+			extract_marching_cubes_compressed(compressed_field, benchmark_parameters, compressed_mesh);
+		}, benchmark_grid, parameters);
+		extract_marching_cubes_compressed(compressed_field, parameters, benchmark_mesh);
+		result.triangles = (parameters.indexed ? benchmark_mesh.indices.size() : benchmark_mesh.vertices.size()) / 3;
+		result.max_error = compressed_field_max_error(compressed_field);
+		result.surface_error = reference_surface_error(benchmark_grid, parameters, benchmark_mesh);
+		compressed_benchmark_results.push_back(result);
+	}
+}
+
+// Noise benchmark, the vectorized rows filling the benchmark grid on all the threads against one sample at a time
+double noise_benchmark_rows_time = 0;
+double noise_benchmark_scalar_time = 0;
+void run_noise_benchmark() {
+	std::vector<float> benchmark_grid(size_t(benchmark_resolution) * benchmark_resolution * benchmark_resolution);
+	NoiseFieldShape shape = grid_field == grid_terrain ? noise_field_terrain : noise_field_volume;
+	auto rows_start = std::chrono::high_resolution_clock::now();
+	fill_noise_grid(noise_parameters, shape, benchmark_resolution, cube_size, benchmark_grid.data());
+	noise_benchmark_rows_time = elapsed_milliseconds(rows_start);
+	auto scalar_start = std::chrono::high_resolution_clock::now();
+	float spacing = cube_size / (benchmark_resolution - 1);
+	for (int i = 0; i < benchmark_resolution; i++) {
+		for (int j = 0; j < benchmark_resolution; j++) {
+			for (int k = 0; k < benchmark_resolution; k++) {
+				Vector3 position(-cube_size / 2.0f + k * spacing, -cube_size / 2.0f + i * spacing, -cube_size / 2.0f + j * spacing);
+				benchmark_grid[(size_t(benchmark_resolution) * i + j) * benchmark_resolution + k] = evaluate_noise(noise_parameters, position);
+			}
+		}
+	}
+	noise_benchmark_scalar_time = elapsed_milliseconds(scalar_start);
+}
+
+// Engine benchmark, every extraction engine on the random grid, the distance field and a tilted box, the box
+// also at a quarter of the resolution to compare how sharp its edges and corners come out
+// Box values grow linearly from its center, at threshold t its half extents are t times the box extents
+const float engine_box_extents[3] = { 0.9f, 0.6f, 0.7f };
+Vector3 engine_box_frame(Vector3 position) {
+	const float yaw = 0.5f, pitch = 0.3f;
+	Vector3 turned(cosf(yaw) * position.x + sinf(yaw) * position.z, position.y, cosf(yaw) * position.z - sinf(yaw) * position.x);
+	return Vector3(turned.x, cosf(pitch) * turned.y - sinf(pitch) * turned.z, sinf(pitch) * turned.y + cosf(pitch) * turned.z);
+}
+float engine_box_value(Vector3 position) {
+	Vector3 local = engine_box_frame(position);
+	return std::max(fabsf(local.x) / engine_box_extents[0], std::max(fabsf(local.y) / engine_box_extents[1], fabsf(local.z) / engine_box_extents[2]));
+}
+std::vector<float> generate_box_benchmark_grid(int box_resolution) {
+	std::vector<float> box_grid(size_t(box_resolution) * box_resolution * box_resolution);
+	for (int i = 0; i < box_resolution; i++) {
+		for (int j = 0; j < box_resolution; j++) {
+			for (int k = 0; k < box_resolution; k++) {
+				Vector3 position(map(float(k), 0.0f, float(box_resolution - 1), -1.0f, 1.0f), map(float(i), 0.0f, float(box_resolution - 1), -1.0f, 1.0f),
+					map(float(j), 0.0f, float(box_resolution - 1), -1.0f, 1.0f));
+				box_grid[(size_t(box_resolution) * i + j) * box_resolution + k] = engine_box_value(position);
+			}
+		}
+	}
+	return box_grid;
+}
+// Largest distance from a corner of the box to the closest vertex of a mesh, in cube units
+float box_corner_error(const MarchingCubesParameters& parameters, const MarchingCubesMesh& box_mesh) {
+	float max_error = 0;
+	for (int corner = 0; corner < 8; corner++) {
+		Vector3 corner_position((corner & 1 ? 1 : -1) * engine_box_extents[0] * parameters.threshold, (corner & 2 ? 1 : -1) * engine_box_extents[1] * parameters.threshold,
+			(corner & 4 ? 1 : -1) * engine_box_extents[2] * parameters.threshold);
+		float closest = 1e30f;
+		for (const MeshVertex& vertex : box_mesh.vertices) {
+			Vector3 offset = engine_box_frame(vertex.position / (parameters.cube_size / 2.0f)) - corner_position;
+			closest = std::min(closest, dot(offset, offset));
+		}
+		max_error = std::max(max_error, sqrtf(closest));
+	}
+	return max_error;
+}
+typedef struct EngineBenchmarkResult {
+	const char* name;
+	const char* field;
+	int resolution;
+	double time;
+	size_t triangles;
+	size_t vertices;
+	float surface_error;
+	// Box fields only, otherwise negative
+	float corner_error;
+} EngineBenchmarkResult;
+std::vector<EngineBenchmarkResult> engine_benchmark_results;
+void run_engine_benchmark() {
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.indexed = true;
+	engine_benchmark_results.clear();
+	const char* field_names[4] = { "Random", "Distance", "Box", "Box" };
+	for (int field = 0; field < 4; field++) {
+		parameters.resolution = field == 3 ? std::max(benchmark_resolution / 4, 2) : benchmark_resolution;
+		std::vector<float> benchmark_grid = field == 0 ? generate_benchmark_grid() : field == 1 ? generate_distance_benchmark_grid() :
+			generate_box_benchmark_grid(parameters.resolution);
+		for (int engine = 0; engine < extraction_engine_count; engine++) {
+			parameters.engine = engine;
+			EngineBenchmarkResult result;
+			result.name = extraction_engine_names[engine];
+			result.field = field_names[field];
+			result.resolution = parameters.resolution;
+			result.time = benchmark_extraction(extract_surface, benchmark_grid, parameters);
+			MarchingCubesMesh benchmark_mesh;
+			extract_surface(benchmark_grid, parameters, benchmark_mesh);
+			result.triangles = benchmark_mesh.indices.size() / 3;
+			result.vertices = benchmark_mesh.vertices.size();
+			result.surface_error = reference_surface_error(benchmark_grid, parameters, benchmark_mesh);
+			result.corner_error = field >= 2 ? box_corner_error(parameters, benchmark_mesh) : -1.0f;
+			engine_benchmark_results.push_back(result);
+		}
+	}
 }
+// Extracts the random and the distance benchmark grids with flying edges and with marching cubes into both outputs,
+// every triangle must have the same vertices, which flying edges only numbers differently
+std::string flying_edges_check;
+void run_flying_edges_check() {
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	size_t triangles = 0;
+	size_t mismatches = 0;
+	for (int field = 0; field < 2; field++) {
+		std::vector<float> check_grid = field == 0 ? generate_benchmark_grid() : generate_distance_benchmark_grid();
+		for (int indexed = 0; indexed < 2; indexed++) {
+			parameters.indexed = indexed != 0;
+			MarchingCubesMesh reference_mesh, flying_mesh;
+			parameters.engine = engine_marching_cubes;
+			extract_surface(check_grid, parameters, reference_mesh);
+			parameters.engine = engine_flying_edges;
+			extract_surface(check_grid, parameters, flying_mesh);
+			size_t corners = parameters.indexed ? reference_mesh.indices.size() : reference_mesh.vertices.size();
+			triangles += corners / 3;
+			if (flying_mesh.vertices.size() != reference_mesh.vertices.size() || flying_mesh.indices.size() != reference_mesh.indices.size()) {
+				mismatches += corners / 3;
+				continue;
+			}
+			for (size_t c = 0; c < corners; c += 3) {
+				bool same = true;
+				for (size_t n = c; n < c + 3; n++) {
+					const MeshVertex& reference = reference_mesh.vertices[parameters.indexed ? reference_mesh.indices[n] : n];
+					const MeshVertex& flying = flying_mesh.vertices[parameters.indexed ? flying_mesh.indices[n] : n];
+					same &= memcmp(&reference, &flying, sizeof(MeshVertex)) == 0;
+				}
+				mismatches += !same;
+			}
+		}
+	}
+	flying_edges_check = std::string(mismatches ? "MISMATCH" : "Match") + ": " + std::to_string(mismatches) + " of " + std::to_string(triangles) + " triangles differ";
+}
+
+// Terrain streaming, a camera path flown over the chunked terrain world with the stats of the run
+ChunkedWorld terrain_world;
+int terrain_chunk_cells = 32;
+int terrain_view_distance = 4;
+float terrain_memory_budget = 256.0f;
+int terrain_path_steps = 200;
+int terrain_lod_levels = 3;
+int terrain_lod_distance = 2;
+bool terrain_decimate = false;
+ChunkStreamingStats terrain_stats;
+void run_terrain_streaming() {
+	terrain_world.parameters.chunk_cells = terrain_chunk_cells;
+	terrain_world.parameters.view_distance = terrain_view_distance;
+	terrain_world.parameters.lod_levels = terrain_lod_levels;
+	terrain_world.parameters.lod_distance = terrain_lod_distance;
+	terrain_world.parameters.memory_budget = size_t(terrain_memory_budget * 1024 * 1024);
+	terrain_world.parameters.threshold = 0;
+	terrain_world.parameters.interpolation = interpolation;
+	terrain_world.parameters.field = terrain_field;
+	terrain_world.parameters.decimate = terrain_decimate;
+	terrain_world.parameters.decimation = decimation_parameters;
+	// Straight flight with a slow sway, a quarter of a chunk per step
+	std::vector<Vector3> path;
+	float step = terrain_world.parameters.chunk_size / 4.0f;
+	for (int s = 0; s < terrain_path_steps; s++) {
+		path.push_back(Vector3(s * step, 2.0f, 4.0f * terrain_world.parameters.chunk_size * sinf(s * 0.05f)));
+	}
+	terrain_stats = run_chunk_streaming_script(terrain_world, path);
+}
+
+// Meshlet culling, the chunks of the terrain around the origin split into meshlets one thread at a time and with
+// all of them, then culled along the terrain streaming flight looking ahead and down
+MeshletCullingStats meshlet_culling_stats;
+size_t meshlet_culling_meshlets = 0;
+double meshlet_serial_build_time = 0;
+double meshlet_parallel_build_time = 0;
+void run_meshlet_culling() {
+	ChunkedWorld chunk_world;
+	chunk_world.parameters.chunk_cells = terrain_chunk_cells;
+	chunk_world.parameters.view_distance = terrain_view_distance;
+	chunk_world.parameters.memory_budget = ~size_t(0);
+	chunk_world.parameters.threshold = 0;
+	chunk_world.parameters.interpolation = interpolation;
+	chunk_world.parameters.field = terrain_field;
+	update_chunked_world(chunk_world, Vector3(0, 2.0f, 0));
+	std::vector<const MarchingCubesMesh*> meshes;
+	for (const auto& entry : chunk_world.chunks) {
+		if (!entry.second.mesh.indices.empty()) meshes.push_back(&entry.second.mesh);
+	}
+	std::vector<MeshletMesh> meshlets;
+	set_thread_count(1);
+	auto build_start = std::chrono::high_resolution_clock::now();
+	build_meshlets(meshes, meshlets);
+	meshlet_serial_build_time = elapsed_milliseconds(build_start);
+	set_thread_count(get_hardware_thread_count());
+	build_start = std::chrono::high_resolution_clock::now();
+	build_meshlets(meshes, meshlets);
+	meshlet_parallel_build_time = elapsed_milliseconds(build_start);
+	set_thread_count(thread_count);
+	meshlet_culling_meshlets = 0;
+	for (const MeshletMesh& mesh_meshlets : meshlets) meshlet_culling_meshlets += mesh_meshlets.meshlets.size();
+
+	float chunk_size = chunk_world.parameters.chunk_size;
+	float extent = terrain_view_distance * chunk_size;
+	std::vector<MeshletCamera> path;
+	for (int s = 0; s < terrain_path_steps; s++) {
+		float t = float(s) / std::max(terrain_path_steps - 1, 1);
+		MeshletCamera camera;
+		camera.position = Vector3(-extent + 2.0f * extent * t, 2.0f, 0.5f * extent * sinf(t * 6.28318f));
+		camera.target = camera.position + Vector3(1.0f, -0.3f, 0.5f * cosf(t * 6.28318f));
+		camera.aspect = float(screen_width) / float(screen_height);
+		path.push_back(camera);
+	}
+	meshlet_culling_stats = run_meshlet_culling_script(meshes, meshlets, path);
+}
+
+// Decimation benchmark, the distance benchmark mesh decimated alone, then the chunks of the terrain around the
+// origin decimated one thread at a time and with all of them, chunk by chunk
+typedef struct DecimationBenchmarkResult {
+	const char* name;
+	int threads;
+	size_t meshes;
+	DecimationStats stats;
+} DecimationBenchmarkResult;
+std::vector<DecimationBenchmarkResult> decimation_benchmark_results;
+void run_decimation_benchmark() {
+	decimation_benchmark_results.clear();
+	MarchingCubesParameters parameters = get_marching_cubes_parameters();
+	parameters.resolution = benchmark_resolution;
+	parameters.indexed = true;
+	MarchingCubesMesh benchmark_mesh;
+	extract_surface(generate_distance_benchmark_grid(), parameters, benchmark_mesh);
+	DecimationBenchmarkResult result;
+	result.name = "Distance";
+	result.threads = 1;
+	result.meshes = 1;
+	decimate_mesh(benchmark_mesh, decimation_parameters, result.stats);
+	decimation_benchmark_results.push_back(result);
+
+	// Chunks at full detail, without transition cells, all of them meshed before decimation starts
+	ChunkedWorld chunk_world;
+	chunk_world.parameters.chunk_cells = terrain_chunk_cells;
+	chunk_world.parameters.view_distance = terrain_view_distance;
+	chunk_world.parameters.memory_budget = ~size_t(0);
+	chunk_world.parameters.threshold = 0;
+	chunk_world.parameters.interpolation = interpolation;
+	chunk_world.parameters.field = terrain_field;
+	update_chunked_world(chunk_world, Vector3(0, 2.0f, 0));
+	std::vector<MarchingCubesMesh> chunk_meshes;
+	for (const auto& entry : chunk_world.chunks) {
+		if (!entry.second.mesh.indices.empty()) chunk_meshes.push_back(entry.second.mesh);
+	}
+	int max_threads = get_hardware_thread_count();
+	for (int threads : { 1, max_threads }) {
+		std::vector<MarchingCubesMesh> decimated_meshes = chunk_meshes;
+		std::vector<MarchingCubesMesh*> meshes;
+		for (MarchingCubesMesh& chunk_mesh : decimated_meshes) meshes.push_back(&chunk_mesh);
+		set_thread_count(threads);
+		result.name = "Terrain chunks";
+		result.threads = threads;
+		result.meshes = meshes.size();
+		decimate_meshes(meshes, decimation_parameters, result.stats);
+		decimation_benchmark_results.push_back(result);
+		if (threads == max_threads) break;
+	}
+	set_thread_count(thread_count);
+}
+
 // Surrounding cube
 Vertex* cube_buffer_data = nullptr;
 D3D11_BUFFER_DESC cube_buffer_desc;
@@ -472,6 +1211,10 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 		return -1;
 	ShowWindow(hwnd, cmdShow);
 
+	// Use every hardware thread for the extraction by default
+	thread_count = get_hardware_thread_count();
+	set_thread_count(thread_count);
+
 	// Initialize Direct3D 11
 	UINT createDeviceFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG)
@@ -596,6 +1339,35 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 	d3d_device->CreatePixelShader(pixel_shader_blob->GetBufferPointer(), pixel_shader_blob->GetBufferSize(), nullptr, &pixel_shader);
 	d3d_context->PSSetShader(pixel_shader, nullptr, 0);
 
+	// Create the packed vertex format description, its input layout and vertex shader
+	D3D11_INPUT_ELEMENT_DESC packed_vertex_desc_buffer[] = {
+		{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0}
+	};
+	ID3D11InputLayout* packed_input_layout;
+	ID3DBlob* packed_vertex_shader_blob;
+	D3DReadFileToBlob(L"PackedVertexShader.cso", &packed_vertex_shader_blob);
+	d3d_device->CreateInputLayout(packed_vertex_desc_buffer,
+		sizeof(packed_vertex_desc_buffer) / sizeof(D3D11_INPUT_ELEMENT_DESC),
+		packed_vertex_shader_blob->GetBufferPointer(),
+		packed_vertex_shader_blob->GetBufferSize(), &packed_input_layout);
+	ID3D11VertexShader* packed_vertex_shader;
+	d3d_device->CreateVertexShader(packed_vertex_shader_blob->GetBufferPointer(),
+		packed_vertex_shader_blob->GetBufferSize(),
+		nullptr,
+		&packed_vertex_shader);
+
+	// Create buffer with the per draw mesh constants
+	D3D11_BUFFER_DESC mesh_constants_desc;
+	mesh_constants_desc.ByteWidth = sizeof(MeshConstants);
+	mesh_constants_desc.Usage = D3D11_USAGE_DEFAULT;
+	mesh_constants_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	mesh_constants_desc.CPUAccessFlags = 0;
+	mesh_constants_desc.MiscFlags = 0;
+	mesh_constants_desc.StructureByteStride = 0;
+	d3d_device->CreateBuffer(&mesh_constants_desc, nullptr, &mesh_constants_buffer);
+	d3d_context->VSSetConstantBuffers(2, 1, &mesh_constants_buffer);
+
 	// Create perspective transform and bind it to the vertex shader
 	DirectX::XMMATRIX persp_transf;
 	persp_transf = DirectX::XMMatrixTranspose(DirectX::XMMatrixLookAtRH(camera_position, camera_lookat_vector, camera_up) * DirectX::XMMatrixPerspectiveFovRH(DirectX::XM_PI / 4.0f,
@@ -698,6 +1470,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 		&cube_vertex_shader);
 
 	//Generate marching cubes mesh
+	open_mesh_cache(mesh_cache, "mesh_cache", uint64_t(mesh_cache_capacity * 1024 * 1024));
 	generate_marching_cubes_grid();
 	generate_marching_cubes_mesh();
 
@@ -722,6 +1495,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 			DispatchMessage(&msg);
 		}
 		// Update
+		poll_volume_hash();
 
 		// Clear render target
 		d3d_context->ClearRenderTargetView(render_target_view, clear_color);
@@ -730,6 +1504,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 
 		// Draw cube
 		// Set vertex and index buffer of cube
+		d3d_context->IASetInputLayout(input_layout);
 		d3d_context->IASetVertexBuffers(0, 1, &cube_buffer, &stride, &offset);
 		d3d_context->IASetIndexBuffer(cube_index_buffer, DXGI_FORMAT_R32_UINT, 0);
 		// Set primitive topology type to line list
@@ -740,15 +1515,18 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 		d3d_context->DrawIndexed(24, 0, 0);
 
 		// Draw mesh if any has been read
-		if (vertex_buffer_data) {
+		if (vertex_buffer) {
 			// Set vertex and index buffer
-			d3d_context->IASetVertexBuffers(0, 1, &vertex_buffer, &stride, &offset);
+			d3d_context->IASetInputLayout(packed_vertices ? packed_input_layout : input_layout);
+			d3d_context->IASetVertexBuffers(0, 1, &vertex_buffer, &mesh_stride, &offset);
+			d3d_context->IASetIndexBuffer(vertex_index_buffer, DXGI_FORMAT_R32_UINT, 0);
 			// Set primitive topology to triangle list
 			d3d_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			// Set vertex shader
-			d3d_context->VSSetShader(vertex_shader, nullptr, 0);
+			d3d_context->VSSetShader(packed_vertices ? packed_vertex_shader : vertex_shader, nullptr, 0);
 			//Draw mesh
-			d3d_context->Draw(vertices_count, 0);
+			if (indices_count > 0) d3d_context->DrawIndexed(indices_count, 0, 0);
+			else d3d_context->Draw(vertices_count, 0);
 		}
 
 		// Start the Dear ImGui frame
@@ -757,6 +1535,28 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 		ImGui::NewFrame();
 		// Render imgui widgets
 		if (ImGui::Begin("Marching Cubes Parameters", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize)) {
+			if (ImGui::Combo("Field", &grid_field, "Random\0Noise\0Terrain\0")) {
+				generate_marching_cubes_grid();
+				generate_marching_cubes_mesh();
+			}
+			if (grid_field != grid_random) {
+				int basis = noise_parameters.basis;
+				int fractal = noise_parameters.fractal;
+				bool noise_changed = ImGui::Combo("Noise", &basis, "Gradient\0Simplex\0");
+				noise_changed |= ImGui::Combo("Fractal", &fractal, "Single\0FBM\0Ridged\0");
+				noise_parameters.basis = NoiseBasis(basis);
+				noise_parameters.fractal = NoiseFractal(fractal);
+				noise_changed |= ImGui::DragFloat("Frequency", &noise_parameters.frequency, 0.01f, 0.01f, 64.0f);
+				noise_changed |= ImGui::DragInt("Octaves", &noise_parameters.octaves, 0.1f, 1, 12);
+				noise_changed |= ImGui::DragFloat("Lacunarity", &noise_parameters.lacunarity, 0.01f, 1.0f, 4.0f);
+				noise_changed |= ImGui::DragFloat("Gain", &noise_parameters.gain, 0.01f, 0.0f, 1.0f);
+				if (noise_parameters.fractal == noise_ridged) noise_changed |= ImGui::DragFloat("Ridge Offset", &noise_parameters.ridge_offset, 0.01f, 0.0f, 2.0f);
+				noise_changed |= ImGui::DragFloat("Warp", &noise_parameters.warp_amplitude, 0.01f, 0.0f, 4.0f);
+				if (noise_changed) {
+					generate_marching_cubes_grid();
+					generate_marching_cubes_mesh();
+				}
+			}
 			if (ImGui::DragInt("Resolution", &resolution, 1.0f, 2.0f, 50.0f)) {
 				generate_marching_cubes_grid();
 				generate_marching_cubes_mesh();
@@ -769,20 +1569,254 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 				generate_marching_cubes_mesh();
 				generate_cube();
 			}
+			if (ImGui::Combo("Engine", &extraction_engine, extraction_engine_names, extraction_engine_count)) {
+				generate_marching_cubes_mesh();
+			}
 			if (ImGui::Checkbox("Interpolation", &interpolation)) {
 				generate_marching_cubes_mesh();
 			}
+			if (ImGui::Checkbox("Indexed", &indexed)) {
+				generate_marching_cubes_mesh();
+			}
+			if (ImGui::Checkbox("Gradient Normals", &gradient_normals)) {
+				generate_marching_cubes_mesh();
+			}
+			if (ImGui::Checkbox("Packed Vertices", &packed_vertices)) {
+				generate_marching_cubes_mesh();
+			}
+			if (ImGui::Checkbox("Min/Max Pyramid", &use_pyramid)) {
+				generate_marching_cubes_mesh();
+			}
+			// Decimation only applies to indexed meshes, triangle soups have no shared vertices to collapse
+			if (ImGui::Checkbox("Decimate", &decimate)) {
+				generate_marching_cubes_mesh();
+			}
+			if (ImGui::DragFloat("Decimation Ratio", &decimation_parameters.target_ratio, 0.005f, 0.0f, 1.0f)) {
+				if (decimate) generate_marching_cubes_mesh();
+			}
+			if (ImGui::DragFloat("Decimation Error", &decimation_parameters.max_error, 0.001f, 0.0f, 1e30f, "%g")) {
+				if (decimate) generate_marching_cubes_mesh();
+			}
+			if (decimate && indexed) {
+				ImGui::Text("Decimated %zu to %zu triangles in %.3f ms", decimation_stats.input_triangles, decimation_stats.output_triangles, decimation_stats.time);
+			}
+			if (ImGui::Checkbox("Optimize Vertex Order", &optimize_vertex_order)) {
+				generate_marching_cubes_mesh();
+			}
+			if (ImGui::Checkbox("Build Meshlets", &build_mesh_meshlets)) {
+				generate_marching_cubes_mesh();
+			}
+			if (build_mesh_meshlets && indexed) {
+				ImGui::Text("%zu meshlets in %.3f ms", mesh_meshlets.meshlets.size(), meshlet_build_time);
+			}
+			if (optimize_vertex_order && indexed) {
+				ImGui::Text("ACMR %.3f to %.3f, ATVR %.3f to %.3f in %.3f ms", vertex_cache_before.acmr, vertex_cache_after.acmr, vertex_cache_before.atvr,
+					vertex_cache_after.atvr, vertex_order_time);
+			}
 			if (ImGui::ColorPicker3("Mesh Color", mesh_color, ImGuiColorEditFlags_NoAlpha)) {
+				// Packed vertices take the color from the per draw constants, there is nothing to extract again
+				if (packed_vertices) update_mesh_constants();
+				else generate_marching_cubes_mesh();
+			}
+			if (ImGui::InputScalar("Seed", ImGuiDataType_U64, &grid_seed)) {
+				generate_marching_cubes_grid();
 				generate_marching_cubes_mesh();
 			}
+			// Moves on to the next seed, a new grid that can be found again from its seed
 			if (ImGui::Button("Generate")) {
+				grid_seed++;
 				generate_marching_cubes_grid();
 				generate_marching_cubes_mesh();
 			}
+			if (ImGui::Checkbox("Mesh Cache", &use_mesh_cache)) {
+				generate_marching_cubes_mesh();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Clear Cache")) {
+				clear_mesh_cache(mesh_cache);
+			}
+			if (ImGui::DragFloat("Cache Size (MB)", &mesh_cache_capacity, 1.0f, 1.0f, 65536.0f)) {
+				set_mesh_cache_capacity(mesh_cache, uint64_t(mesh_cache_capacity * 1024 * 1024));
+			}
+			ImGui::Text("Cache: %llu hits, %llu misses, %llu evicted, %zu entries in %.2f MB", (unsigned long long)mesh_cache.hits, (unsigned long long)mesh_cache.misses,
+				(unsigned long long)mesh_cache.evictions, mesh_cache.entries.size(), mesh_cache.size / (1024.0 * 1024.0));
+			ImGui::Separator();
+			ImGui::InputText("Volume File", volume_path, sizeof(volume_path));
+			ImGui::InputInt3("Volume Size", volume_size);
+			ImGui::Combo("Sample Type", &volume_sample_type, "uint8\0uint16\0float32\0");
+			ImGui::Checkbox("Big Endian", &volume_big_endian);
+			ImGui::InputInt("Header Bytes", &volume_header_bytes);
+			if (ImGui::Button("Load Volume")) {
+				load_volume();
+			}
+			ImGui::SameLine();
+			if (ImGui::Checkbox("Use Volume", &use_volume)) {
+				use_volume = use_volume && volume.file != -1;
+				generate_marching_cubes_mesh();
+			}
+			if (!volume.error.empty()) {
+				ImGui::Text("%s", volume.error.c_str());
+			}
+			if (use_volume) {
+				const VolumeDescription& description = volume.description;
+				ImGui::Text("Volume %d x %d x %d, %.3f ms, %.1f MB/s", description.size_x, description.size_y, description.size_z, volume_stats.time,
+					volume_stats.bytes_read / (1024.0 * 1024.0) / (volume_stats.time / 1000.0));
+				ImGui::Text("Mapped %.1f KB, buffers %.1f KB, %zu triangles", volume_stats.peak_mapped / 1024.0, volume_stats.peak_buffers / 1024.0, volume_stats.triangles);
+				if (!volume_hash_ready) ImGui::Text("Hashing volume, cache off until done");
+			}
+			ImGui::InputText("Mesh File", mesh_file_path, sizeof(mesh_file_path));
+			if (ImGui::Button("Extract Out of Core") && volume.file != -1) {
+				run_out_of_core_extraction();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Check Out of Core")) {
+				run_out_of_core_check();
+			}
+			if (out_of_core_done) {
+				const OutOfCoreStats& stats = out_of_core_stats;
+				double seconds = stats.extraction.time / 1000.0;
+				if (!stats.error.empty()) ImGui::Text("%s", stats.error.c_str());
+				ImGui::Text("Out of core: %.3f ms, read %.1f MB/s, wrote %.2f MB at %.1f MB/s", stats.extraction.time,
+					stats.extraction.bytes_read / (1024.0 * 1024.0) / seconds, stats.bytes_written / (1024.0 * 1024.0), stats.bytes_written / (1024.0 * 1024.0) / seconds);
+				ImGui::Text("    %llu vertices, %zu triangles, peak memory %.1f KB", (unsigned long long)stats.vertices, stats.extraction.triangles, stats.peak_memory / 1024.0);
+			}
+			if (!out_of_core_check.empty()) {
+				ImGui::Text("%s", out_of_core_check.c_str());
+			}
+			ImGui::Separator();
+			ImGui::InputText("Export File", export_path, sizeof(export_path));
+			ImGui::Combo("Export Format", &export_format, "PLY\0STL\0OBJ\0");
+			if (ImGui::Button("Export Current Mesh")) {
+				run_mesh_export();
+			}
+			if (export_done) {
+				if (!export_error.empty()) ImGui::Text("%s", export_error.c_str());
+				ImGui::Text("Exported %llu triangles, %.2f MB in %.3f ms (%.1f MB/s)", (unsigned long long)export_triangles, export_bytes / (1024.0 * 1024.0), export_time,
+					export_bytes / (1024.0 * 1024.0) / (export_time / 1000.0));
+			}
+			ImGui::Separator();
+			if (ImGui::DragInt("Threads", &thread_count, 0.1f, 1, get_hardware_thread_count())) {
+				set_thread_count(thread_count);
+				generate_marching_cubes_mesh();
+			}
+			ImGui::Text("Grid: %.3f ms, extraction: %.3f ms", grid_generation_time, extraction_time);
+			ImGui::Text("Vertex buffer: %.2f MB, %u bytes per vertex", vertices_count * double(mesh_stride) / (1024 * 1024), mesh_stride);
+			ImGui::Text("Pyramid: built in %.3f ms, %.1f KB, %.1f%% of the blocks skipped", pyramid_build_time, min_max_pyramid_memory(pyramid) / 1024.0, pyramid_skip_ratio * 100);
+			ImGui::DragInt("Benchmark Resolution", &benchmark_resolution, 1.0f, 2, 512);
+			if (ImGui::Button("Benchmark")) {
+				run_scaling_benchmark();
+			}
+			for (const std::pair<int, double>& result : benchmark_results) {
+				ImGui::Text("%d threads: %.3f ms (%.2fx)", result.first, result.second, benchmark_results[0].second / result.second);
+			}
+			if (ImGui::Button("Kernel Benchmark")) {
+				run_kernel_benchmark();
+			}
+			for (const KernelBenchmarkResult& result : kernel_benchmark_results) {
+				ImGui::Text("%s: %.3f ms, generic %.3f ms (%.2fx)", result.name, result.specialized_time, result.generic_time, result.generic_time / result.specialized_time);
+			}
+			if (ImGui::Button("Engine Benchmark")) {
+				run_engine_benchmark();
+			}
+			for (const EngineBenchmarkResult& result : engine_benchmark_results) {
+				ImGui::Text("%s %d^3, %s: %.3f ms, %zu triangles, %zu vertices, surface error %g", result.field, result.resolution, result.name, result.time,
+					result.triangles, result.vertices, result.surface_error);
+				if (result.corner_error >= 0) ImGui::Text("    corner error %g", result.corner_error);
+			}
+			if (ImGui::Button("Check Flying Edges")) {
+				run_flying_edges_check();
+			}
+			if (!flying_edges_check.empty()) {
+				ImGui::Text("%s", flying_edges_check.c_str());
+			}
+			if (ImGui::Button("Decimation Benchmark")) {
+				run_decimation_benchmark();
+			}
+			for (const DecimationBenchmarkResult& result : decimation_benchmark_results) {
+				const DecimationStats& stats = result.stats;
+				ImGui::Text("%s, %zu meshes, %d threads: %zu to %zu triangles in %.3f ms, %.0f triangles removed/s", result.name, result.meshes, result.threads,
+					stats.input_triangles, stats.output_triangles, stats.time, (stats.input_triangles - stats.output_triangles) / (stats.time / 1000.0));
+			}
+			if (ImGui::Button("Pyramid Benchmark")) {
+				run_pyramid_benchmark();
+			}
+			if (!pyramid_benchmark_results.empty()) {
+				ImGui::Text("Pyramid built in %.3f ms, %.1f KB (%.3f%% of the grid)", pyramid_benchmark_build_time, pyramid_benchmark_memory / 1024.0,
+					100.0 * pyramid_benchmark_memory / (double(benchmark_resolution) * benchmark_resolution * benchmark_resolution * sizeof(float)));
+			}
+			for (const PyramidBenchmarkResult& result : pyramid_benchmark_results) {
+				ImGui::Text("Threshold %.1f: %.3f ms, with pyramid %.3f ms (%.2fx), %.1f%% skipped", result.threshold, result.full_time, result.pyramid_time,
+					result.full_time / result.pyramid_time, result.skip_ratio * 100);
+			}
+			ImGui::DragFloat("Sparse Band", &sparse_band, 0.001f, 0.0f, 1.0f);
+			if (ImGui::Button("Sparse Benchmark")) {
+				run_sparse_benchmark();
+			}
+			if (sparse_benchmark_done) {
+				const SparseBenchmarkResult& result = sparse_benchmark_result;
+				ImGui::Text("Sparse built in %.3f ms, %zu bricks in %zu nodes", result.build_time, result.bricks, result.nodes);
+				ImGui::Text("Sparse %.2f MB, dense %.2f MB (%.2f%%)", result.sparse_memory / (1024.0 * 1024.0), result.dense_memory / (1024.0 * 1024.0),
+					100.0 * result.sparse_memory / result.dense_memory);
+				ImGui::Text("Dense %.3f ms, sparse %.3f ms, %zu and %zu triangles", result.dense_time, result.sparse_time, result.triangles, result.sparse_triangles);
+			}
+			if (ImGui::Button("Noise Benchmark")) {
+				run_noise_benchmark();
+			}
+			if (noise_benchmark_rows_time > 0) {
+				ImGui::Text("Noise rows %.3f ms, one sample at a time %.3f ms (%.2fx)", noise_benchmark_rows_time, noise_benchmark_scalar_time,
+					noise_benchmark_scalar_time / noise_benchmark_rows_time);
+			}
+			if (ImGui::Button("Compressed Benchmark")) {
+				run_compressed_benchmark();
+			}
+			if (!compressed_benchmark_results.empty()) {
+				ImGui::Text("Float: %.3f ms, %zu triangles, surface error %g", compressed_benchmark_dense_time, compressed_benchmark_dense_triangles, compressed_benchmark_dense_error);
+			}
+			for (const CompressedBenchmarkResult& result : compressed_benchmark_results) {
+				double dense_memory = double(benchmark_resolution) * benchmark_resolution * benchmark_resolution * sizeof(float);
+				ImGui::Text("%s: %.2f MB (%.2fx smaller), built in %.3f ms", result.name, result.memory / (1024.0 * 1024.0), dense_memory / result.memory, result.build_time);
+				ImGui::Text("    %.3f ms (%.2fx), %zu triangles, point error %g, surface error %g", result.time, result.time / compressed_benchmark_dense_time, result.triangles,
+					result.max_error, result.surface_error);
+			}
+			ImGui::Separator();
+			ImGui::DragInt("Chunk Cells", &terrain_chunk_cells, 1.0f, 4, 128);
+			ImGui::DragInt("View Distance", &terrain_view_distance, 0.1f, 1, 16);
+			ImGui::DragFloat("Memory Budget (MB)", &terrain_memory_budget, 1.0f, 1.0f, 8192.0f);
+			ImGui::DragInt("Path Steps", &terrain_path_steps, 1.0f, 1, 10000);
+			ImGui::DragInt("LOD Levels", &terrain_lod_levels, 0.05f, 1, max_chunk_lods);
+			ImGui::DragInt("LOD Distance", &terrain_lod_distance, 0.05f, 1, 16);
+			ImGui::Checkbox("Decimate Chunks", &terrain_decimate);
+			if (ImGui::Button("Stream Terrain")) {
+				run_terrain_streaming();
+			}
+			if (terrain_stats.updates > 0) {
+				ImGui::Text("%zu chunks generated, %zu hits, %zu evicted", terrain_stats.generated, terrain_stats.hits, terrain_stats.evicted);
+				ImGui::Text("%zu chunks resident, %zu triangles, %.1f MB (peak %.1f MB)", terrain_stats.resident, terrain_stats.triangles,
+					terrain_stats.memory / (1024.0 * 1024.0), terrain_stats.peak_memory / (1024.0 * 1024.0));
+				ImGui::Text("%zu transition triangles, %zu chunks remeshed for LOD changes", terrain_stats.transition_triangles, terrain_stats.remeshed);
+				if (terrain_stats.decimated_triangles) ImGui::Text("%zu triangles removed by decimation", terrain_stats.decimated_triangles);
+				for (int lod = 0; lod < terrain_lod_levels && lod < max_chunk_lods; lod++) {
+					ImGui::Text("    LOD %d: %zu chunks", lod, terrain_stats.lod_chunks[lod]);
+				}
+				ImGui::Text("Update: %.3f ms average, %.3f ms max", terrain_stats.total_update_time / terrain_stats.updates, terrain_stats.max_update_time);
+			}
+			if (ImGui::Button("Meshlet Culling")) {
+				run_meshlet_culling();
+			}
+			if (meshlet_culling_stats.frames > 0) {
+				const MeshletCullingStats& stats = meshlet_culling_stats;
+				ImGui::Text("%zu meshlets built in %.3f ms, %.3f ms with %d threads", meshlet_culling_meshlets, meshlet_serial_build_time, meshlet_parallel_build_time,
+					get_hardware_thread_count());
+				ImGui::Text("%.1f%% of the meshlets culled, %.1f%% outside the view and %.1f%% facing away, %.3f ms per frame", 100.0 * (stats.frustum_culled + stats.backface_culled) / stats.meshlets,
+					100.0 * stats.frustum_culled / stats.meshlets, 100.0 * stats.backface_culled / stats.meshlets, stats.culling_time / stats.frames);
+				ImGui::Text("%.1f%% of the triangles culled, %.1f%% of the invisible ones, %zu visible triangles culled", 100.0 * stats.culled_triangles / stats.triangles,
+					100.0 * stats.culled_triangles / std::max(stats.invisible_triangles, size_t(1)), stats.wrongly_culled);
+			}
 			ImGui::End();
 		}
 		
 		ImGui::Render();
+		if (!ImGui::IsAnyItemActive()) store_pending_mesh();
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 
 		// Trigger a back buffer swap in the swap chain
@@ -790,6 +1824,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
 	}
 
 	// Cleanup
+	stop_volume_hash();
 	// ImGui cleanup
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
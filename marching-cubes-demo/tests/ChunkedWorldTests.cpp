@@ -0,0 +1,52 @@
+#include "Tests.h"
+
+#include "ChunkedWorld.h"
+
+// A scripted flight over the terrain with a small budget, checking the world fits the budget after every update
+// but for the chunks in view, the peak counts the chunks held before eviction, and the resident chunks at the end
+// are meshed like in a world loaded at the last focus from scratch
+void test_chunk_streaming() {
+	ChunkedWorldParameters parameters;
+	parameters.chunk_cells = 16;
+	parameters.chunk_size = 8.0f;
+	parameters.view_distance = 3;
+	parameters.lod_levels = 3;
+	parameters.lod_distance = 1;
+	parameters.memory_budget = size_t(1) << 20;
+	parameters.field = terrain_field;
+	std::vector<Vector3> path;
+	for (int s = 0; s < 40; s++) path.push_back(Vector3(-80.0f + 4.0f * s, 2.0f, 12.0f * sinf(s * 0.2f)));
+
+	ChunkedWorld world;
+	world.parameters = parameters;
+	size_t largest_memory = 0;
+	for (Vector3 focus : path) {
+		size_t peak_before = world.stats.peak_memory;
+		update_chunked_world(world, focus);
+		bool all_in_view = true;
+		for (const auto& entry : world.chunks) all_in_view &= entry.second.last_used == world.current_update;
+		CHECK(world.stats.memory <= parameters.memory_budget || all_in_view);
+		CHECK(world.stats.peak_memory >= world.stats.memory && world.stats.peak_memory >= peak_before);
+		largest_memory = std::max(largest_memory, world.stats.memory);
+	}
+	CHECK(world.stats.evicted > 0 && world.stats.remeshed > 0);
+	CHECK(world.stats.peak_memory > largest_memory);
+
+	ChunkedWorld fresh_world;
+	fresh_world.parameters = parameters;
+	fresh_world.parameters.memory_budget = ~size_t(0);
+	update_chunked_world(fresh_world, path.back());
+	size_t compared = 0;
+	for (const auto& entry : fresh_world.chunks) {
+		auto streamed = world.chunks.find(entry.first);
+		CHECK(streamed != world.chunks.end());
+		if (streamed == world.chunks.end()) continue;
+		CHECK(streamed->second.lod == entry.second.lod && streamed->second.transition_faces == entry.second.transition_faces);
+		CHECK(same_mesh(streamed->second.mesh, entry.second.mesh));
+		compared += !entry.second.mesh.indices.empty();
+	}
+	CHECK(compared > 0);
+
+	ChunkStreamingStats stats = run_chunk_streaming_script(world, path);
+	CHECK(stats.updates == path.size() && stats.peak_memory == world.stats.peak_memory);
+}
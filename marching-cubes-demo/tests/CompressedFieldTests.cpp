@@ -0,0 +1,29 @@
+#include "Tests.h"
+
+#include "CompressedField.h"
+
+// Every mode gives the triangles of the dense extraction of its decoded grid at the resolution it was built with,
+// and an empty mesh at any other resolution
+void test_compressed_field_resolution() {
+	const int resolution = 45;
+	std::vector<float> grid = sphere_test_grid(resolution);
+	MarchingCubesParameters parameters = test_parameters(resolution);
+	for (int mode = compressed_quantized_8; mode <= compressed_lossless; mode++) {
+		CompressedField field;
+		build_compressed_field(grid.data(), resolution, CompressedFieldMode(mode), field);
+		std::vector<float> decoded;
+		decompress_field(field, decoded);
+		MarchingCubesMesh dense_mesh, compressed_mesh;
+		extract_marching_cubes(decoded, parameters, dense_mesh);
+		extract_marching_cubes_compressed(field, parameters, compressed_mesh);
+		CHECK(!compressed_mesh.indices.empty());
+		CHECK(sorted_triangles(dense_mesh) == sorted_triangles(compressed_mesh));
+
+		for (int other_resolution : { resolution - 1, resolution - 16, resolution + 1 }) {
+			MarchingCubesParameters other_parameters = parameters;
+			other_parameters.resolution = other_resolution;
+			extract_marching_cubes_compressed(field, other_parameters, compressed_mesh);
+			CHECK(compressed_mesh.vertices.empty() && compressed_mesh.indices.empty());
+		}
+	}
+}
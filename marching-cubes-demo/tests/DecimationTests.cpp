@@ -0,0 +1,66 @@
+#include "Tests.h"
+
+#include "Decimation.h"
+
+#include <set>
+#include <map>
+#include <utility>
+
+// Decimation meets its triangle target, leaves every vertex of an open edge where it was when borders are preserved
+// and never turns a triangle to face inwards, on a closed surface and on one cut open by the faces of the grid
+void test_decimation() {
+	const int resolution = 40;
+	std::vector<float> grid = sphere_test_grid(resolution);
+	for (float threshold : { 0.5f, 0.85f }) {
+		MarchingCubesParameters parameters = test_parameters(resolution);
+		parameters.threshold = threshold;
+		MarchingCubesMesh mesh;
+		extract_marching_cubes(grid, parameters, mesh);
+		size_t input_triangles = mesh.indices.size() / 3;
+
+		// Vertices of the edges used by a single triangle
+		std::map<std::pair<uint32_t, uint32_t>, int> edge_uses;
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = mesh.indices[t + corner], b = mesh.indices[t + (corner + 1) % 3];
+				edge_uses[std::make_pair(std::min(a, b), std::max(a, b))]++;
+			}
+		}
+		std::vector<Vector3> border_positions;
+		for (const auto& edge : edge_uses) {
+			if (edge.second != 1) continue;
+			border_positions.push_back(mesh.vertices[edge.first.first].position);
+			border_positions.push_back(mesh.vertices[edge.first.second].position);
+		}
+		CHECK(threshold < 0.8f ? border_positions.empty() : !border_positions.empty());
+
+		// Triangles face away from the center of the grid, where the field is smallest
+		auto outward_triangles = [](const MarchingCubesMesh& faces) {
+			size_t outward = 0;
+			for (size_t t = 0; t + 2 < faces.indices.size(); t += 3) {
+				Vector3 p0 = faces.vertices[faces.indices[t]].position;
+				Vector3 p1 = faces.vertices[faces.indices[t + 1]].position;
+				Vector3 p2 = faces.vertices[faces.indices[t + 2]].position;
+				Vector3 centroid = (p0 + p1 + p2) / 3.0f;
+				outward += dot(cross(p1 - p0, p2 - p0), centroid) > 0;
+			}
+			return outward;
+		};
+		bool outward = outward_triangles(mesh) == input_triangles;
+		CHECK(outward || outward_triangles(mesh) == 0);
+
+		DecimationParameters decimation;
+		decimation.target_triangles = input_triangles / 5;
+		decimation.preserve_borders = true;
+		DecimationStats stats;
+		decimate_mesh(mesh, decimation, stats);
+		size_t output_triangles = mesh.indices.size() / 3;
+		CHECK(stats.input_triangles == input_triangles && stats.output_triangles == output_triangles);
+		CHECK(output_triangles <= decimation.target_triangles && output_triangles > 0);
+		CHECK(outward_triangles(mesh) == (outward ? output_triangles : 0));
+
+		std::set<std::array<float, 3>> positions;
+		for (const MeshVertex& vertex : mesh.vertices) positions.insert({ vertex.position.x, vertex.position.y, vertex.position.z });
+		for (Vector3 position : border_positions) CHECK(positions.count({ position.x, position.y, position.z }) == 1);
+	}
+}
@@ -0,0 +1,60 @@
+#include "Tests.h"
+
+#include "DualContouring.h"
+
+// A full batch, solved 8 cells at a time with AVX, gives the minimizers of the same cells solved one at a time by
+// the scalar code, for quadrics constrained in three, two and one directions and with axis aligned normals
+void test_qef_lanes() {
+	QefBatch batch;
+	uint32_t state = 12345;
+	auto random = [&]() {
+		state = state * 747796405u + 2891336453u;
+		return ((state >> 8) & 0xffff) / 65536.0f;
+	};
+	for (int cell = 0; cell < qef_batch_size; cell++) {
+		float ata[6] = {}, atb[3] = {}, mass[3] = {};
+		int crossings = 2 + cell % 5;
+		Vector3 first_normal;
+		for (int c = 0; c < crossings; c++) {
+			Vector3 point(random(), random(), random());
+			Vector3 normal;
+			if (cell % 4 == 1) normal = c == 0 || c == 2 ? Vector3(1, 0, 0) : c == 1 ? Vector3(0, 1, 0) : Vector3(0, 0, 1);
+			else normal = normalize(Vector3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+			// Parallel planes leave two directions unconstrained
+			if (cell % 4 == 2) normal = c == 0 ? normal : first_normal;
+			if (c == 0) first_normal = normal;
+			float offset = dot(normal, point);
+			ata[0] += normal.x * normal.x;
+			ata[1] += normal.x * normal.y;
+			ata[2] += normal.x * normal.z;
+			ata[3] += normal.y * normal.y;
+			ata[4] += normal.y * normal.z;
+			ata[5] += normal.z * normal.z;
+			atb[0] += normal.x * offset;
+			atb[1] += normal.y * offset;
+			atb[2] += normal.z * offset;
+			mass[0] += point.x / crossings;
+			mass[1] += point.y / crossings;
+			mass[2] += point.z / crossings;
+		}
+		for (int e = 0; e < 6; e++) batch.ata[e][cell] = ata[e];
+		for (int e = 0; e < 3; e++) {
+			batch.atb[e][cell] = atb[e];
+			batch.mass[e][cell] = mass[e];
+		}
+	}
+	batch.count = qef_batch_size;
+	solve_qef_batch(batch);
+
+	for (int cell = 0; cell < qef_batch_size; cell++) {
+		QefBatch single;
+		single.count = 1;
+		for (int e = 0; e < 6; e++) single.ata[e][0] = batch.ata[e][cell];
+		for (int e = 0; e < 3; e++) {
+			single.atb[e][0] = batch.atb[e][cell];
+			single.mass[e][0] = batch.mass[e][cell];
+		}
+		solve_qef_batch(single);
+		for (int e = 0; e < 3; e++) CHECK(fabsf(single.solutions[e][0] - batch.solutions[e][cell]) < 1e-5f);
+	}
+}
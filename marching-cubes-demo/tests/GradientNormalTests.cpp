@@ -0,0 +1,38 @@
+#include "Tests.h"
+
+#include "GradientNormals.h"
+
+// The float batches, 8 lanes at a time with AVX2, give the normals of the scalar code for every edge of every layer,
+// the faces of the grid and the crossings left over after the last full group of 8 included
+void test_gradient_normal_lanes() {
+	const int resolution = 13;
+	std::vector<float> grid = random_test_grid(resolution, 7);
+	std::vector<Vector3> normals;
+	std::vector<Vector3> expected;
+	GradientBatch batch;
+	for (int i = 0; i < resolution; i++) {
+		normals.clear();
+		expected.clear();
+		for (int j = 0; j < resolution; j++) {
+			for (int k = 0; k < resolution; k++) {
+				for (int axis = 0; axis < 3; axis++) {
+					if ((axis == 0 && k == resolution - 1) || (axis == 1 && j == resolution - 1) || (axis == 2 && i == resolution - 1)) continue;
+					float fraction = ((i * 7 + j * 5 + k * 3 + axis) % 11) / 10.0f;
+					batch.vertices[batch.count] = uint32_t(expected.size());
+					batch.j[batch.count] = j;
+					batch.k[batch.count] = k;
+					batch.axes[batch.count] = axis;
+					batch.fractions[batch.count] = fraction;
+					batch.count++;
+					expected.push_back(crossing_gradient_normal(grid.data(), resolution, i, j, k, axis, fraction));
+					normals.resize(expected.size());
+					if (batch.count == gradient_batch_size) compute_gradient_normals(grid.data(), resolution, i, batch, normals.data());
+				}
+			}
+		}
+		compute_gradient_normals(grid.data(), resolution, i, batch, normals.data());
+		for (size_t v = 0; v < expected.size(); v++) {
+			CHECK(fabsf(normals[v].x - expected[v].x) < 1e-6f && fabsf(normals[v].y - expected[v].y) < 1e-6f && fabsf(normals[v].z - expected[v].z) < 1e-6f);
+		}
+	}
+}
@@ -0,0 +1,191 @@
+#include "Tests.h"
+
+#include "MeshCache.h"
+#include "MeshWriter.h"
+
+#include <cstdlib>
+#include <atomic>
+
+// Entries are keyed on the post passes and their settings and hand back the stats the passes measured when they
+// were stored
+void test_mesh_cache_post_passes() {
+	MeshCache cache;
+	open_mesh_cache(cache, "mesh_cache_test", 64 * 1024 * 1024);
+	clear_mesh_cache(cache);
+	MarchingCubesParameters parameters = test_parameters(33);
+	MarchingCubesMesh mesh;
+	extract_marching_cubes(sphere_test_grid(33), parameters, mesh);
+
+	MeshPostPasses plain, reordered;
+	reordered.optimize_vertex_order = true;
+	uint64_t plain_key = mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, plain);
+	uint64_t reordered_key = mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, reordered);
+	CHECK(plain_key != reordered_key);
+	CHECK(reordered_key == mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, reordered));
+
+	// Every decimation setting changes the key, but only when the mesh is decimated
+	MeshPostPasses decimated = plain;
+	decimated.decimate = true;
+	uint64_t decimated_key = mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, decimated);
+	CHECK(decimated_key != plain_key);
+	MeshPostPasses changed = decimated;
+	changed.decimation.preserve_borders = !changed.decimation.preserve_borders;
+	CHECK(mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, changed) != decimated_key);
+	changed = decimated;
+	changed.decimation.target_ratio = 0.5f;
+	CHECK(mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, changed) != decimated_key);
+	changed = decimated;
+	changed.decimation.target_triangles = 1000;
+	CHECK(mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, changed) != decimated_key);
+	changed = decimated;
+	changed.decimation.max_error = 0.01f;
+	CHECK(mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, changed) != decimated_key);
+	changed.decimate = false;
+	CHECK(mesh_cache_key(1, parameters, sizeof(MeshVertex), 0, changed) == plain_key);
+
+	MeshPostPassStats stats;
+	decimate_mesh(mesh, decimated.decimation, stats.decimation);
+	stats.vertex_cache_before = measure_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+	optimize_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+	optimize_vertex_fetch(mesh.vertices, mesh.indices);
+	stats.vertex_cache_after = measure_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+	stats.vertex_order_time = 1.5;
+	store_cached_mesh(cache, reordered_key, mesh.vertices.data(), mesh.vertices.size(), sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size(), stats);
+
+	MappedMesh cached;
+	CHECK(!find_cached_mesh(cache, plain_key, cached));
+	CHECK(find_cached_mesh(cache, reordered_key, cached));
+	if (cached.header) {
+		const MeshPostPassStats& cached_stats = cached.header->post_pass_stats;
+		CHECK(cached_stats.vertex_cache_before.acmr == stats.vertex_cache_before.acmr && cached_stats.vertex_cache_after.acmr == stats.vertex_cache_after.acmr);
+		CHECK(cached_stats.vertex_cache_after.atvr == stats.vertex_cache_after.atvr && cached_stats.vertex_order_time == stats.vertex_order_time);
+		CHECK(cached_stats.decimation.input_triangles == stats.decimation.input_triangles && cached_stats.decimation.output_triangles == stats.decimation.output_triangles);
+		CHECK(cached.header->index_count == mesh.indices.size() && memcmp(cached.indices, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)) == 0);
+	}
+	unmap_cached_mesh(cached);
+	clear_mesh_cache(cache);
+	remove("mesh_cache_test/index.bin");
+	remove("mesh_cache_test");
+}
+
+// Volumes are keyed on the hash of every sample, which changes with any byte and the description and is found again
+// under the identity of the file
+void test_volume_file_hash() {
+	const char* path = "volume_hash_test.raw";
+	// Slices larger than the blocks a sampling hash would read from them
+	std::vector<uint8_t> samples(size_t(80) * 70 * 50);
+	for (size_t s = 0; s < samples.size(); s++) samples[s] = uint8_t(s * 31 + s / 7);
+	auto write_volume = [&]() {
+		FILE* file = fopen(path, "wb");
+		if (file) {
+			fwrite(samples.data(), 1, samples.size(), file);
+			fclose(file);
+		}
+	};
+	VolumeDescription description;
+	description.size_x = 80;
+	description.size_y = 70;
+	description.size_z = 50;
+	MappedVolume volume;
+	auto hash_volume = [&](const VolumeDescription& opened) {
+		bool opened_volume = open_raw_volume(path, opened, volume);
+		CHECK(opened_volume);
+		uint64_t hash = 0;
+		CHECK(opened_volume && volume_content_hash(volume, hash));
+		close_volume(volume);
+		return hash;
+	};
+	write_volume();
+	uint64_t hash = hash_volume(description);
+	CHECK(hash == hash_volume(description));
+	VolumeDescription smaller = description;
+	smaller.size_z = 49;
+	CHECK(hash_volume(smaller) != hash);
+	std::atomic<bool> cancel(true);
+	uint64_t cancelled_hash = 0;
+	CHECK(open_raw_volume(path, description, volume) && !volume_content_hash(volume, cancelled_hash, &cancel));
+	close_volume(volume);
+
+	// A byte deep inside a slice in the middle of the volume misses the mesh stored for the old samples
+	MeshCache cache;
+	open_mesh_cache(cache, "mesh_cache_test", 64 * 1024 * 1024);
+	clear_mesh_cache(cache);
+	MarchingCubesParameters parameters = test_parameters(9);
+	MarchingCubesMesh mesh;
+	extract_marching_cubes(sphere_test_grid(9), parameters, mesh);
+	store_cached_mesh(cache, mesh_cache_key(hash, parameters, sizeof(MeshVertex), 0, MeshPostPasses()), mesh.vertices.data(), mesh.vertices.size(),
+		sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size(), MeshPostPassStats());
+	samples[size_t(80) * 70 * 23 + 5000] ^= 0xff;
+	write_volume();
+	uint64_t changed_hash = hash_volume(description);
+	CHECK(changed_hash != hash);
+	MarchingCubesMesh cached;
+	MeshPostPassStats stats;
+	CHECK(!load_cached_mesh(cache, mesh_cache_key(changed_hash, parameters, sizeof(MeshVertex), 0, MeshPostPasses()), cached, stats));
+	CHECK(load_cached_mesh(cache, mesh_cache_key(hash, parameters, sizeof(MeshVertex), 0, MeshPostPasses()), cached, stats));
+
+	// The content hash is found again under the identity of the file by a later run
+	CHECK(open_raw_volume(path, description, volume));
+	uint64_t identity = volume_file_identity(volume);
+	close_volume(volume);
+	store_volume_hash(cache, identity, changed_hash);
+	open_mesh_cache(cache, "mesh_cache_test", 64 * 1024 * 1024);
+	uint64_t found_hash = 0;
+	CHECK(find_volume_hash(cache, identity, found_hash) && found_hash == changed_hash);
+	CHECK(!find_volume_hash(cache, identity + 1, found_hash));
+	samples.push_back(0);
+	write_volume();
+	CHECK(open_raw_volume(path, description, volume) && volume_file_identity(volume) != identity);
+	close_volume(volume);
+	clear_mesh_cache(cache);
+	remove("mesh_cache_test/index.bin");
+	remove("mesh_cache_test/volumes.bin");
+	remove("mesh_cache_test");
+	remove(path);
+}
+
+// A hit is copied out of its entry, so exporting it after the entry is gone writes the mesh that was stored
+void test_export_after_cache_hit() {
+	MeshCache cache;
+	open_mesh_cache(cache, "mesh_cache_test", 64 * 1024 * 1024);
+	clear_mesh_cache(cache);
+	MarchingCubesParameters parameters = test_parameters(29);
+	MarchingCubesMesh mesh;
+	extract_marching_cubes(sphere_test_grid(29), parameters, mesh);
+	uint64_t key = mesh_cache_key(2, parameters, sizeof(MeshVertex), 0, MeshPostPasses());
+	store_cached_mesh(cache, key, mesh.vertices.data(), mesh.vertices.size(), sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size(), MeshPostPassStats());
+
+	MarchingCubesMesh cached;
+	MeshPostPassStats stats;
+	CHECK(load_cached_mesh(cache, key, cached, stats));
+	CHECK(same_mesh(mesh, cached));
+	clear_mesh_cache(cache);
+	remove("mesh_cache_test/index.bin");
+	remove("mesh_cache_test");
+
+	const char* path = "cache_hit_export_test.obj";
+	MeshWriter writer;
+	CHECK(write_mesh_file(writer, path, mesh_file_obj, cached.vertices.size(), [&](uint32_t v) { return cached.vertices[v]; },
+		cached.indices.data(), cached.indices.size()));
+	CHECK(writer.vertex_count == mesh.vertices.size() && writer.triangle_count * 3 == mesh.indices.size());
+	FILE* file = fopen(path, "r");
+	CHECK(file);
+	if (!file) return;
+	char line[256];
+	size_t read_vertices = 0, read_faces = 0;
+	bool exact = true;
+	while (fgets(line, sizeof(line), file)) {
+		if (line[0] == 'f') read_faces++;
+		if (line[0] != 'v' || line[1] != ' ') continue;
+		char* cursor = line + 2;
+		float x = strtof(cursor, &cursor), y = strtof(cursor, &cursor), z = strtof(cursor, &cursor);
+		if (read_vertices < mesh.vertices.size()) {
+			Vector3 position = mesh.vertices[read_vertices].position;
+			exact &= x == position.x && y == position.y && z == position.z;
+		}
+		read_vertices++;
+	}
+	fclose(file);
+	remove(path);
+	CHECK(read_vertices == mesh.vertices.size() && read_faces * 3 == mesh.indices.size() && exact);
+}
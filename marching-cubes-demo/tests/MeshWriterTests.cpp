@@ -0,0 +1,64 @@
+#include "Tests.h"
+
+#include "MeshWriter.h"
+
+#include <cstdlib>
+#include <cfloat>
+
+// Text floats read back to the same float, and an OBJ file holds the exact positions of the mesh written to it
+void test_mesh_writer_floats() {
+	char text[16];
+	const float extremes[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.1f, 1e-7f, 123456.789f, 1e9f, -3.4e38f, FLT_MAX, FLT_MIN, 1.4e-45f, 16777217.0f };
+	for (float value : extremes) {
+		*format_float(text, value) = 0;
+		CHECK(strtof(text, nullptr) == value);
+	}
+	uint32_t state = 7;
+	for (int sample = 0; sample < 100000; sample++) {
+		state = state * 1664525u + 1013904223u;
+		uint32_t bits = state;
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		if (!std::isfinite(value)) continue;
+		char* end = format_float(text, value);
+		CHECK(end - text < 16);
+		*end = 0;
+		CHECK(strtof(text, nullptr) == value);
+	}
+
+	MarchingCubesParameters parameters = test_parameters(24);
+	parameters.cube_size = 3.7f;
+	MarchingCubesMesh mesh;
+	extract_marching_cubes(sphere_test_grid(24), parameters, mesh);
+	const char* path = "mesh_writer_test.obj";
+	MeshWriter writer;
+	CHECK(open_mesh_writer(writer, path, mesh_file_obj, true));
+	std::vector<Vector3> positions, normals;
+	for (const MeshVertex& vertex : mesh.vertices) {
+		positions.push_back(vertex.position);
+		normals.push_back(vertex.normal);
+	}
+	MeshStream stream = mesh_writer_stream(writer);
+	stream.write_vertices(positions.data(), normals.data(), positions.size());
+	stream.write_indices(mesh.indices.data(), mesh.indices.size());
+	CHECK(close_mesh_writer(writer));
+	FILE* file = fopen(path, "r");
+	CHECK(file);
+	if (!file) return;
+	char line[256];
+	size_t read_vertices = 0;
+	bool exact = true;
+	while (fgets(line, sizeof(line), file)) {
+		if (line[0] != 'v' || line[1] != ' ') continue;
+		char* cursor = line + 2;
+		float x = strtof(cursor, &cursor), y = strtof(cursor, &cursor), z = strtof(cursor, &cursor);
+		if (read_vertices < mesh.vertices.size()) {
+			Vector3 position = mesh.vertices[read_vertices].position;
+			exact &= x == position.x && y == position.y && z == position.z;
+		}
+		read_vertices++;
+	}
+	fclose(file);
+	remove(path);
+	CHECK(read_vertices == mesh.vertices.size() && exact);
+}
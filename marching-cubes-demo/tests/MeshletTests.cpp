@@ -0,0 +1,75 @@
+#include "Tests.h"
+
+#include "Meshlets.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+
+// Triangle with its smallest index first, keeping the winding
+static std::array<uint32_t, 3> canonical_triangle(uint32_t a, uint32_t b, uint32_t c) {
+	if (b < a && b < c) return { b, c, a };
+	if (c < a && c < b) return { c, a, b };
+	return { a, b, c };
+}
+
+// Meshlets stay within their limits, hold every triangle of the mesh exactly once with its winding, are inside
+// their spheres, and the culling of a scripted orbit around the meshes never drops a visible triangle
+void test_meshlets() {
+	std::vector<float> grids[2] = { sphere_test_grid(64), random_test_grid(24, 3) };
+	std::vector<MarchingCubesMesh> meshes(2);
+	for (int m = 0; m < 2; m++) extract_marching_cubes(grids[m], test_parameters(int(cbrt(double(grids[m].size())) + 0.5)), meshes[m]);
+	std::vector<const MarchingCubesMesh*> mesh_pointers = { &meshes[0], &meshes[1] };
+	set_thread_count(4);
+	std::vector<MeshletMesh> meshlets;
+	build_meshlets(mesh_pointers, meshlets);
+	set_thread_count(1);
+
+	for (size_t m = 0; m < meshes.size(); m++) {
+		const MarchingCubesMesh& mesh = meshes[m];
+		const MeshletMesh& mesh_meshlets = meshlets[m];
+		MeshletMesh serial_meshlets;
+		build_meshlets(mesh, serial_meshlets);
+		CHECK(serial_meshlets.vertices == mesh_meshlets.vertices && serial_meshlets.triangles == mesh_meshlets.triangles);
+
+		std::vector<std::array<uint32_t, 3>> mesh_triangles, meshlet_triangles;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) mesh_triangles.push_back(canonical_triangle(mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]));
+		for (const Meshlet& meshlet : mesh_meshlets.meshlets) {
+			CHECK(meshlet.vertex_count > 0 && meshlet.vertex_count <= uint32_t(max_meshlet_vertices));
+			CHECK(meshlet.triangle_count > 0 && meshlet.triangle_count <= uint32_t(max_meshlet_triangles));
+			const uint32_t* vertices = mesh_meshlets.vertices.data() + meshlet.vertex_offset;
+			for (uint32_t v = 0; v < meshlet.vertex_count; v++) {
+				Vector3 offset = mesh.vertices[vertices[v]].position - meshlet.center;
+				CHECK(sqrtf(dot(offset, offset)) <= meshlet.radius * (1 + 1e-5f) + 1e-6f);
+			}
+			for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+				const uint8_t* triangle = mesh_meshlets.triangles.data() + meshlet.triangle_offset + t * 3;
+				CHECK(triangle[0] < meshlet.vertex_count && triangle[1] < meshlet.vertex_count && triangle[2] < meshlet.vertex_count);
+				meshlet_triangles.push_back(canonical_triangle(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]));
+			}
+		}
+		std::sort(mesh_triangles.begin(), mesh_triangles.end());
+		std::sort(meshlet_triangles.begin(), meshlet_triangles.end());
+		CHECK(!mesh_triangles.empty() && mesh_triangles == meshlet_triangles);
+	}
+
+	// An orbit around the grid looking at its center or away from it, every third camera inside the sphere looking
+	// along the orbit
+	std::vector<MeshletCamera> path;
+	for (int s = 0; s < 24; s++) {
+		float angle = s * 6.28318f / 24;
+		bool inside = s % 3 == 0;
+		float distance = inside ? 0.2f : 2.5f;
+		MeshletCamera camera;
+		camera.position = Vector3(distance * cosf(angle), 0.4f * sinf(2 * angle), distance * sinf(angle));
+		if (inside) camera.target = camera.position + Vector3(-sinf(angle), 0, cosf(angle));
+		else camera.target = s % 2 ? Vector3(0, 0, 0) : 2.0f * camera.position;
+		path.push_back(camera);
+	}
+	MeshletCullingStats stats = run_meshlet_culling_script(mesh_pointers, meshlets, path);
+	CHECK(stats.frames == path.size());
+	CHECK(stats.triangles == path.size() * (meshes[0].indices.size() + meshes[1].indices.size()) / 3);
+	CHECK(stats.frustum_culled > 0 && stats.backface_culled > 0);
+	CHECK(stats.culled_triangles > 0 && stats.culled_triangles <= stats.invisible_triangles);
+	CHECK(stats.wrongly_culled == 0);
+}
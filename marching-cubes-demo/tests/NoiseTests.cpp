@@ -0,0 +1,28 @@
+#include "Tests.h"
+
+#include "Noise.h"
+
+// Rows of noise, 8 lanes at a time with AVX2 and 4 with SSE2 before the scalar tail, give the values of the scalar
+// code at the same positions for every basis and fractal, warped or not, on both sides of the origin
+void test_noise_lanes() {
+	const int count = 29;
+	Vector3 origin(-1.3f, -0.45f, 0.2f);
+	Vector3 step(0.11f, 0.037f, -0.053f);
+	for (int basis = 0; basis < 2; basis++) {
+		for (int fractal = 0; fractal < 3; fractal++) {
+			for (int warped = 0; warped < 2; warped++) {
+				NoiseParameters parameters;
+				parameters.basis = NoiseBasis(basis);
+				parameters.fractal = NoiseFractal(fractal);
+				parameters.warp_amplitude = warped ? 0.3f : 0.0f;
+				float values[count];
+				evaluate_noise_row(parameters, origin, step, count, values);
+				for (int n = 0; n < count; n++) {
+					float index = float(n);
+					Vector3 position(origin.x + step.x * index, origin.y + step.y * index, origin.z + step.z * index);
+					CHECK(fabsf(values[n] - evaluate_noise(parameters, position)) < 1e-4f);
+				}
+			}
+		}
+	}
+}
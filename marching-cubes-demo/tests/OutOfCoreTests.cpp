@@ -0,0 +1,59 @@
+#include "Tests.h"
+
+#include "OutOfCore.h"
+
+// The volume streamer gives the bytes of the in memory marching cubes for every placement and output, through a
+// slice loader and through a raw file written to a mesh file, and ignores gradient normals like it documents
+void test_out_of_core_extraction() {
+	const int resolution = 41;
+	std::vector<float> grids[2] = { sphere_test_grid(resolution), random_test_grid(resolution, 2) };
+	const char* volume_path = "out_of_core_test.raw";
+	const char* mesh_path = "out_of_core_test.mesh";
+	for (const std::vector<float>& grid : grids) {
+		FILE* volume_file = fopen(volume_path, "wb");
+		CHECK(volume_file);
+		if (!volume_file) return;
+		fwrite(grid.data(), sizeof(float), grid.size(), volume_file);
+		fclose(volume_file);
+		VolumeDescription description;
+		description.size_x = description.size_y = description.size_z = resolution;
+		description.sample_type = volume_float32;
+
+		MarchingCubesParameters parameters = test_parameters(resolution);
+		for (int mode = 0; mode < 4; mode++) {
+			parameters.interpolation = (mode & 1) != 0;
+			parameters.indexed = (mode & 2) != 0;
+			parameters.gradient_normals = false;
+			MarchingCubesMesh reference_mesh;
+			extract_marching_cubes(grid, parameters, reference_mesh);
+			CHECK(!reference_mesh.vertices.empty());
+			parameters.gradient_normals = true;
+
+			MarchingCubesMesh streamed_mesh;
+			MeshStream stream;
+			stream.write_vertices = [&](const Vector3* positions, const Vector3* normals, size_t count) {
+				for (size_t v = 0; v < count; v++) streamed_mesh.vertices.push_back({ positions[v], normals[v] });
+			};
+			stream.write_indices = [&](const uint32_t* indices, size_t count) { streamed_mesh.indices.insert(streamed_mesh.indices.end(), indices, indices + count); };
+			VolumeExtractionStats stats;
+			stream_marching_cubes_slices(resolution, resolution, resolution, [&](int z, float* values) {
+				memcpy(values, grid.data() + size_t(z) * resolution * resolution, size_t(resolution) * resolution * sizeof(float));
+				return true;
+			}, parameters, stream, stats);
+			CHECK(same_mesh(reference_mesh, streamed_mesh));
+			CHECK(stats.triangles * 3 == (parameters.indexed ? reference_mesh.indices.size() : reference_mesh.vertices.size()));
+
+			MappedVolume volume;
+			OutOfCoreStats out_of_core_stats;
+			MarchingCubesMesh file_mesh;
+			std::string error;
+			CHECK(open_raw_volume(volume_path, description, volume));
+			CHECK(extract_marching_cubes_out_of_core(volume, parameters, mesh_path, out_of_core_stats));
+			CHECK(read_mesh_file(mesh_path, file_mesh, error));
+			CHECK(same_mesh(reference_mesh, file_mesh));
+			close_volume(volume);
+		}
+	}
+	remove(volume_path);
+	remove(mesh_path);
+}
@@ -0,0 +1,27 @@
+#include "Tests.h"
+
+#include "Parallel.h"
+
+// Every engine gives the same bytes whatever the number of threads splitting the grid into slabs
+void test_parallel_determinism() {
+	std::vector<float> grids[2] = { sphere_test_grid(67), random_test_grid(45, 1) };
+	for (const std::vector<float>& grid : grids) {
+		MarchingCubesParameters parameters = test_parameters(int(cbrt(double(grid.size())) + 0.5));
+		for (int engine = 0; engine < extraction_engine_count; engine++) {
+			for (int mode = 0; mode < 4; mode++) {
+				parameters.engine = engine;
+				parameters.indexed = (mode & 1) != 0;
+				parameters.gradient_normals = (mode & 2) != 0;
+				set_thread_count(1);
+				MarchingCubesMesh serial_mesh;
+				extract_surface(grid, parameters, serial_mesh);
+				for (int threads : { 3, 4 }) {
+					set_thread_count(threads);
+					MarchingCubesMesh parallel_mesh;
+					extract_surface(grid, parameters, parallel_mesh);
+					CHECK(same_mesh(serial_mesh, parallel_mesh));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#include "Tests.h"
+
+#include "SparseField.h"
+
+// The brick walk gives the triangles of the dense extraction at the middle and both edges of the band, on a
+// resolution that leaves partial bricks on the far faces, and an empty mesh just outside the band
+void test_sparse_field_extraction() {
+	const int resolution = 45;
+	for (int field_kind = 0; field_kind < 2; field_kind++) {
+		std::vector<float> grid = field_kind ? random_test_grid(resolution, 11) : sphere_test_grid(resolution);
+		SparseField field;
+		build_sparse_field(grid.data(), resolution, 0.5f, 0.1f, field);
+		MarchingCubesParameters parameters = test_parameters(resolution);
+		for (float threshold : { field.min_threshold, 0.5f, field.max_threshold }) {
+			parameters.threshold = threshold;
+			MarchingCubesMesh dense_mesh, sparse_mesh;
+			extract_marching_cubes(grid, parameters, dense_mesh);
+			extract_marching_cubes_sparse(field, parameters, sparse_mesh);
+			CHECK(!sparse_mesh.indices.empty());
+			CHECK(sorted_triangles(dense_mesh) == sorted_triangles(sparse_mesh));
+		}
+		for (float threshold : { nextafterf(field.min_threshold, 0.0f), nextafterf(field.max_threshold, 1.0f) }) {
+			parameters.threshold = threshold;
+			MarchingCubesMesh sparse_mesh;
+			extract_marching_cubes_sparse(field, parameters, sparse_mesh);
+			CHECK(sparse_mesh.vertices.empty() && sparse_mesh.indices.empty());
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#include "Tests.h"
+
+#include "Parallel.h"
+
+int failed_checks = 0;
+
+void test_parallel_determinism();
+void test_vertex_packing();
+void test_out_of_core_extraction();
+void test_mesh_cache_post_passes();
+void test_meshlets();
+void test_chunk_streaming();
+void test_transition_face();
+void test_mesh_writer_floats();
+void test_volume_file_hash();
+void test_export_after_cache_hit();
+void test_compressed_field_resolution();
+void test_gradient_normal_lanes();
+void test_qef_lanes();
+void test_noise_lanes();
+void test_sparse_field_extraction();
+void test_decimation();
+
+typedef struct TestCase {
+	const char* name;
+	void (*run)();
+} TestCase;
+
+const TestCase test_cases[] = {
+	{ "parallel determinism", test_parallel_determinism },
+	{ "vertex packing", test_vertex_packing },
+	{ "out of core extraction", test_out_of_core_extraction },
+	{ "mesh cache post passes", test_mesh_cache_post_passes },
+	{ "meshlets", test_meshlets },
+	{ "chunk streaming", test_chunk_streaming },
+	{ "transition face", test_transition_face },
+	{ "mesh writer floats", test_mesh_writer_floats },
+	{ "volume file hash", test_volume_file_hash },
+	{ "export after cache hit", test_export_after_cache_hit },
+	{ "compressed field resolution", test_compressed_field_resolution },
+	{ "gradient normal lanes", test_gradient_normal_lanes },
+	{ "qef lanes", test_qef_lanes },
+	{ "noise lanes", test_noise_lanes },
+	{ "sparse field extraction", test_sparse_field_extraction },
+	{ "decimation", test_decimation },
+};
+
+int main() {
+	for (const TestCase& test_case : test_cases) {
+		int failed_before = failed_checks;
+		test_case.run();
+		printf("%s: %s\n", test_case.name, failed_checks == failed_before ? "passed" : "FAILED");
+	}
+	set_thread_count(1);
+	return failed_checks;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Headless tests of everything below the user interface, built by the marching-cubes-tests console project
+// A test is a function registered in TestMain.cpp, its failed checks are printed and counted and the process
+// exits with the number of failed checks
+
+#include "MarchingCubes.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+extern int failed_checks;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			failed_checks++; \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+// Distance to the center of the grid with a ripple, a closed surface around the center at thresholds up to 0.7
+inline std::vector<float> sphere_test_grid(int resolution) {
+	std::vector<float> grid(size_t(resolution) * resolution * resolution);
+	for (int i = 0; i < resolution; i++) {
+		for (int j = 0; j < resolution; j++) {
+			for (int k = 0; k < resolution; k++) {
+				float x = k / float(resolution - 1) - 0.5f;
+				float y = i / float(resolution - 1) - 0.5f;
+				float z = j / float(resolution - 1) - 0.5f;
+				grid[(size_t(resolution) * i + j) * resolution + k] = sqrtf(x * x + y * y + z * z) * 1.5f + 0.05f * sinf(13 * x + 7 * y);
+			}
+		}
+	}
+	return grid;
+}
+
+// White noise in [0, 1), the worst case of every extraction
+inline std::vector<float> random_test_grid(int resolution, uint32_t seed) {
+	std::vector<float> grid(size_t(resolution) * resolution * resolution);
+	uint32_t state = seed * 747796405u + 2891336453u;
+	for (float& value : grid) {
+		state = state * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+		value = ((word >> 22) ^ word) / 4294967296.0f;
+	}
+	return grid;
+}
+
+inline MarchingCubesParameters test_parameters(int resolution) {
+	MarchingCubesParameters parameters;
+	parameters.resolution = resolution;
+	parameters.cube_size = 2.0f;
+	parameters.threshold = 0.5f;
+	parameters.interpolation = true;
+	parameters.indexed = true;
+	return parameters;
+}
+
+template <typename VertexType>
+bool same_mesh(const IndexedMesh<VertexType>& a, const IndexedMesh<VertexType>& b) {
+	return a.vertices.size() == b.vertices.size() && a.indices == b.indices &&
+		(a.vertices.empty() || memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(VertexType)) == 0);
+}
+
+// Triangles of a mesh as their corner positions, in an order that does not depend on how they are numbered
+inline std::vector<std::array<float, 9>> sorted_triangles(const MarchingCubesMesh& mesh) {
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		std::array<float, 9> triangle;
+		for (int corner = 0; corner < 3; corner++) {
+			Vector3 position = mesh.vertices[mesh.indices[i + corner]].position;
+			triangle[corner * 3] = position.x;
+			triangle[corner * 3 + 1] = position.y;
+			triangle[corner * 3 + 2] = position.z;
+		}
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
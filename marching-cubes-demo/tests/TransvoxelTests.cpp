@@ -0,0 +1,51 @@
+#include "Tests.h"
+
+#include "Transvoxel.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+// The transition cells of a face share the crossings of their common edges, so no two vertices are at the same
+// place, and the cells join into a surface where every edge has at most two triangles, wound opposite ways
+void test_transition_face() {
+	const int cells = 12;
+	const int samples = 2 * cells + 1;
+	std::vector<float> noise = random_test_grid(samples, 4);
+	for (int field = 0; field < 2; field++) {
+		std::vector<float> values(size_t(samples) * samples);
+		for (int v = 0; v < samples; v++) {
+			for (int u = 0; u < samples; u++) {
+				float x = u / float(samples - 1) - 0.5f;
+				float y = v / float(samples - 1) - 0.5f;
+				values[size_t(samples) * v + u] = field ? noise[size_t(samples) * v + u] : 0.5f + 0.3f * sinf(9 * x) * cosf(7 * y);
+			}
+		}
+		TransitionFace face;
+		face.cells = cells;
+		face.values = values.data();
+		face.fine_position = [](float u, float v) { return Vector3(u, v, 0.0f); };
+		face.coarse_position = [](float u, float v) { return Vector3(u, v, 1.0f); };
+		face.mirrored = field != 0;
+		MarchingCubesParameters parameters = test_parameters(samples);
+		MarchingCubesMesh mesh;
+		extract_transition_face(face, parameters, [](Vector3) { return Vector3(0, 0, 1); }, mesh);
+		CHECK(!mesh.indices.empty());
+
+		std::vector<std::pair<std::pair<float, float>, float>> positions;
+		for (const MeshVertex& vertex : mesh.vertices) positions.push_back({ { vertex.position.x, vertex.position.y }, vertex.position.z });
+		std::sort(positions.begin(), positions.end());
+		CHECK(std::adjacent_find(positions.begin(), positions.end()) == positions.end());
+
+		std::map<std::pair<uint32_t, uint32_t>, int> edge_uses;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = mesh.indices[i + corner];
+				uint32_t b = mesh.indices[i + (corner + 1) % 3];
+				CHECK(a < mesh.vertices.size() && a != b);
+				edge_uses[{ a, b }]++;
+			}
+		}
+		for (const auto& edge : edge_uses) CHECK(edge.second == 1);
+	}
+}
@@ -0,0 +1,69 @@
+#include "Tests.h"
+
+#include "VertexPacking.h"
+
+#include <algorithm>
+
+// In double precision from both the sine and cosine, acos of a float dot product is off by about 3e-4 near 1
+static float normal_angle(Vector3 a, Vector3 b) {
+	double ax = a.x, ay = a.y, az = a.z, bx = b.x, by = b.y, bz = b.z;
+	double cx = ay * bz - az * by, cy = az * bx - ax * bz, cz = ax * by - ay * bx;
+	return float(atan2(sqrt(cx * cx + cy * cy + cz * cz), ax * bx + ay * by + az * bz));
+}
+
+// Positions and normals round trip within packed_position_error and packed_normal_error, over random samples,
+// the faces, edges and corners of the bounds, the axes and the folds of the octahedron, and an extracted mesh
+void test_vertex_packing() {
+	uint32_t state = 12345;
+	auto next_float = [&](float low, float high) {
+		state = state * 1664525u + 1013904223u;
+		return low + (high - low) * ((state >> 8) / 16777216.0f);
+	};
+	for (float cube_size : { 2.0f, 7.5f, 50.0f }) {
+		float half_size = cube_size / 2.0f;
+		float max_error = 0;
+		for (int sample = 0; sample < 100000; sample++) {
+			Vector3 position(next_float(-half_size, half_size), next_float(-half_size, half_size), next_float(-half_size, half_size));
+			if (sample < 27) {
+				position = Vector3(float(sample % 3 - 1), float(sample / 3 % 3 - 1), float(sample / 9 - 1));
+				position = half_size * position;
+			}
+			uint16_t packed[4];
+			encode_packed_position(position, cube_size, packed);
+			Vector3 decoded = decode_packed_position(packed, cube_size);
+			max_error = std::max(max_error, std::max(fabsf(decoded.x - position.x), std::max(fabsf(decoded.y - position.y), fabsf(decoded.z - position.z))));
+		}
+		CHECK(max_error <= packed_position_error(cube_size));
+	}
+
+	float max_angle = 0;
+	for (int sample = 0; sample < 200000; sample++) {
+		Vector3 normal(next_float(-1, 1), next_float(-1, 1), next_float(-1, 1));
+		if (sample < 26) {
+			// Axes, the diagonals and the folds of the octahedron
+			int code = sample < 13 ? sample : sample + 1;
+			normal = Vector3(float(code % 3 - 1), float(code / 3 % 3 - 1), float(code / 9 - 1));
+		}
+		if (dot(normal, normal) < 1e-6f) continue;
+		int16_t packed[2];
+		encode_octahedral_normal(normal, packed);
+		max_angle = std::max(max_angle, normal_angle(normal, decode_octahedral_normal(packed)));
+	}
+	CHECK(max_angle <= packed_normal_error);
+
+	MarchingCubesParameters parameters = test_parameters(48);
+	MarchingCubesMesh mesh;
+	extract_surface(sphere_test_grid(48), parameters, mesh);
+	CHECK(!mesh.vertices.empty());
+	PackedVertexFormat format;
+	format.cube_size = parameters.cube_size;
+	for (const MeshVertex& vertex : mesh.vertices) {
+		PackedVertex packed;
+		format.write(packed, vertex.position, vertex.normal);
+		MeshVertex decoded = decode_packed_vertex(packed, parameters.cube_size);
+		Vector3 offset = decoded.position - vertex.position;
+		float error = packed_position_error(parameters.cube_size);
+		CHECK(fabsf(offset.x) <= error && fabsf(offset.y) <= error && fabsf(offset.z) <= error);
+		CHECK(normal_angle(vertex.normal, decoded.normal) <= packed_normal_error);
+	}
+}